@@ -17,6 +17,7 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <limits.h>
 #include <cpuarch.h>
 
 
@@ -47,6 +48,12 @@ char *cpu_config_help =
 	"  FastForward = <num_inst> (Default = 0)\n"
 	"      Number of x86 instructions to run with a fast functional simulation before\n"
 	"      the architectural simulation starts.\n"
+	"  FastForwardWarm = {t|f} (Default = f)\n"
+	"      Warm up the memory hierarchy during fast-forward simulation. The instruction\n"
+	"      fetches, loads, and stores of each context update the state of the caches\n"
+	"      and directories (tags, replacement state, coherence state) as they would in\n"
+	"      the architectural simulation, but without modeling any timing. Statistics\n"
+	"      for these accesses are shown with the 'Atomic' prefix in the memory report.\n"
 	"  ContextSwitch = {t|f} (Default = t)\n"
 	"      Allow context switches in computing nodes. If this option is set to false,\n"
 	"      the maximum number of contexts that can be run is limited by the number of\n"
@@ -127,6 +134,16 @@ char *cpu_config_help =
 	"      Load-store queue sharing among threads.\n"
 	"  LsqSize = <num_uops> (Default = 20)\n"
 	"      Load-store queue size in number of uops (if private, per-thread LSQ size).\n"
+	"  WcbSize = <entries> (Default = 0)\n"
+	"      Number of entries of the per-thread write-combining buffer placed between\n"
+	"      the store queue and the data cache. Committed stores are written into the\n"
+	"      buffer, merging with stores to the same block (or sector) of the data\n"
+	"      cache, and complete right away. A value of 0 disables the buffer, and\n"
+	"      every store accesses the data cache.\n"
+	"  WcbTimeout = <cycles> (Default = 32)\n"
+	"      Cycles since an entry of the write-combining buffer is allocated until\n"
+	"      it is written to the data cache. Entries are also written when the\n"
+	"      buffer is full, and when a system call commits.\n"
 	"  RfKind = {Private|Shared} (Default = Private)\n"
 	"      Register file sharing among threads.\n"
 	"  RfIntSize = <entries> (Default = 80)\n"
@@ -210,6 +227,7 @@ int cpu_cores = 1;
 int cpu_threads = 1;
 
 long long cpu_fast_forward_count;
+int cpu_fast_forward_warm;
 
 int cpu_context_quantum;
 int cpu_context_switch;
@@ -270,6 +288,7 @@ void cpu_config_check(void)
 	cpu_threads = config_read_int(config, section, "Threads", cpu_threads);
 
 	cpu_fast_forward_count = config_read_llint(config, section, "FastForward", 0);
+	cpu_fast_forward_warm = config_read_bool(config, section, "FastForwardWarm", 0);
 
 	cpu_context_switch = config_read_bool(config, section, "ContextSwitch", 1);
 	cpu_context_quantum = config_read_int(config, section, "ContextQuantum", 100000);
@@ -320,6 +339,13 @@ void cpu_config_check(void)
 	lsq_kind = config_read_enum(config, section, "LsqKind", lsq_kind_private, lsq_kind_map, 2);
 	lsq_size = config_read_int(config, section, "LsqSize", 20);
 
+	wcb_size = config_read_int(config, section, "WcbSize", 0);
+	wcb_timeout = config_read_int(config, section, "WcbTimeout", 32);
+	if (wcb_size < 0)
+		fatal("%s: invalid value for 'WcbSize'", cpu_config_file_name);
+	if (wcb_timeout < 1)
+		fatal("%s: invalid value for 'WcbTimeout'", cpu_config_file_name);
+
 	rf_kind = config_read_enum(config, section, "RfKind", rf_kind_private, rf_kind_map, 2);
 	rf_int_size = config_read_int(config, section, "RfIntSize", 80);
 	rf_fp_size = config_read_int(config, section, "RfFpSize", 40);
@@ -410,6 +436,7 @@ void cpu_config_dump(FILE *f)
 	fprintf(f, "Cores = %d\n", cpu_cores);
 	fprintf(f, "Threads = %d\n", cpu_threads);
 	fprintf(f, "FastForward = %lld\n", cpu_fast_forward_count);
+	fprintf(f, "FastForwardWarm = %s\n", cpu_fast_forward_warm ? "True" : "False");
 	fprintf(f, "ContextSwitch = %s\n", cpu_context_switch ? "True" : "False");
 	fprintf(f, "ContextQuantum = %d\n", cpu_context_quantum);
 	fprintf(f, "ThreadQuantum = %d\n", cpu_thread_quantum);
@@ -442,6 +469,11 @@ void cpu_config_dump(FILE *f)
 	fprintf(f, "IqSize = %d\n", iq_size);
 	fprintf(f, "LsqKind = %s\n", lsq_kind_map[lsq_kind]);
 	fprintf(f, "LsqSize = %d\n", lsq_size);
+	if (wcb_size)
+	{
+		fprintf(f, "WcbSize = %d\n", wcb_size);
+		fprintf(f, "WcbTimeout = %d\n", wcb_timeout);
+	}
 	fprintf(f, "RfKind = %s\n", rf_kind_map[rf_kind]);
 	fprintf(f, "RfIntSize = %d\n", rf_int_size);
 	fprintf(f, "RfFpSize = %d\n", rf_fp_size);
@@ -598,7 +630,7 @@ void cpu_dump_uop_report(FILE *f, long long *uop_stats, char *prefix, int peak_i
 void cpu_dump_report()
 {
 	FILE *f;
-	int core, thread;
+	int core, thread, i;
 	uint64_t now = ke_timer();
 
 	/* Open file */
@@ -621,7 +653,12 @@ void cpu_dump_report()
 	fprintf(f, "MemoryUsedMax = %lu\n", (long) mem_max_mapped_space);
 	fprintf(f, "\n");
 
-	/* Dispatch stage */
+	/* Dispatch stage. Per-core counters are added up here, since cores might
+	 * have been dispatching on different host threads. */
+	memset(cpu->dispatched, 0, sizeof cpu->dispatched);
+	FOREACH_CORE
+		for (i = 0; i < x86_uinst_opcode_count; i++)
+			cpu->dispatched[i] += CORE.dispatched[i];
 	fprintf(f, "; Dispatch stage\n");
 	cpu_dump_uop_report(f, cpu->dispatched, "Dispatch", cpu_dispatch_width);
 
@@ -779,6 +816,25 @@ void cpu_dump_report()
 			fprintf(f, "BTB.Writes = %lld\n", THREAD.btb_writes);
 			fprintf(f, "\n");
 
+			/* Write-combining buffer */
+			if (wcb_size) {
+				fprintf(f, "; Write-combining buffer\n");
+				fprintf(f, ";    Stores - Committed stores written into the buffer\n");
+				fprintf(f, ";    Merged - Stores merged into an entry already in the buffer\n");
+				fprintf(f, ";    Writes - Entries written to the data cache\n");
+				fprintf(f, ";    MergeRatio - Average number of stores per data cache write\n");
+				fprintf(f, ";    FullDrains, TimeoutDrains, FenceDrains - Writes by cause\n");
+				fprintf(f, "WCB.Stores = %lld\n", THREAD.wcb_stores);
+				fprintf(f, "WCB.Merged = %lld\n", THREAD.wcb_merged);
+				fprintf(f, "WCB.Writes = %lld\n", THREAD.wcb_writes);
+				fprintf(f, "WCB.MergeRatio = %.4g\n", THREAD.wcb_writes ?
+					(double) THREAD.wcb_stores / THREAD.wcb_writes : 0.0);
+				fprintf(f, "WCB.FullDrains = %lld\n", THREAD.wcb_full_drains);
+				fprintf(f, "WCB.TimeoutDrains = %lld\n", THREAD.wcb_timeout_drains);
+				fprintf(f, "WCB.FenceDrains = %lld\n", THREAD.wcb_fence_drains);
+				fprintf(f, "\n");
+			}
+
 			/* Trace cache stats */
 			if (THREAD.trace_cache)
 				trace_cache_dump_report(THREAD.trace_cache, f);
@@ -826,6 +882,7 @@ void cpu_init()
 	rob_init();
 	iq_init();
 	lsq_init();
+	wcb_init();
 	eventq_init();
 	fu_init();
 }
@@ -842,6 +899,7 @@ void cpu_done()
 	rob_done();
 	iq_done();
 	lsq_done();
+	wcb_done();
 	eventq_done();
 	bpred_done();
 	trace_cache_done();
@@ -971,6 +1029,7 @@ void cpu_stages()
 	if (!cpu_context_switch && ke->context_reschedule) {
 		cpu_static_schedule();
 		ke->context_reschedule = 0;
+		cpu->active = 1;
 	}
 
 	/* Dynamic scheduler called after any context changed status other than 'specmode',
@@ -980,6 +1039,7 @@ void cpu_stages()
 	{
 		cpu_dynamic_schedule();
 		ke->context_reschedule = 0;
+		cpu->active = 1;
 	}
 
 	/* Stages */
@@ -1061,15 +1121,63 @@ static void sim_dump_log()
 }
 
 
+/* Update the memory hierarchy with the instruction fetch and the memory accesses
+ * of the last instruction executed by 'ctx', whose address was 'eip'. The context
+ * is assumed to run on the hardware thread that the scheduler will assign to it
+ * when the detailed simulation starts, i.e., the one given by its position in
+ * the context list. */
+static void cpu_fast_forward_warm_inst(struct ctx_t *ctx, uint32_t eip)
+{
+	struct x86_uinst_t *uinst;
+	struct ctx_t *ctx_iter;
+	int node;
+	int core;
+	int thread;
+	int i;
+
+	/* Hardware thread */
+	node = 0;
+	for (ctx_iter = ke->context_list_head; ctx_iter != ctx;
+		ctx_iter = ctx_iter->context_list_next)
+		node++;
+	node %= cpu_cores * cpu_threads;
+	core = node / cpu_threads;
+	thread = node % cpu_threads;
+
+	/* Instruction fetch */
+	if (THREAD.inst_tlb)
+		tlb_access_atomic(THREAD.inst_tlb, THREAD.data_mod, ctx->mid, eip);
+	mod_access_atomic(THREAD.inst_mod, mod_access_read,
+		mmu_translate(ctx->mid, eip, THREAD.local_mem));
+
+	/* Loads and stores */
+	for (i = 0; i < list_count(x86_uinst_list); i++)
+	{
+		uinst = list_get(x86_uinst_list, i);
+		if (uinst->opcode != x86_uinst_load && uinst->opcode != x86_uinst_store)
+			continue;
+		if (THREAD.data_tlb)
+			tlb_access_atomic(THREAD.data_tlb, THREAD.data_mod,
+				ctx->mid, uinst->address);
+		mod_access_atomic(THREAD.data_mod, uinst->opcode == x86_uinst_load ?
+			mod_access_read : mod_access_write,
+			mmu_translate(ctx->mid, uinst->address,
+				THREAD.local_mem));
+	}
+}
+
+
 /* Fast forward simulation */
 static void cpu_fast_forward(long long max_inst)
 {
 	struct ctx_t *ctx;
 	uint64_t inst = 0;
+	uint32_t eip;
 
 	/* Intro message */
 	fprintf(stderr, "\n");
-	fprintf(stderr, "; Fast-forward simulation (%lld x86 instructions)\n", max_inst);
+	fprintf(stderr, "; Fast-forward simulation (%lld x86 instructions%s)\n",
+		max_inst, cpu_fast_forward_warm ? ", memory hierarchy warm-up" : "");
 	fprintf(stderr, "\n");
 
 	/* Functional simulation */
@@ -1090,7 +1198,12 @@ static void cpu_fast_forward(long long max_inst)
 		/* Run an instruction from every running process */
 		inst += ke->running_list_count;
 		for (ctx = ke->running_list_head; ctx; ctx = ctx->running_list_next)
+		{
+			eip = ctx->regs->eip;
 			ctx_execute_inst(ctx);
+			if (cpu_fast_forward_warm)
+				cpu_fast_forward_warm_inst(ctx, eip);
+		}
 	
 		/* Free finished contexts */
 		while (ke->finished_list_head)
@@ -1110,10 +1223,127 @@ static void cpu_fast_forward(long long max_inst)
 }
 
 
+/* Return the number of cycles that can be skipped after the current cycle.
+ * This is only possible if the current cycle was idle, i.e., no stage changed
+ * the pipeline state and no event was processed. In this case, the following
+ * cycles are exact copies of the current one until an event is processed, or
+ * until a time-dependent condition (fetch stall, functional unit latency,
+ * context quantum, commit stall check, write-combining buffer timeout,
+ * simulation limits) changes. */
+static long long cpu_idle_cycles(void)
+{
+	struct ctx_t *ctx;
+	struct uop_t *uop;
+	long long cycle;
+	long long when;
+	int core, thread;
+
+	/* Current cycle must be idle, and no context must be waiting for a
+	 * status change. The 'switchonevent' fetch policy switches threads
+	 * based on the elapsed time, so its idle cycles are not skipped. */
+	if (cpu->active || ke_sim_finish || ke->context_reschedule ||
+		ke->process_events_force || cpu->ctx_dealloc_signals)
+		return 0;
+	if (cpu_fetch_kind == cpu_fetch_kind_switchonevent || esim_debug_file)
+		return 0;
+
+	/* First cycle that needs to be simulated. Events scheduled for
+	 * a given esim cycle are processed at the end of the processor
+	 * cycle in which the pipeline sees them as not completed yet. */
+	cycle = LLONG_MAX;
+	when = esim_next_event_cycle();
+	if (when >= 0)
+		cycle = cpu->cycle + 1 + when - esim_cycle;
+
+	/* Pipeline structures */
+	FOREACH_CORE
+	{
+		/* Next non-memory uop completing */
+		linked_list_head(CORE.eventq);
+		uop = linked_list_get(CORE.eventq);
+		if (uop)
+			cycle = MIN(cycle, uop->when);
+
+		FOREACH_THREAD
+		{
+			/* Fetch stall */
+			if (THREAD.fetch_stall_until >= cpu->cycle)
+				cycle = MIN(cycle, THREAD.fetch_stall_until + 1);
+
+			/* Write-combining buffer timeout */
+			if (THREAD.wcb_count)
+				cycle = MIN(cycle, wcb_head(core, thread)->when + wcb_timeout);
+
+			/* Commit stall check */
+			ctx = THREAD.ctx;
+			if (ctx && ctx_get_status(ctx, ctx_running))
+				cycle = MIN(cycle, THREAD.last_commit_cycle + 1000001);
+		}
+	}
+
+	/* Quantum of oldest context */
+	if (cpu_context_switch)
+		cycle = MIN(cycle, cpu->ctx_alloc_oldest + cpu_context_quantum);
+
+	/* Simulation limits checked at the beginning of a cycle */
+	if (ke_max_cycles)
+		cycle = MIN(cycle, ke_max_cycles + 1);
+	if (ke_max_time)
+		cycle = MIN(cycle, cpu->cycle - cpu->cycle % 10000 + 10001);
+
+	/* No bound found - pipeline is waiting for a host thread */
+	if (cycle == LLONG_MAX)
+		return 0;
+	return MAX(cycle - cpu->cycle - 1, 0);
+}
+
+
+/* Skip idle cycles after the current cycle, if possible. Statistics are
+ * updated as if the skipped cycles had been simulated. Argument 'di_stall'
+ * contains the dispatch stall counters for each core at the beginning of
+ * the current cycle. */
+static void cpu_skip_idle_cycles(long long (*di_stall)[di_stall_max])
+{
+	struct ctx_t *ctx;
+	long long count;
+	long long i;
+	int core, thread;
+	int stall;
+
+	/* Number of cycles to skip */
+	count = cpu_idle_cycles();
+	if (!count)
+		return;
+
+	/* Statistics */
+	FOREACH_CORE
+	{
+		for (stall = 0; stall < di_stall_max; stall++)
+			CORE.di_stall[stall] += (CORE.di_stall[stall] - di_stall[core][stall]) * count;
+		FOREACH_THREAD
+		{
+			ctx = THREAD.ctx;
+			if (!ctx || !ctx_get_status(ctx, ctx_running))
+				THREAD.last_commit_cycle = cpu->cycle + count;
+		}
+	}
+	if (cpu_occupancy_stats)
+		for (i = 0; i < count; i++)
+			cpu_update_occupancy_stats();
+
+	/* Advance cycle */
+	cpu->cycle += count;
+	esim_skip_cycles(count);
+}
+
+
 /* Run simulation loop */
 void cpu_run()
 {
-	
+	long long (*di_stall)[di_stall_max];
+	long long event_count;
+	int core;
+
 	/* Install signal handlers */
 	signal(SIGINT, &cpu_signal_handler);
 	signal(SIGABRT, &cpu_signal_handler);
@@ -1124,6 +1354,14 @@ void cpu_run()
 	if (cpu_fast_forward_count)
 		cpu_fast_forward(cpu_fast_forward_count);
 	
+	/* Dispatch stall counters at the beginning of each cycle */
+	di_stall = calloc(cpu_cores, sizeof(*di_stall));
+	if (!di_stall)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Host threads running pipeline stages */
+	cpu_parallel_init();
+
 	/* Detailed simulation loop */
 	for (;;) {
 
@@ -1149,6 +1387,10 @@ void cpu_run()
 
 		/* Next cycle */
 		cpu->cycle++;
+		cpu->active = 0;
+		event_count = esim_processed_event_count;
+		FOREACH_CORE
+			memcpy(di_stall[core], CORE.di_stall, sizeof(CORE.di_stall));
 
 		/* Processor stages */
 		cpu_stages();
@@ -1158,6 +1400,10 @@ void cpu_run()
 
 		/* Event-driven module */
 		esim_process_events();
+
+		/* Skip following cycles if nothing happened in this one */
+		if (esim_processed_event_count == event_count)
+			cpu_skip_idle_cycles(di_stall);
 		
 		/* Dump log */
 		if (sigusr_received)
@@ -1170,6 +1416,8 @@ void cpu_run()
 	signal(SIGUSR1, SIG_IGN);
 	signal(SIGUSR2, SIG_IGN);
 	signal(SIGALRM, SIG_IGN);
+	cpu_parallel_done();
+	free(di_stall);
 
 	/* CPU report */
 	cpu_dump_report();
@@ -358,6 +358,34 @@ void sq_remove(int core, int thread);
 
 
 
+/*
+ * Write-Combining Buffer
+ */
+
+/* Entry of the write-combining buffer, holding the committed stores to one
+ * block (or sector, in sectored caches) of the data module. */
+struct wcb_entry_t
+{
+	uint32_t addr;  /* Physical address of first store */
+	uint32_t eip;
+	long long di_seq;  /* Dispatch sequence number of first store */
+	long long when;  /* Cycle when entry was allocated */
+};
+
+extern int wcb_size;
+extern int wcb_timeout;
+
+void wcb_init(void);
+void wcb_done(void);
+
+int wcb_can_insert(struct uop_t *store);
+void wcb_insert(struct uop_t *store);
+struct wcb_entry_t *wcb_head(int core, int thread);
+void wcb_remove_head(int core, int thread);
+
+
+
+
 /*
  * Event Queue
  */
@@ -565,6 +593,19 @@ void ptrace_new_cycle(void);
 
 
 
+/*
+ * Parallel Stages
+ */
+
+extern int cpu_host_threads;
+
+void cpu_parallel_init(void);
+void cpu_parallel_done(void);
+void cpu_parallel_run(void (*stage_core)(int core));
+void cpu_parallel_wait(int core);
+
+
+
 
 
 /*
@@ -615,12 +656,18 @@ struct cpu_thread_t
 	int rf_int_count;
 	int rf_fp_count;
 
+	/* Write-combining buffer, as a circular queue of 'wcb_size' entries */
+	int wcb_head;
+	int wcb_count;
+	long long wcb_fence_seq;  /* Sequence number of last committed fence */
+
 	/* Private structures */
 	struct list_t *fetchq;
 	struct list_t *uopq;
 	struct linked_list_t *iq;
 	struct linked_list_t *lq;
 	struct linked_list_t *sq;
+	struct wcb_entry_t *wcb;  /* Write-combining buffer, or NULL */
 	struct bpred_t *bpred;  /* branch predictor */
 	struct trace_cache_t *trace_cache;  /* trace cache */
 	struct rf_t *rf;  /* physical register file */
@@ -637,6 +684,9 @@ struct cpu_thread_t
 	/* Entries to the memory system */
 	struct mod_t *data_mod;  /* Entry for data */
 	struct mod_t *inst_mod;  /* Entry for instructions */
+	struct tlb_t *data_tlb;  /* TLB for data, or NULL */
+	struct tlb_t *inst_tlb;  /* TLB for instructions, or NULL */
+	struct mod_t *local_mem;  /* Main memory module local to the thread, or NULL */
 
 	/* Statistics */
 	long long fetched;
@@ -676,6 +726,13 @@ struct cpu_thread_t
 	long long rf_fp_reads;
 	long long rf_fp_writes;
 
+	long long wcb_stores;
+	long long wcb_merged;
+	long long wcb_writes;
+	long long wcb_full_drains;
+	long long wcb_timeout_drains;
+	long long wcb_fence_drains;
+
 	long long rat_int_reads;
 	long long rat_int_writes;
 	long long rat_fp_reads;
@@ -769,6 +826,7 @@ struct cpu_t
 	/* Some fields */
 	long long seq;  /* Seq num assigned to last instr (with pre-incr) */
 	char *stage;  /* Name of currently simulated stage */
+	int active;  /* Some stage changed the pipeline state in the current cycle */
 
 	/* Context allocations */
 	long long ctx_alloc_oldest;  /* Time when oldest context was allocated */
@@ -819,5 +877,6 @@ void cpu_recover(int core, int thread);
 
 void cpu_run(void);
 
+
 #endif
 
@@ -151,8 +151,10 @@ int fu_reserve(struct uop_t *uop)
 		}
 	}
 
-	/* No free f.u. was found */
+	/* No free f.u. was found. The uop retries every cycle, so the
+	 * pipeline cannot be considered idle. */
 	fu->denied[fu_class]++;
+	cpu->active = 1;
 	return 0;
 }
 
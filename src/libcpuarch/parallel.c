@@ -0,0 +1,203 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2011  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <cpuarch.h>
+
+
+/*
+ * Parallel Stages
+ *
+ * Stages that only access the private state of each core (writeback, dispatch,
+ * decode) can run for all cores at the same time on a pool of host threads.
+ * Host thread 'i' (the main thread being host thread 0) processes cores 'i',
+ * 'i + cpu_host_threads', etc., in increasing order.
+ *
+ * The few operations in these stages that access shared state must call
+ * 'cpu_parallel_wait' first. This function waits until the stage completed
+ * for all cores with a lower index, so shared state is updated in the same
+ * order as in a sequential simulation, and the simulation results do not
+ * depend on the number of host threads.
+ */
+
+int cpu_host_threads = 1;
+
+static pthread_t *parallel_thread;
+
+/* Stage run by all host threads, and number of times that host threads have
+ * been started. Worker threads spin until 'parallel_generation' changes. */
+static void (*parallel_stage_core)(int core);
+static volatile long long parallel_generation;
+static volatile int parallel_quit;
+
+/* Number of worker threads that finished the current stage */
+static volatile int parallel_finished;
+
+/* Array of flags indexed by core, set when the stage finished for it */
+static volatile int *parallel_core_done;
+
+
+/* Called in every iteration of a busy-wait loop. After some iterations, the
+ * host CPU is released, in case there are more host threads than CPUs. */
+static void cpu_parallel_pause(int *count)
+{
+	if (++*count < 64)
+		return;
+	sched_yield();
+	*count = 0;
+}
+
+
+/* Run current stage for all cores assigned to a host thread */
+static void cpu_parallel_run_cores(int host_thread)
+{
+	int core;
+
+	for (core = host_thread; core < cpu_cores; core += cpu_host_threads)
+	{
+		parallel_stage_core(core);
+		__sync_synchronize();
+		parallel_core_done[core] = 1;
+	}
+}
+
+
+static void *cpu_parallel_thread(void *arg)
+{
+	int host_thread = (long) arg;
+	long long generation = 0;
+	int count = 0;
+
+	for (;;)
+	{
+		/* Wait for next stage */
+		while (parallel_generation == generation)
+			cpu_parallel_pause(&count);
+		__sync_synchronize();
+		generation = parallel_generation;
+		if (parallel_quit)
+			break;
+
+		/* Run it */
+		cpu_parallel_run_cores(host_thread);
+		__sync_fetch_and_add(&parallel_finished, 1);
+	}
+	return NULL;
+}
+
+
+void cpu_parallel_init(void)
+{
+	long i;
+
+	/* Sequential simulation */
+	if (cpu_host_threads < 1)
+		fatal("invalid number of host threads");
+	if (cpu_host_threads > cpu_cores)
+		cpu_host_threads = cpu_cores;
+	if (cpu_host_threads == 1)
+		return;
+
+#ifdef MHANDLE
+	fatal("%s: parallel stages not supported with memory debugging",
+		__FUNCTION__);
+#endif
+
+	/* Create worker threads */
+	parallel_core_done = calloc(cpu_cores, sizeof(int));
+	parallel_thread = calloc(cpu_host_threads, sizeof(pthread_t));
+	if (!parallel_core_done || !parallel_thread)
+		fatal("%s: out of memory", __FUNCTION__);
+	for (i = 1; i < cpu_host_threads; i++)
+		if (pthread_create(&parallel_thread[i], NULL, cpu_parallel_thread, (void *) i))
+			fatal("%s: cannot create host thread", __FUNCTION__);
+}
+
+
+void cpu_parallel_done(void)
+{
+	int i;
+
+	/* Sequential simulation */
+	if (!parallel_thread)
+		return;
+
+	/* Stop worker threads */
+	parallel_quit = 1;
+	__sync_synchronize();
+	parallel_generation++;
+	for (i = 1; i < cpu_host_threads; i++)
+		pthread_join(parallel_thread[i], NULL);
+
+	/* Free */
+	free(parallel_thread);
+	free((void *) parallel_core_done);
+	parallel_thread = NULL;
+	parallel_core_done = NULL;
+}
+
+
+/* Run function 'stage_core' for all cores */
+void cpu_parallel_run(void (*stage_core)(int core))
+{
+	int core;
+	int count = 0;
+
+	/* Sequential simulation */
+	if (!parallel_thread)
+	{
+		FOREACH_CORE
+			stage_core(core);
+		return;
+	}
+
+	/* Start worker threads */
+	FOREACH_CORE
+		parallel_core_done[core] = 0;
+	parallel_stage_core = stage_core;
+	parallel_finished = 0;
+	__sync_synchronize();
+	parallel_generation++;
+
+	/* Run cores assigned to main thread, and wait for the rest */
+	cpu_parallel_run_cores(0);
+	while (parallel_finished < cpu_host_threads - 1)
+		cpu_parallel_pause(&count);
+	__sync_synchronize();
+}
+
+
+/* Wait until the current stage finished for all cores with an index lower
+ * than 'core'. Must be called before accessing state shared among cores. */
+void cpu_parallel_wait(int core)
+{
+	int i;
+	int count = 0;
+
+	/* Sequential simulation */
+	if (!parallel_thread)
+		return;
+
+	/* Wait for lower cores */
+	for (i = 0; i < core; i++)
+		while (!parallel_core_done[i])
+			cpu_parallel_pause(&count);
+	__sync_synchronize();
+}
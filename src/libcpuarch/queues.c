@@ -409,6 +409,112 @@ void sq_remove(int core, int thread)
 
 
 
+/* Write-Combining Buffer */
+
+int wcb_size;
+int wcb_timeout;
+
+
+void wcb_init()
+{
+	int core, thread;
+
+	if (!wcb_size)
+		return;
+	FOREACH_CORE FOREACH_THREAD {
+		THREAD.wcb = calloc(wcb_size, sizeof(struct wcb_entry_t));
+		if (!THREAD.wcb)
+			fatal("%s: out of memory", __FUNCTION__);
+	}
+}
+
+
+void wcb_done()
+{
+	int core, thread;
+
+	/* Stores still in the buffer are discarded */
+	FOREACH_CORE FOREACH_THREAD
+		free(THREAD.wcb);
+}
+
+
+/* Return the entry holding stores to the same block (or sector, in sectored
+ * caches) of the data module as 'store', or NULL if there is none. */
+static struct wcb_entry_t *wcb_find(struct uop_t *store)
+{
+	struct wcb_entry_t *entry;
+	int core = store->core;
+	int thread = store->thread;
+	int log_size;
+	int i;
+
+	log_size = THREAD.data_mod->cache->log_sector_size;
+	for (i = 0; i < THREAD.wcb_count; i++) {
+		entry = &THREAD.wcb[(THREAD.wcb_head + i) % wcb_size];
+		if (entry->addr >> log_size == store->phy_addr >> log_size)
+			return entry;
+	}
+	return NULL;
+}
+
+
+/* Return true if a committed store can be written into the write-combining
+ * buffer of its thread, either merging it or in a free entry. */
+int wcb_can_insert(struct uop_t *store)
+{
+	int core = store->core;
+	int thread = store->thread;
+
+	return THREAD.wcb_count < wcb_size || wcb_find(store);
+}
+
+
+/* Write a committed store into the write-combining buffer of its thread. The
+ * store is merged into the entry for its block, if any. Otherwise, a new entry
+ * is allocated at the tail. */
+void wcb_insert(struct uop_t *store)
+{
+	struct wcb_entry_t *entry;
+	int core = store->core;
+	int thread = store->thread;
+
+	/* Merge */
+	THREAD.wcb_stores++;
+	entry = wcb_find(store);
+	if (entry) {
+		THREAD.wcb_merged++;
+		return;
+	}
+
+	/* New entry */
+	assert(THREAD.wcb_count < wcb_size);
+	entry = &THREAD.wcb[(THREAD.wcb_head + THREAD.wcb_count) % wcb_size];
+	entry->addr = store->phy_addr;
+	entry->eip = store->eip;
+	entry->di_seq = store->di_seq;
+	entry->when = cpu->cycle;
+	THREAD.wcb_count++;
+}
+
+
+/* Oldest entry of the write-combining buffer, or NULL if empty */
+struct wcb_entry_t *wcb_head(int core, int thread)
+{
+	return THREAD.wcb_count ? &THREAD.wcb[THREAD.wcb_head] : NULL;
+}
+
+
+void wcb_remove_head(int core, int thread)
+{
+	assert(THREAD.wcb_count);
+	THREAD.wcb_head = (THREAD.wcb_head + 1) % wcb_size;
+	THREAD.wcb_count--;
+}
+
+
+
+
 /* Event Queue */
 
 void eventq_init()
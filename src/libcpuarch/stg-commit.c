@@ -107,6 +107,11 @@ static void commit_thread(int core, int thread, int quant)
 		/* Trace cache */
 		if (trace_cache_present)
 			trace_cache_new_uop(THREAD.trace_cache, uop);
+
+		/* System calls serialize execution, acting as fences for the
+		 * write-combining buffer. Older stores are drained. */
+		if (uop->uinst->opcode == x86_uinst_syscall)
+			THREAD.wcb_fence_seq = uop->di_seq;
 			
 		/* Statistics */
 		THREAD.last_commit_cycle = cpu->cycle;
@@ -138,6 +143,7 @@ static void commit_thread(int core, int thread, int quant)
 		
 		/* Retire instruction */
 		rob_remove_head(core, thread);
+		cpu->active = 1;
 		CORE.rob_reads++;
 		THREAD.rob_reads++;
 		quant--;
@@ -40,6 +40,7 @@ static void decode_thread(int core, int thread)
 		 * the trace cache queue, copy all of them
 		 * into the uop queue in one single decode slot. */
 		if (uop->fetch_trace_cache) {
+			cpu->active = 1;
 			do {
 				fetchq_remove(core, thread, 0);
 				list_add(uopq, uop);
@@ -54,6 +55,7 @@ static void decode_thread(int core, int thread)
 		assert(!uop->mop_index);
 		if (!mod_in_flight_access(THREAD.inst_mod, uop->fetch_access, uop->fetch_address))
 		{
+			cpu->active = 1;
 			do {
 				fetchq_remove(core, thread, 0);
 				list_add(uopq, uop);
@@ -75,8 +77,6 @@ static void decode_core(int core)
 
 void cpu_decode()
 {
-	int core;
 	cpu->stage = "decode";
-	FOREACH_CORE
-		decode_core(core);
+	cpu_parallel_run(decode_core);
 }
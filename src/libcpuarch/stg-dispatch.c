@@ -65,6 +65,7 @@ static int dispatch_thread(int core, int thread, int quant)
 		uop = list_remove_at(THREAD.uopq, 0);
 		assert(uop_exists(uop));
 		uop->in_uopq = 0;
+		cpu->active = 1;
 		
 		/* Rename */
 		rf_rename(uop);
@@ -93,7 +94,6 @@ static int dispatch_thread(int core, int thread, int quant)
 		CORE.di_stall[uop->specmode ? di_stall_spec : di_stall_used]++;
 		THREAD.dispatched[uop->uinst->opcode]++;
 		CORE.dispatched[uop->uinst->opcode]++;
-		cpu->dispatched[uop->uinst->opcode]++;
 		quant--;
 
 		/* Pipeline debug */
@@ -140,9 +140,7 @@ void dispatch_core(int core)
 
 void cpu_dispatch()
 {
-	int core;
 	cpu->stage = "dispatch";
-	FOREACH_CORE
-		dispatch_core(core);
+	cpu_parallel_run(dispatch_core);
 }
 
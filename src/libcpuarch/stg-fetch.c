@@ -20,7 +20,8 @@
 #include <cpuarch.h>
 
 
-static int can_fetch(int core, int thread)
+/* Return true if a thread can fetch, regardless of the instruction TLB */
+static int can_fetch_no_tlb(int core, int thread)
 {
 	struct ctx_t *ctx = THREAD.ctx;
 
@@ -45,7 +46,8 @@ static int can_fetch(int core, int thread)
 	block = THREAD.fetch_neip & ~(THREAD.inst_mod->block_size - 1);
 	if (block != THREAD.fetch_block)
 	{
-		phy_addr = mmu_translate(THREAD.ctx->mid, THREAD.fetch_neip);
+		phy_addr = mmu_translate(THREAD.ctx->mid, THREAD.fetch_neip,
+			THREAD.local_mem);
 		if (!mod_can_access(THREAD.inst_mod, phy_addr))
 			return 0;
 	}
@@ -55,6 +57,38 @@ static int can_fetch(int core, int thread)
 }
 
 
+/* Return true if the next fetch of a thread accesses a new block, whose
+ * translation must be in the instruction TLB. */
+static int fetch_needs_tlb(int core, int thread)
+{
+	uint32_t block;
+
+	if (!THREAD.inst_tlb)
+		return 0;
+	block = THREAD.fetch_neip & ~(THREAD.inst_mod->block_size - 1);
+	return block != THREAD.fetch_block;
+}
+
+
+/* Return true if a thread can fetch. Fetch policies call this function for
+ * threads that do not end up fetching, so the instruction TLB is only probed. */
+static int can_fetch(int core, int thread)
+{
+	return can_fetch_no_tlb(core, thread) && (!fetch_needs_tlb(core, thread) ||
+		tlb_probe(THREAD.inst_tlb, THREAD.ctx->mid, THREAD.fetch_neip));
+}
+
+
+/* Access the instruction TLB for the next fetch of a thread. A hit is counted,
+ * or a miss is started, so the function is only called for a thread that
+ * attempts to fetch. Return true if the translation is available. */
+static int fetch_tlb_access(int core, int thread)
+{
+	return !fetch_needs_tlb(core, thread) || tlb_access(THREAD.inst_tlb,
+		THREAD.data_mod, THREAD.ctx->mid, THREAD.fetch_neip);
+}
+
+
 /* Execute in the simulation kernel a macro-instruction and create uops.
  * If any of the uops is a control uop, this uop will be the return value of
  * the function. Otherwise, the first decoded uop is returned. */
@@ -118,7 +152,7 @@ static struct uop_t *fetch_inst(int core, int thread, int fetch_trace_cache)
 		/* Calculate physical address of a memory access */
 		if (uop->flags & X86_UINST_MEM)
 			uop->phy_addr = mmu_translate(THREAD.ctx->mid,
-				uinst->address);
+				uinst->address, THREAD.local_mem);
 
 		/* Store x86 macro-instruction and uinst names. This is costly,
 		 * do it only if debug is activated. */
@@ -220,6 +254,9 @@ static void fetch_thread(int core, int thread)
 
 	int taken;
 
+	/* Fetch stage changes the pipeline state */
+	cpu->active = 1;
+
 	/* Try to fetch from trace cache first */
 	if (fetch_thread_trace_cache(core, thread))
 		return;
@@ -229,11 +266,12 @@ static void fetch_thread(int core, int thread)
 	block = THREAD.fetch_neip & ~(THREAD.inst_mod->block_size - 1);
 	if (block != THREAD.fetch_block)
 	{
-		phy_addr = mmu_translate(THREAD.ctx->mid, THREAD.fetch_neip);
+		phy_addr = mmu_translate(THREAD.ctx->mid, THREAD.fetch_neip,
+			THREAD.local_mem);
 		THREAD.fetch_block = block;
 		THREAD.fetch_address = phy_addr;
 		THREAD.fetch_access = mod_access(THREAD.inst_mod, mod_entry_cpu,
-			mod_access_read, phy_addr, NULL, NULL, NULL);
+			mod_access_read, phy_addr, THREAD.fetch_neip, NULL, NULL, NULL);
 		THREAD.btb_reads++;
 
 		/* MMU statistics */
@@ -282,6 +320,16 @@ static void fetch_thread(int core, int thread)
 
 
 
+/* Fetch from a thread if it can. Return true if it fetched. */
+static int fetch_thread_if_ready(int core, int thread)
+{
+	if (!can_fetch_no_tlb(core, thread) || !fetch_tlb_access(core, thread))
+		return 0;
+	fetch_thread(core, thread);
+	return 1;
+}
+
+
 static void fetch_core(int core)
 {
 	int thread;
@@ -293,10 +341,7 @@ static void fetch_core(int core)
 	{
 		/* Fetch from all threads */
 		FOREACH_THREAD
-		{
-			if (can_fetch(core, thread))
-				fetch_thread(core, thread);
-		}
+			fetch_thread_if_ready(core, thread);
 		break;
 	}
 
@@ -306,11 +351,8 @@ static void fetch_core(int core)
 		FOREACH_THREAD
 		{
 			CORE.fetch_current = (CORE.fetch_current + 1) % cpu_threads;
-			if (can_fetch(core, CORE.fetch_current))
-			{
-				fetch_thread(core, CORE.fetch_current);
+			if (fetch_thread_if_ready(core, CORE.fetch_current))
 				break;
-			}
 		}
 		break;
 	}
@@ -326,6 +368,12 @@ static void fetch_core(int core)
 		if (THREAD.fetch_stall_until >= cpu->cycle)
 			break;
 
+		/* The current thread attempts to fetch. If it misses in the
+		 * instruction TLB, the miss is started before switching, so that
+		 * the thread becomes eligible again once it is filled. */
+		if (can_fetch_no_tlb(core, thread) && !can_fetch(core, thread))
+			fetch_tlb_access(core, thread);
+
 		/* Switch thread if:
 		 * - Quantum expired for current thread.
 		 * - Long latency instruction is in progress. */
@@ -359,6 +407,17 @@ static void fetch_core(int core)
 				if (!eventq_longlat(core, new))
 					break;
 			}
+
+			/* If no thread can fetch, and neither can the current one,
+			 * switch to a thread only waiting for a translation. Its miss
+			 * in the instruction TLB starts when it attempts to fetch. */
+			if (new == thread && !can_fetch_no_tlb(core, thread))
+			{
+				for (new = (thread + 1) % cpu_threads; new != thread;
+					new = (new + 1) % cpu_threads)
+					if (can_fetch_no_tlb(core, new))
+						break;
+			}
 				
 			/* Thread switch successful? */
 			if (new != thread)
@@ -370,8 +429,7 @@ static void fetch_core(int core)
 		}
 
 		/* Fetch */
-		if (can_fetch(core, CORE.fetch_current))
-			fetch_thread(core, CORE.fetch_current);
+		fetch_thread_if_ready(core, CORE.fetch_current);
 		break;
 	}
 
@@ -20,6 +20,54 @@
 #include <cpuarch.h>
 
 
+/* Write the oldest entry of the write-combining buffer to the memory system.
+ * Return false if the data module cannot be accessed. */
+static int issue_wcb_head(int core, int thread)
+{
+	struct wcb_entry_t *entry;
+
+	entry = wcb_head(core, thread);
+	assert(entry);
+	if (!mod_can_access(THREAD.data_mod, entry->addr))
+		return 0;
+
+	/* No uop waits for the write to complete */
+	mod_access(THREAD.data_mod, mod_entry_cpu, mod_access_write,
+		entry->addr, entry->eip, NULL, NULL, NULL);
+	wcb_remove_head(core, thread);
+	THREAD.wcb_writes++;
+	cpu->active = 1;
+	return 1;
+}
+
+
+/* Drain entries of the write-combining buffer holding stores older than the
+ * last committed fence, and entries that timed out. Full buffers are drained
+ * on demand as stores issue. */
+static void issue_wcb(int core, int thread)
+{
+	struct wcb_entry_t *entry;
+
+	while ((entry = wcb_head(core, thread)))
+	{
+		if (entry->di_seq < THREAD.wcb_fence_seq)
+		{
+			if (!issue_wcb_head(core, thread))
+				break;
+			THREAD.wcb_fence_drains++;
+		}
+		else if (cpu->cycle - entry->when >= wcb_timeout)
+		{
+			if (!issue_wcb_head(core, thread))
+				break;
+			THREAD.wcb_timeout_drains++;
+		}
+		else
+			break;
+	}
+}
+
+
 static int issue_sq(int core, int thread, int quant)
 {
 	struct uop_t *store;
@@ -37,21 +85,56 @@ static int issue_sq(int core, int thread, int quant)
 		if (store->in_rob)
 			break;
 
-		/* Check that memory system entry is ready */
-		if (!mod_can_access(THREAD.data_mod, store->phy_addr))
+		/* Without a write-combining buffer, check that memory system
+		 * entry is ready. */
+		if (!wcb_size && !mod_can_access(THREAD.data_mod, store->phy_addr))
 			break;
 
+		/* Translation must be in the data TLB. It is probed before the
+		 * write-combining buffer, so that no entry is drained for a store
+		 * that waits for a TLB miss, which is started here. */
+		if (THREAD.data_tlb && !tlb_probe(THREAD.data_tlb,
+			store->ctx->mid, store->uinst->address))
+		{
+			tlb_access(THREAD.data_tlb, THREAD.data_mod,
+				store->ctx->mid, store->uinst->address);
+			break;
+		}
+
+		/* Check that the store fits in the write-combining buffer, if
+		 * any, draining its oldest entry if full. */
+		if (wcb_size && !wcb_can_insert(store))
+		{
+			if (!issue_wcb_head(core, thread))
+				break;
+			THREAD.wcb_full_drains++;
+		}
+
+		/* Access the data TLB once the store issues, counting the hit */
+		if (THREAD.data_tlb)
+			tlb_access(THREAD.data_tlb, THREAD.data_mod,
+				store->ctx->mid, store->uinst->address);
+
 		/* Remove store from store queue */
 		sq_remove(core, thread);
+		cpu->active = 1;
 
-		/* Issue store */
-		mod_access(THREAD.data_mod, mod_entry_cpu, mod_access_write,
-			store->phy_addr, NULL, CORE.eventq, store);
-
-		/* The cache system will place the store at the head of the
-		 * event queue when it is ready. For now, mark "in_eventq" to
-		 * prevent the uop from being freed. */
-		store->in_eventq = 1;
+		/* Issue store. A store written into the write-combining buffer
+		 * completes right away. Otherwise, the cache system will place
+		 * the store at the head of the event queue when it is ready.
+		 * For now, mark "in_eventq" to prevent the uop from being freed. */
+		if (wcb_size)
+		{
+			wcb_insert(store);
+			store->when = cpu->cycle;
+			eventq_insert(CORE.eventq, store);
+		}
+		else
+		{
+			mod_access(THREAD.data_mod, mod_entry_cpu, mod_access_write,
+				store->phy_addr, store->eip, NULL, CORE.eventq, store);
+			store->in_eventq = 1;
+		}
 		store->issued = 1;
 		store->issue_when = cpu->cycle;
 	
@@ -109,13 +192,22 @@ static int issue_lq(int core, int thread, int quant)
 			continue;
 		}
 
+		/* Translation must be in the data TLB */
+		if (THREAD.data_tlb && !tlb_access(THREAD.data_tlb, THREAD.data_mod,
+			load->ctx->mid, load->uinst->address))
+		{
+			linked_list_next(lq);
+			continue;
+		}
+
 		/* Remove from load queue */
 		assert(load->uinst->opcode == x86_uinst_load);
 		lq_remove(core, thread);
+		cpu->active = 1;
 
 		/* Access memory system */
 		mod_access(THREAD.data_mod, mod_entry_cpu, mod_access_read,
-			load->phy_addr, NULL, CORE.eventq, load);
+			load->phy_addr, load->eip, NULL, CORE.eventq, load);
 
 		/* The cache system will place the load at the head of the
 		 * event queue when it is ready. For now, mark "in_eventq" to
@@ -187,6 +279,7 @@ static int issue_iq(int core, int thread, int quant)
 		/* Instruction was issued to the corresponding fu.
 		 * Remove it from IQ */
 		iq_remove(core, thread);
+		cpu->active = 1;
 		
 		/* Schedule inst in Event Queue */
 		assert(!uop->in_eventq);
@@ -236,6 +329,12 @@ static int issue_thread_iq(int core, int thread, int quant)
 void issue_core(int core)
 {
 	int skip, quant;
+	int thread;
+
+	/* Drain write-combining buffers */
+	if (wcb_size)
+		FOREACH_THREAD
+			issue_wcb(core, thread);
 
 	switch (cpu_issue_kind) {
 	
@@ -52,6 +52,7 @@ void writeback_core(int core)
 		linked_list_remove(CORE.eventq);
 		uop->in_eventq = 0;
 		thread = uop->thread;
+		cpu->active = 1;
 		
 		/* If a mispredicted branch is solved and recovery is configured to be
 		 * performed at writeback, schedule it for the end of the iteration. */
@@ -79,16 +80,17 @@ void writeback_core(int core)
 		/* Recovery. This must be performed at last, because lots of uops might be
 		 * freed, which interferes with the temporary extraction from the eventq. */
 		if (recover)
+		{
+			cpu_parallel_wait(core);
 			cpu_recover(core, thread);
+		}
 	}
 }
 
 
 void cpu_writeback()
 {
-	int core;
 	cpu->stage = "writeback";
-	FOREACH_CORE
-		writeback_core(core);
+	cpu_parallel_run(writeback_core);
 }
 
@@ -92,7 +92,7 @@ void ke_init(void)
 		fatal("%s: out of memory", __FUNCTION__);
 
 	/* Event for context IPC reports */
-	EV_CTX_IPC_REPORT = esim_register_event(ctx_ipc_report_handler);
+	EV_CTX_IPC_REPORT = esim_register_event("EV_CTX_IPC_REPORT", ctx_ipc_report_handler);
 
 	/* Initialize */
 	ke->current_pid = 1000;  /* Initial assigned pid */
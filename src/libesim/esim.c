@@ -18,10 +18,12 @@
  */
 
 #include <assert.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <zlib.h>
 
 #include <debug.h>
@@ -31,44 +33,417 @@
 #include <mhandle.h>
 
 
-static int curr_event = 0;
 static int ESIM_EV_INVALID;
 static int esim_lock_schedule = 0;
 
 long long esim_cycle;
 int ESIM_EV_NONE;
 
-static struct list_t *event_handler_list;
-static struct heap_t *event_heap;
+enum esim_queue_kind_t esim_queue_kind = esim_queue_wheel;
+
+char *esim_report_file_name = "";
+
+
+/*
+ * Event Handlers
+ *
+ * Handlers are kept in a flat array indexed by event identifier. The array is
+ * built while events are registered during initialization, and frozen as soon
+ * as the first event is processed.
+ */
+
+struct esim_event_stats_t
+{
+	long long count;  /* Number of invocations */
+	long long time;  /* Host time spent in handler (nanoseconds) */
+};
+
+static esim_event_handler_t *event_handler;
+static char **event_name;
+static int event_handler_count;
+static int event_handler_size;
+static int event_handler_frozen;
+
+/* Per-event statistics, allocated only if a report was requested */
+static struct esim_event_stats_t *event_stats;
+static FILE *esim_report_file;
+
+/* Host time spent in handlers run synchronously by the handler currently
+ * being profiled, excluded from its own time. */
+static long long event_nested_time;
+
+
+static long long esim_timer(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static void esim_dispatch(int event, void *data)
+{
+	struct esim_event_stats_t *stats;
+	long long nested_time;
+	long long start;
+	long long time;
+
+	assert(event > 0 && event < event_handler_count);
+	assert(event_handler[event]);
+
+	/* No statistics */
+	if (!event_stats)
+	{
+		event_handler[event](event, data);
+		return;
+	}
+
+	/* Run handler and record statistics. Time spent in nested handlers
+	 * run with 'esim_execute_event' is charged to their own events. */
+	stats = &event_stats[event];
+	nested_time = event_nested_time;
+	event_nested_time = 0;
+	start = esim_timer();
+	event_handler[event](event, data);
+	time = esim_timer() - start;
+	stats->time += time - event_nested_time;
+	stats->count++;
+	event_nested_time = nested_time + time;
+}
+
+
+static void esim_freeze_events(void)
+{
+	if (event_handler_frozen)
+		return;
+	event_handler_frozen = 1;
+	if (esim_report_file)
+	{
+		event_stats = calloc(event_handler_count, sizeof(struct esim_event_stats_t));
+		if (!event_stats)
+			fatal("%s: out of memory", __FUNCTION__);
+	}
+}
+
+
+static void esim_dump_report(FILE *f)
+{
+	struct esim_event_stats_t *stats;
+	long long total_count = 0;
+	long long total_time = 0;
+	int name_width = 5;
+	int event;
+
+	/* Totals */
+	for (event = 0; event < event_handler_count; event++)
+	{
+		total_count += event_stats[event].count;
+		total_time += event_stats[event].time;
+		if (strlen(event_name[event]) > name_width)
+			name_width = strlen(event_name[event]);
+	}
+
+	/* Intro */
+	fprintf(f, "; Report for event-driven simulation\n");
+	fprintf(f, ";    Event - Event name given in 'esim_register_event'\n");
+	fprintf(f, ";    Count - Number of times the event handler was invoked\n");
+	fprintf(f, ";    Time - Host time spent in the event handler, in nanoseconds. This\n");
+	fprintf(f, ";        excludes other handlers run synchronously with 'esim_execute_event',\n");
+	fprintf(f, ";        which are accounted for in their own events\n");
+	fprintf(f, ";    TimePerEvent - Average host time per invocation, in nanoseconds\n");
+	fprintf(f, "\n");
+	fprintf(f, "Cycles = %lld\n", esim_cycle);
+	fprintf(f, "Events = %lld\n", total_count);
+	fprintf(f, "Time = %lld\n", total_time);
+	fprintf(f, "\n");
+
+	/* Table */
+	fprintf(f, "%-*s %14s %8s %16s %8s %12s\n", name_width, "Event",
+		"Count", "Count%", "Time", "Time%", "TimePerEvent");
+	for (event = 0; event < event_handler_count; event++)
+	{
+		stats = &event_stats[event];
+		if (!stats->count)
+			continue;
+		fprintf(f, "%-*s %14lld %8.2f %16lld %8.2f %12lld\n", name_width,
+			event_name[event], stats->count,
+			total_count ? 100.0 * stats->count / total_count : 0.0,
+			stats->time, total_time ? 100.0 * stats->time / total_time : 0.0,
+			stats->time / stats->count);
+	}
+	fprintf(f, "\n");
+}
 
 
 struct esim_event_t
 {
 	int event;
 	void *data;
+	long long when;
+
+	/* Next event in the same timing wheel bucket, or in the list of
+	 * free event records */
+	struct esim_event_t *next;
+};
+
+
+/*
+ * Event Records
+ *
+ * Event records are allocated in chunks and recycled through a free list, so
+ * scheduling and processing an event does not involve any call to malloc/free.
+ */
+
+#define ESIM_EVENT_CHUNK_SIZE  1024
+
+long long esim_scheduled_event_count;
+long long esim_processed_event_count;
+long long esim_event_record_count;
+
+static struct list_t *event_chunk_list;
+static struct esim_event_t *event_free_list;
+
+
+static struct esim_event_t *esim_event_create(void)
+{
+	struct esim_event_t *chunk;
+	struct esim_event_t *e;
+	int i;
+
+	/* Allocate new chunk of records if free list is empty */
+	if (!event_free_list)
+	{
+		chunk = malloc(ESIM_EVENT_CHUNK_SIZE * sizeof(struct esim_event_t));
+		if (!chunk)
+			fatal("%s: out of memory", __FUNCTION__);
+		list_add(event_chunk_list, chunk);
+		for (i = 0; i < ESIM_EVENT_CHUNK_SIZE; i++)
+			chunk[i].next = i < ESIM_EVENT_CHUNK_SIZE - 1 ? &chunk[i + 1] : NULL;
+		event_free_list = chunk;
+		esim_event_record_count += ESIM_EVENT_CHUNK_SIZE;
+	}
+
+	/* Take record from free list */
+	e = event_free_list;
+	event_free_list = e->next;
+	return e;
+}
+
+
+static void esim_event_free(struct esim_event_t *e)
+{
+	e->next = event_free_list;
+	event_free_list = e;
+}
+
+
+/*
+ * Event Queue
+ *
+ * Events are kept in a timing wheel with one bucket per cycle, covering cycles
+ * [wheel_cycle, wheel_cycle + wheel_size). Each bucket is a FIFO list, so
+ * events scheduled for the same cycle are processed in insertion order. Events
+ * scheduled beyond the wheel horizon are inserted into an overflow heap, and
+ * moved into their bucket as soon as the wheel advances to include their cycle.
+ * This happens before any other event can be inserted directly into the same
+ * bucket, which preserves the FIFO order of the original heap-based queue.
+ * When 'esim_queue_kind' is 'esim_queue_heap', the wheel has size 0 and all
+ * events go through the heap.
+ */
+
+#define ESIM_WHEEL_SIZE  512  /* Must be a power of 2 */
+
+struct esim_wheel_bucket_t
+{
+	struct esim_event_t *head;
+	struct esim_event_t *tail;
 };
 
+static struct esim_wheel_bucket_t *event_wheel;
+static int event_wheel_size;
+static int event_wheel_count;
+static long long event_wheel_cycle;
+
+static struct heap_t *event_heap;
+
+
+/* Append a chain of 'count' events linked through their 'next' field, all
+ * for the same cycle, into their bucket in one operation. */
+static void esim_wheel_insert_chain(struct esim_event_t *head,
+	struct esim_event_t *tail, int count)
+{
+	struct esim_wheel_bucket_t *bucket;
+
+	bucket = &event_wheel[head->when & (event_wheel_size - 1)];
+	tail->next = NULL;
+	if (bucket->tail)
+		bucket->tail->next = head;
+	else
+		bucket->head = head;
+	bucket->tail = tail;
+	event_wheel_count += count;
+}
+
+
+static void esim_wheel_insert(struct esim_event_t *e)
+{
+	esim_wheel_insert_chain(e, e, 1);
+}
+
+
+static void esim_queue_insert(struct esim_event_t *e)
+{
+	if (e->when < event_wheel_cycle + event_wheel_size)
+		esim_wheel_insert(e);
+	else
+		heap_insert(event_heap, e->when, e);
+}
+
+
+/* Advance the timing wheel so that it starts at 'cycle'. All buckets for
+ * cycles older than 'cycle' must be empty. Events in the overflow heap that
+ * fall within the new horizon are moved into the wheel. */
+static void esim_queue_advance(long long cycle)
+{
+	struct esim_event_t *e;
+	long long when;
+
+	assert(cycle >= event_wheel_cycle);
+	event_wheel_cycle = cycle;
+	while (1)
+	{
+		when = heap_peek(event_heap, (void **) &e);
+		if (heap_error(event_heap) || when >= cycle + event_wheel_size)
+			break;
+		heap_extract(event_heap, NULL);
+		esim_wheel_insert(e);
+	}
+}
+
+
+/* Extract the earliest event in the queue, as long as it is scheduled for a
+ * cycle no later than 'max_when'. Return NULL if there is no such event. */
+static struct esim_event_t *esim_queue_extract(long long max_when)
+{
+	struct esim_wheel_bucket_t *bucket;
+	struct esim_event_t *e;
+	long long cycle;
+	long long when;
+
+	/* Events in the wheel are always older than those in the heap */
+	if (event_wheel_count)
+	{
+		for (cycle = event_wheel_cycle; cycle <= max_when; cycle++)
+		{
+			bucket = &event_wheel[cycle & (event_wheel_size - 1)];
+			if (!bucket->head)
+				continue;
+
+			/* Remove from bucket head */
+			e = bucket->head;
+			assert(e->when == cycle);
+			bucket->head = e->next;
+			if (!bucket->head)
+				bucket->tail = NULL;
+			event_wheel_count--;
+			return e;
+		}
+		return NULL;
+	}
+
+	/* Overflow heap */
+	when = heap_peek(event_heap, (void **) &e);
+	if (heap_error(event_heap) || when > max_when)
+		return NULL;
+	heap_extract(event_heap, NULL);
+	return e;
+}
+
+
+
+
+/*
+ * Public Functions
+ */
 
 void esim_init()
 {
-	event_handler_list = list_create();
+	/* Report file */
+	if (*esim_report_file_name)
+	{
+		esim_report_file = fopen(esim_report_file_name, "wt");
+		if (!esim_report_file)
+			fatal("%s: cannot open event-driven simulation report file",
+				esim_report_file_name);
+	}
+
 	event_heap = heap_create(20);
-	ESIM_EV_INVALID = esim_register_event(NULL);
-	ESIM_EV_NONE = esim_register_event(NULL);
+	event_chunk_list = list_create();
+	if (esim_queue_kind == esim_queue_wheel)
+	{
+		event_wheel_size = ESIM_WHEEL_SIZE;
+		event_wheel = calloc(event_wheel_size, sizeof(struct esim_wheel_bucket_t));
+		if (!event_wheel)
+			fatal("%s: out of memory", __FUNCTION__);
+	}
+	ESIM_EV_INVALID = esim_register_event("ESIM_EV_INVALID", NULL);
+	ESIM_EV_NONE = esim_register_event("ESIM_EV_NONE", NULL);
 }
 
 
 void esim_done()
 {
-	list_free(event_handler_list);
+	struct esim_event_t *e;
+
+	int i;
+
+	/* Free pending events */
+	while ((e = esim_queue_extract(LLONG_MAX)))
+		esim_event_free(e);
+
+	/* Free chunks of event records */
+	for (i = 0; i < list_count(event_chunk_list); i++)
+		free(list_get(event_chunk_list, i));
+	list_free(event_chunk_list);
+
+	/* Dump report */
+	if (esim_report_file)
+	{
+		esim_freeze_events();
+		esim_dump_report(esim_report_file);
+		fclose(esim_report_file);
+	}
+
+	free(event_handler);
+	free(event_name);
+	free(event_stats);
 	heap_free(event_heap);
+	free(event_wheel);
 }
 
 
-int esim_register_event(esim_event_handler_t handler)
+int esim_register_event(char *name, esim_event_handler_t handler)
 {
-	list_add(event_handler_list, handler);
-	return curr_event++;
+	/* Events must be registered before simulation starts */
+	if (event_handler_frozen)
+		panic("%s: event registered after simulation started", __FUNCTION__);
+
+	/* Grow handler table */
+	if (event_handler_count == event_handler_size)
+	{
+		event_handler_size = event_handler_size ? event_handler_size * 2 : 64;
+		event_handler = realloc(event_handler, event_handler_size *
+			sizeof(esim_event_handler_t));
+		event_name = realloc(event_name, event_handler_size * sizeof(char *));
+		if (!event_handler || !event_name)
+			fatal("%s: out of memory", __FUNCTION__);
+	}
+
+	/* Add handler */
+	event_handler[event_handler_count] = handler;
+	event_name[event_handler_count] = name;
+	return event_handler_count++;
 }
 
 
@@ -82,7 +457,7 @@ void esim_schedule_event(int event, void *data, int after)
 		return;
 	
 	/* Integrity */
-	if (event < 0 || event >= list_count(event_handler_list))
+	if (event < 0 || event >= event_handler_count)
 		panic("%s: unknown event", __FUNCTION__);
 	if (when < esim_cycle)
 		panic("%s: event scheduled in the past", __FUNCTION__);
@@ -93,28 +468,85 @@ void esim_schedule_event(int event, void *data, int after)
 	if (event == ESIM_EV_NONE)
 		return;
 	
-	/* Create event */
-	e = malloc(sizeof(struct esim_event_t));
-	if (!e)
-		fatal("%s: out of memory", __FUNCTION__);
-
 	/* Initialize and insert */
+	e = esim_event_create();
 	e->event = event;
 	e->data = data;
-	heap_insert(event_heap, when, e);
+	e->when = when;
+	esim_queue_insert(e);
+	esim_scheduled_event_count++;
+}
+
+
+/* Schedule 'count' instances of 'event' for the same cycle, one for each
+ * element in 'data_list'. They are processed in the same order as if they
+ * had been scheduled with consecutive calls to 'esim_schedule_event', but
+ * the integrity checks are done once and the events are added to the
+ * timing wheel in a single operation. */
+void esim_schedule_events(int event, void **data_list, int count, int after)
+{
+	struct esim_event_t *head = NULL;
+	struct esim_event_t *tail = NULL;
+	struct esim_event_t *e;
+	uint64_t when = esim_cycle + after;
+	int i;
+
+	/* Schedule locked? */
+	if (esim_lock_schedule)
+		return;
+
+	/* Integrity */
+	if (event < 0 || event >= event_handler_count)
+		panic("%s: unknown event", __FUNCTION__);
+	if (when < esim_cycle)
+		panic("%s: event scheduled in the past", __FUNCTION__);
+	if (!event)
+		panic("%s: invalid event (forgot to call to 'esim_register_event'?)", __FUNCTION__);
+
+	/* Empty events or empty list */
+	if (event == ESIM_EV_NONE || count <= 0)
+		return;
+	esim_scheduled_event_count += count;
+
+	/* Events beyond the wheel horizon go one by one into the heap */
+	if (when >= event_wheel_cycle + event_wheel_size)
+	{
+		for (i = 0; i < count; i++)
+		{
+			e = esim_event_create();
+			e->event = event;
+			e->data = data_list[i];
+			e->when = when;
+			heap_insert(event_heap, when, e);
+		}
+		return;
+	}
+
+	/* Build chain of events and append it to the bucket */
+	for (i = 0; i < count; i++)
+	{
+		e = esim_event_create();
+		e->event = event;
+		e->data = data_list[i];
+		e->when = when;
+		if (tail)
+			tail->next = e;
+		else
+			head = e;
+		tail = e;
+	}
+	esim_wheel_insert_chain(head, tail, count);
 }
 
 
 void esim_execute_event(int event, void *data)
 {
-	esim_event_handler_t handler;
-	
 	/* Schedule locked */
 	if (esim_lock_schedule)
 		return;
 		
 	/* Integrity */
-	if (event < 0 || event >= list_count(event_handler_list))
+	if (event < 0 || event >= event_handler_count)
 		panic("%s: unkown event", __FUNCTION__);
 	if (!event)
 		panic("%s: invalid event (forgot to call to 'esim_register_event'?)", __FUNCTION__);
@@ -122,44 +554,32 @@ void esim_execute_event(int event, void *data)
 		return;
 	
 	/* execute event handler */
-	handler = list_get(event_handler_list, event);
-	assert(handler);
-	handler(event, data);
+	esim_freeze_events();
+	esim_dispatch(event, data);
 }
 
 
 /* New cycle. Process activated events */
 void esim_process_events()
 {
-	uint64_t when;
 	struct esim_event_t *e;
-	esim_event_handler_t handler;
 	
 	/* Process events scheduled for this cycle */
-	while (1)
+	esim_freeze_events();
+	while ((e = esim_queue_extract(esim_cycle)))
 	{
-		/* Extract event from heap */
-		when = heap_peek(event_heap, (void **) &e);
-		if (heap_error(event_heap))
-			break;
-		
-		/* Must process it? */
-		assert(when >= esim_cycle);
-		if (when != esim_cycle)
-			break;
-		
 		/* Process it */
-		heap_extract(event_heap, NULL);
-		handler = list_get(event_handler_list, e->event);
-		assert(handler);
-		handler(e->event, e->data);
+		assert(e->when == esim_cycle);
+		esim_processed_event_count++;
+		esim_dispatch(e->event, e->data);
 
 		/* Free event */
-		free(e);
+		esim_event_free(e);
 	}
 	
 	/* advance cycle counter */
 	esim_cycle++;
+	esim_queue_advance(esim_cycle);
 }
 
 
@@ -169,26 +589,25 @@ void esim_process_all_events(int max)
 {
 	int count = 0;
 	struct esim_event_t *e;
-	esim_event_handler_t handler;
-	long long cycle;
 	
 	/* Extract all elements from heap */
+	esim_freeze_events();
 	while (!max || count < max)
 	{
 		/* Extract event */
-		cycle = heap_extract(event_heap, (void **) &e);
-		if (heap_error(event_heap))
+		e = esim_queue_extract(LLONG_MAX);
+		if (!e)
 			break;
 		
 		/* Process it */
-		esim_cycle = cycle;
+		esim_cycle = e->when;
+		esim_queue_advance(esim_cycle);
 		count++;
-		handler = list_get(event_handler_list, e->event);
-		assert(handler);
-		handler(e->event, e->data);
+		esim_processed_event_count++;
+		esim_dispatch(e->event, e->data);
 
 		/* Free event */
-		free(e);
+		esim_event_free(e);
 	}
 }
 
@@ -196,27 +615,21 @@ void esim_process_all_events(int max)
 void esim_empty()
 {
 	struct esim_event_t *e;
-	esim_event_handler_t handler;
 	
 	/* Lock event scheduling, so no event will be
 	 * inserted into the heap */
 	esim_lock_schedule = 1;
+	esim_freeze_events();
 	
 	/* extract all elements from heap */
-	while (1)
+	while ((e = esim_queue_extract(LLONG_MAX)))
 	{
-		/* Extract event */
-		heap_extract(event_heap, (void **) &e);
-		if (heap_error(event_heap))
-			break;
-		
 		/* Process it */
-		handler = list_get(event_handler_list, e->event);
-		assert(handler);
-		handler(e->event, e->data);
+		esim_processed_event_count++;
+		esim_dispatch(e->event, e->data);
 
 		/* Free event */
-		free(e);
+		esim_event_free(e);
 	}
 	
 	/* Unlock event scheduling */
@@ -229,10 +642,10 @@ uint64_t esim_extract_event(int *pkind, void **pdata)
 	struct esim_event_t *e;
 	uint64_t when;
 	
-	/* Extract head of the heap */
+	/* Extract head of the queue */
 	assert(pkind && pdata);
-	when = heap_extract(event_heap, (void **) &e);
-	if (heap_error(event_heap)) {
+	e = esim_queue_extract(LLONG_MAX);
+	if (!e) {
 		*pkind = 0;
 		*pdata = NULL;
 		return 0;
@@ -241,16 +654,50 @@ uint64_t esim_extract_event(int *pkind, void **pdata)
 	/* Return event fields */
 	*pkind = e->event;
 	*pdata = e->data;
+	when = e->when;
 	
 	/* Free event and return success */
-	free(e);
+	esim_event_free(e);
 	return when;
 }
 
 
 int esim_pending()
 {
-	return heap_count(event_heap);
+	return event_wheel_count + heap_count(event_heap);
+}
+
+
+long long esim_next_event_cycle()
+{
+	struct esim_event_t *e;
+	long long cycle;
+	long long when;
+
+	/* Events in the wheel are always older than those in the heap */
+	if (event_wheel_count)
+	{
+		for (cycle = event_wheel_cycle; ; cycle++)
+			if (event_wheel[cycle & (event_wheel_size - 1)].head)
+				return cycle;
+	}
+
+	/* Overflow heap */
+	when = heap_peek(event_heap, (void **) &e);
+	return heap_error(event_heap) ? -1 : when;
+}
+
+
+void esim_skip_cycles(long long count)
+{
+	/* No event can be skipped */
+	assert(count >= 0);
+	assert(esim_next_event_cycle() < 0 ||
+		esim_next_event_cycle() >= esim_cycle + count);
+
+	/* Advance cycle counter */
+	esim_cycle += count;
+	esim_queue_advance(esim_cycle);
 }
 
 
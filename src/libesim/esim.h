@@ -29,6 +29,25 @@ extern long long esim_cycle;
 /* Empty event. When this event is scheduled, it will be ignored */
 extern int ESIM_EV_NONE;
 
+/* Data structure used to keep pending events */
+enum esim_queue_kind_t
+{
+	esim_queue_heap = 0,  /* Binary heap */
+	esim_queue_wheel  /* Timing wheel with overflow heap */
+};
+extern enum esim_queue_kind_t esim_queue_kind;
+
+/* Statistics: number of events scheduled, and number of event records
+ * allocated from the host to hold them */
+extern long long esim_scheduled_event_count;
+extern long long esim_event_record_count;
+
+/* Number of events processed so far */
+extern long long esim_processed_event_count;
+
+/* Report file with per-event statistics */
+extern char *esim_report_file_name;
+
 /* Procedure to handle an event */
 typedef void (*esim_event_handler_t)(int event, void *data);
 
@@ -36,10 +55,14 @@ typedef void (*esim_event_handler_t)(int event, void *data);
 void esim_init();
 void esim_done();
 
-/* Events */
-int esim_register_event(esim_event_handler_t handler);
+/* Events. The event name identifies it in the event-driven simulation report. */
+int esim_register_event(char *name, esim_event_handler_t handler);
 void esim_schedule_event(int event, void *data, int after);
 
+/* Schedule 'count' events of the same kind for the same cycle, with data
+ * taken from 'data_list', in this order */
+void esim_schedule_events(int event, void **data_list, int count, int after);
+
 /* Execute *now* an event handler synchronously; this is not the same as
  * calling esim_schedule_event with after=0, where the event will be processed
  * after all pending events for current cycle completed */
@@ -57,6 +80,13 @@ uint64_t esim_extract_event(int *event, void **data);
 /* Return number of events in the heap */
 int esim_pending();
 
+/* Return the cycle of the earliest pending event, or -1 if there is none */
+long long esim_next_event_cycle();
+
+/* Advance event simulation cycle by 'count' cycles at once. There must be
+ * no pending event scheduled within the skipped cycles. */
+void esim_skip_cycles(long long count);
+
 /* Process esim events, without enabling the schedule of a new event;
  * when all events are processed, esim heap will be empty;
  * esim_cycle is not incremented */
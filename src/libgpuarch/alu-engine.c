@@ -57,6 +57,7 @@ void gpu_alu_engine_fetch(struct gpu_compute_unit_t *compute_unit)
 		return;
 
 	/* Emulate instruction and create uop */
+	gpu->active = 1;
 	gpu_wavefront_execute(wavefront);
 	alu_group = &wavefront->alu_group;
 	uop = gpu_uop_create_from_alu_group(alu_group);
@@ -204,6 +205,7 @@ void gpu_alu_engine_decode(struct gpu_compute_unit_t *compute_unit)
 		return;
 
 	/* Extract uop from fetch queue */
+	gpu->active = 1;
 	linked_list_remove(fetch_queue);
 	compute_unit->alu_engine.fetch_queue_length -= uop->length;
 	assert(compute_unit->alu_engine.fetch_queue_length >= 0);
@@ -239,6 +241,7 @@ void gpu_alu_engine_read(struct gpu_compute_unit_t *compute_unit)
 	/* If there is no space in the execution buffer, done */
 	if (compute_unit->alu_engine.exec_buffer)
 		return;
+	gpu->active = 1;
 	
 	/* If instruction reads from local memory, do it here. */
 	if (uop->local_mem_read)
@@ -252,7 +255,7 @@ void gpu_alu_engine_read(struct gpu_compute_unit_t *compute_unit)
 				if (work_item_uop->local_mem_access_kind[i] != 1)  /* read access */
 					continue;
 				mod_access(compute_unit->local_memory, mod_entry_gpu,
-					mod_access_read, work_item_uop->local_mem_access_addr[i],
+					mod_access_read, work_item_uop->local_mem_access_addr[i], 0,
 					&uop->local_mem_witness, NULL, NULL);
 				uop->local_mem_witness--;
 			}
@@ -272,9 +275,35 @@ void gpu_alu_engine_read(struct gpu_compute_unit_t *compute_unit)
 }
 
 
-void gpu_alu_engine_execute(struct gpu_compute_unit_t *compute_unit)
+/* Return true if all local memory banks written by the work-items of 'uop'
+ * have a free port. Local memory is word-interleaved across banks. */
+static int gpu_alu_engine_can_write_local_mem(struct gpu_compute_unit_t *compute_unit,
+	struct gpu_uop_t *uop)
 {
 	struct mod_t *local_memory = compute_unit->local_memory;
+	struct gpu_work_item_t *work_item;
+	struct gpu_work_item_uop_t *work_item_uop;
+	int work_item_id;
+	int i;
+
+	FOREACH_WORK_ITEM_IN_WAVEFRONT(uop->wavefront, work_item_id)
+	{
+		work_item = gpu->ndrange->work_items[work_item_id];
+		work_item_uop = &uop->work_item_uop[work_item->id_in_wavefront];
+		for (i = 0; i < work_item_uop->local_mem_access_count; i++)
+		{
+			if (work_item_uop->local_mem_access_kind[i] != mod_access_write)
+				continue;
+			if (!mod_can_access(local_memory, work_item_uop->local_mem_access_addr[i]))
+				return 0;
+		}
+	}
+	return 1;
+}
+
+
+void gpu_alu_engine_execute(struct gpu_compute_unit_t *compute_unit)
+{
 	struct gpu_uop_t *uop;
 
 	/* Get uop from execution buffer.
@@ -283,8 +312,9 @@ void gpu_alu_engine_execute(struct gpu_compute_unit_t *compute_unit)
 	if (!uop || uop->local_mem_witness)
 		return;
 	
-	/* If instruction writes to local memory, check that module is available. */
-	if (uop->local_mem_write && !mod_can_access(local_memory, 0))
+	/* If instruction writes to local memory, check that the banks it
+	 * accesses are available. */
+	if (uop->local_mem_write && !gpu_alu_engine_can_write_local_mem(compute_unit, uop))
 		return;
 	
 	/* One more SubWF launched for execution for uop.
@@ -293,6 +323,7 @@ void gpu_alu_engine_execute(struct gpu_compute_unit_t *compute_unit)
 	 * accept a new instruction every cycle, so no contention. */
 	assert(uop->exec_subwavefront_count < uop->subwavefront_count);
 	uop->exec_subwavefront_count++;
+	gpu->active = 1;
 	heap_insert(compute_unit->alu_engine.event_queue,
 		gpu->cycle + gpu_alu_engine_pe_latency,
 		uop);
@@ -336,6 +367,7 @@ void gpu_alu_engine_write(struct gpu_compute_unit_t *compute_unit)
 		assert(cycle == gpu->cycle);
 		wavefront = uop->wavefront;
 		heap_extract(compute_unit->alu_engine.event_queue, NULL);
+		gpu->active = 1;
 
 		/* If instruction writes to local memory, do it here. */
 		if (uop->local_mem_write)
@@ -349,7 +381,7 @@ void gpu_alu_engine_write(struct gpu_compute_unit_t *compute_unit)
 					if (work_item_uop->local_mem_access_kind[i] != mod_access_write)
 						continue;
 					mod_access(compute_unit->local_memory, mod_entry_gpu,
-						mod_access_write, work_item_uop->local_mem_access_addr[i],
+						mod_access_write, work_item_uop->local_mem_access_addr[i], 0,
 						NULL, NULL, NULL);
 				}
 			}
@@ -44,6 +44,7 @@ void gpu_cf_engine_fetch(struct gpu_compute_unit_t *compute_unit)
 		return;
 
 	/* Emulate CF instruction */
+	gpu->active = 1;
 	gpu_wavefront_execute(wavefront);
 	inst = &wavefront->cf_inst;
 
@@ -142,6 +143,7 @@ void gpu_cf_engine_decode(struct gpu_compute_unit_t *compute_unit)
 	}
 
 	/* Decode instruction */
+	gpu->active = 1;
 	compute_unit->cf_engine.fetch_buffer[index] = NULL;
 	compute_unit->cf_engine.inst_buffer[index] = uop;
 
@@ -196,6 +198,7 @@ void gpu_cf_engine_execute(struct gpu_compute_unit_t *compute_unit)
 	wavefront = uop->wavefront;
 	ndrange = wavefront->ndrange;
 	compute_unit->cf_engine.inst_buffer[index] = NULL;
+	gpu->active = 1;
 
 	/* Execute instruction */
 	if (uop->alu_clause_trigger)
@@ -224,7 +227,7 @@ void gpu_cf_engine_execute(struct gpu_compute_unit_t *compute_unit)
 				work_item = ndrange->work_items[work_item_id];
 				work_item_uop = &uop->work_item_uop[work_item->id_in_wavefront];
 				mod_access(compute_unit->global_memory, mod_entry_gpu,
-					mod_access_nc_write, work_item_uop->global_mem_access_addr,
+					mod_access_nc_write, work_item_uop->global_mem_access_addr, 0,
 					&uop->global_mem_witness, NULL, NULL);
 				uop->global_mem_witness--;
 			}
@@ -265,6 +268,7 @@ void gpu_cf_engine_complete(struct gpu_compute_unit_t *compute_unit)
 
 		/* Extract from complete queue */
 		linked_list_remove(complete_queue);
+		gpu->active = 1;
 
 		/* Instruction finishes a wavefront */
 		if (uop->last)
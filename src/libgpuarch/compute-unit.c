@@ -43,7 +43,9 @@ struct gpu_compute_unit_t *gpu_compute_unit_create()
 	/* Local memory */
 	snprintf(buf, sizeof buf, "LocalMemory[%d]", compute_unit->id);
 	compute_unit->local_memory = mod_create(buf, mod_kind_main_memory,
-		gpu_local_mem_num_ports, gpu_local_mem_block_size, gpu_local_mem_latency);
+		gpu_local_mem_num_banks, gpu_local_mem_num_ports,
+		gpu_local_mem_block_size, gpu_local_mem_latency);
+	compute_unit->local_memory->bank_select = mod_bank_select_word;
 
 	/* Initialize CF Engine */
 	compute_unit->cf_engine.complete_queue = linked_list_create();
@@ -17,6 +17,7 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <limits.h>
 #include <gpukernel.h>
 #include <gpuarch.h>
 #include <cpukernel.h>
@@ -86,7 +87,12 @@ char *gpu_config_help =
 	"      Access block size, used for access coalescing purposes among work-items.\n"
 	"  Latency = <num_cycles> (Default = 2)\n"
 	"      Hit latency in number of cycles.\n"
+	"  Banks = <num> (Default = 1)\n"
+	"      Number of banks, interleaved every 4-byte word. Accesses can only use the\n"
+	"      ports of the bank of their address, so work-items accessing different words\n"
+	"      of the same bank conflict.\n"
 	"  Ports = <num> (Default = 4)\n"
+	"      Number of ports per bank.\n"
 	"\n"
 	"Section '[ CFEngine ]': parameters for the CF Engine of the Compute Units.\n"
 	"\n"
@@ -143,6 +149,7 @@ int gpu_local_mem_size = 32768;  /* 32 KB */
 int gpu_local_mem_alloc_size = 1024;  /* 1 KB */
 int gpu_local_mem_latency = 2;
 int gpu_local_mem_block_size = 256;
+int gpu_local_mem_num_banks = 1;
 int gpu_local_mem_num_ports = 2;
 
 struct gpu_t *gpu;
@@ -241,6 +248,7 @@ void gpu_config_read(void)
 	gpu_local_mem_alloc_size = config_read_int(gpu_config, section, "AllocSize", gpu_local_mem_alloc_size);
 	gpu_local_mem_block_size = config_read_int(gpu_config, section, "BlockSize", gpu_local_mem_block_size);
 	gpu_local_mem_latency = config_read_int(gpu_config, section, "Latency", gpu_local_mem_latency);
+	gpu_local_mem_num_banks = config_read_int(gpu_config, section, "Banks", gpu_local_mem_num_banks);
 	gpu_local_mem_num_ports = config_read_int(gpu_config, section, "Ports", gpu_local_mem_num_ports);
 	if ((gpu_local_mem_size & (gpu_local_mem_size - 1)) || gpu_local_mem_size < 4)
 		fatal("%s: %s->Size must be a power of two and at least 4.\n%s",
@@ -258,6 +266,11 @@ void gpu_config_read(void)
 			section, section, err_note);
 	if (gpu_local_mem_latency < 1)
 		fatal("%s: invalid value for %s->Latency.\n%s", gpu_config_file_name, section, err_note);
+	if (gpu_local_mem_num_banks < 1 || (gpu_local_mem_num_banks & (gpu_local_mem_num_banks - 1)))
+		fatal("%s: %s->Banks must be a power of two.\n%s",
+			gpu_config_file_name, section, err_note);
+	if (gpu_local_mem_num_ports < 1)
+		fatal("%s: invalid value for %s->Ports.\n%s", gpu_config_file_name, section, err_note);
 	if (gpu_local_mem_size < gpu_local_mem_block_size)
 		fatal("%s: %s->Size cannot be smaller than %s->BlockSize * %s->Banks.\n%s", gpu_config_file_name,
 			section, section, section, err_note);
@@ -332,6 +345,7 @@ void gpu_config_dump(FILE *f)
 	fprintf(f, "AllocSize = %d\n", gpu_local_mem_alloc_size);
 	fprintf(f, "BlockSize = %d\n", gpu_local_mem_block_size);
 	fprintf(f, "Latency = %d\n", gpu_local_mem_latency);
+	fprintf(f, "Banks = %d\n", gpu_local_mem_num_banks);
 	fprintf(f, "Ports = %d\n", gpu_local_mem_num_ports);
 	fprintf(f, "\n");
 
@@ -504,6 +518,7 @@ void gpu_dump_report(void)
 		fprintf(f, "LocalMemory.Writes = %lld\n", local_mod->writes);
 		fprintf(f, "LocalMemory.EffectiveWrites = %lld\n", local_mod->effective_writes);
 		fprintf(f, "LocalMemory.CoalescedWrites = %lld\n", coalesced_writes);
+		fprintf(f, "LocalMemory.BankConflicts = %lld\n", local_mod->bank_conflicts);
 		fprintf(f, "\n\n");
 	}
 }
@@ -709,10 +724,98 @@ void gpu_pipeline_debug_intro(struct gpu_ndrange_t *ndrange)
 }
 
 
+/* Return the number of cycles that can be skipped after the current cycle.
+ * This is only possible if no compute unit changed its state and no event was
+ * processed in the current cycle. The following cycles are then exact copies of
+ * the current one until an event is processed, or an instruction completes its
+ * fetch or execution latency. */
+static long long gpu_idle_cycles(void)
+{
+	struct gpu_compute_unit_t *compute_unit;
+	struct gpu_uop_t *uop;
+	long long cycle;
+	long long when;
+
+	/* Current cycle must be idle. Faults are inserted at specific cycles,
+	 * and the pipeline trace dumps every cycle. */
+	if (gpu->active || ke_sim_finish || *gpu_faults_file_name ||
+		debug_status(gpu_pipeline_debug_category))
+		return 0;
+
+	/* First cycle that needs to be simulated */
+	cycle = LLONG_MAX;
+	when = esim_next_event_cycle();
+	if (when >= 0)
+		cycle = gpu->cycle + 1 + when - esim_cycle;
+
+	/* Instructions in flight in compute units */
+	for (compute_unit = gpu->busy_list_head; compute_unit;
+		compute_unit = compute_unit->busy_list_next)
+	{
+		/* ALU Engine instruction fetch and execution */
+		linked_list_head(compute_unit->alu_engine.fetch_queue);
+		uop = linked_list_get(compute_unit->alu_engine.fetch_queue);
+		if (uop && uop->inst_mem_ready > gpu->cycle)
+			cycle = MIN(cycle, uop->inst_mem_ready);
+		when = heap_peek(compute_unit->alu_engine.event_queue, (void **) &uop);
+		if (uop)
+			cycle = MIN(cycle, when);
+
+		/* TEX Engine instruction fetch */
+		linked_list_head(compute_unit->tex_engine.fetch_queue);
+		uop = linked_list_get(compute_unit->tex_engine.fetch_queue);
+		if (uop && uop->inst_mem_ready > gpu->cycle)
+			cycle = MIN(cycle, uop->inst_mem_ready);
+	}
+
+	/* Maximum number of cycles checked at the beginning of a cycle */
+	if (gpu_max_cycles)
+		cycle = MIN(cycle, gpu_max_cycles);
+
+	/* Nothing to wait for */
+	if (cycle == LLONG_MAX)
+		return 0;
+	return MAX(cycle - gpu->cycle - 1, 0);
+}
+
+
+/* Skip idle cycles after the current cycle, if possible. Statistics are
+ * updated as if the skipped cycles had been simulated. */
+static void gpu_skip_idle_cycles(void)
+{
+	struct gpu_compute_unit_t *compute_unit;
+	long long count;
+
+	/* Number of cycles to skip */
+	count = gpu_idle_cycles();
+	if (!count)
+		return;
+
+	/* Statistics. ALU and TEX Engines count cycles only when they
+	 * have a clause assigned. */
+	for (compute_unit = gpu->busy_list_head; compute_unit;
+		compute_unit = compute_unit->busy_list_next)
+	{
+		compute_unit->cycle += count;
+		if (linked_list_count(compute_unit->alu_engine.pending_queue) ||
+			linked_list_count(compute_unit->alu_engine.finished_queue))
+			compute_unit->alu_engine.cycle += count;
+		if (linked_list_count(compute_unit->tex_engine.pending_queue) ||
+			linked_list_count(compute_unit->tex_engine.finished_queue))
+			compute_unit->tex_engine.cycle += count;
+	}
+
+	/* Advance cycle */
+	gpu->cycle += count;
+	esim_skip_cycles(count);
+}
+
+
 void gpu_run(struct gpu_ndrange_t *ndrange)
 {
 	struct gpu_compute_unit_t *compute_unit;
 	struct gpu_compute_unit_t *compute_unit_next;
+	long long event_count;
 
 	/* Debug */
 	if (debug_status(gpu_pipeline_debug_category))
@@ -756,6 +859,8 @@ void gpu_run(struct gpu_ndrange_t *ndrange)
 			break;
 
 		/* Advance one cycle on each busy compute unit */
+		gpu->active = 0;
+		event_count = esim_processed_event_count;
 		for (compute_unit = gpu->busy_list_head; compute_unit;
 			compute_unit = compute_unit_next)
 		{
@@ -772,6 +877,10 @@ void gpu_run(struct gpu_ndrange_t *ndrange)
 		
 		/* Event-driven module */
 		esim_process_events();
+
+		/* Skip following cycles if nothing happened in this one */
+		if (esim_processed_event_count == event_count)
+			gpu_skip_idle_cycles();
 	}
 
 	/* Finalize */
@@ -64,6 +64,7 @@ extern int gpu_local_mem_size;
 extern int gpu_local_mem_alloc_size;
 extern int gpu_local_mem_latency;
 extern int gpu_local_mem_block_size;
+extern int gpu_local_mem_num_banks;
 extern int gpu_local_mem_num_ports;
 
 extern int gpu_cf_engine_inst_mem_latency;
@@ -386,6 +387,7 @@ struct gpu_t
 {
 	/* Current cycle */
 	long long cycle;
+	int active;  /* Some compute unit changed its state in the current cycle */
 
 	/* ND-Range running on it */
 	struct gpu_ndrange_t *ndrange;
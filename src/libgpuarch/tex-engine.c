@@ -57,6 +57,7 @@ void gpu_tex_engine_fetch(struct gpu_compute_unit_t *compute_unit)
 		return;
 	
 	/* Emulate instruction and create uop */
+	gpu->active = 1;
 	inst_num = (wavefront->clause_buf - wavefront->clause_buf_start) / 16;
 	gpu_wavefront_execute(wavefront);
 	inst = &wavefront->tex_inst;
@@ -146,6 +147,7 @@ void gpu_tex_engine_decode(struct gpu_compute_unit_t *compute_unit)
 		return;
 
 	/* Extract uop from fetch queue */
+	gpu->active = 1;
 	linked_list_remove(fetch_queue);
 	compute_unit->tex_engine.fetch_queue_length -= uop->length;
 	assert(compute_unit->tex_engine.fetch_queue_length >= 0);
@@ -181,6 +183,7 @@ void gpu_tex_engine_read(struct gpu_compute_unit_t *compute_unit)
 		return;
 	
 	/* Extract uop from instruction buffer and insert into load queue. */
+	gpu->active = 1;
 	compute_unit->tex_engine.inst_buffer = NULL;
 	linked_list_out(compute_unit->tex_engine.load_queue);
 	linked_list_insert(compute_unit->tex_engine.load_queue, uop);
@@ -194,7 +197,7 @@ void gpu_tex_engine_read(struct gpu_compute_unit_t *compute_unit)
 			work_item = gpu->ndrange->work_items[work_item_id];
 			work_item_uop = &uop->work_item_uop[work_item->id_in_wavefront];
 			mod_access(compute_unit->global_memory, mod_entry_gpu,
-				mod_access_read, work_item_uop->global_mem_access_addr,
+				mod_access_read, work_item_uop->global_mem_access_addr, 0,
 				&uop->global_mem_witness, NULL, NULL);
 			uop->global_mem_witness--;
 		}
@@ -226,6 +229,7 @@ void gpu_tex_engine_write(struct gpu_compute_unit_t *compute_unit)
 		return;
 
 	/* Extract from load queue. */
+	gpu->active = 1;
 	linked_list_remove(compute_unit->tex_engine.load_queue);
 
 	/* Debug */
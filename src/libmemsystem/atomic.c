@@ -0,0 +1,690 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2011  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <mem-system.h>
+
+
+/*
+ * Atomic Accesses
+ *
+ * The functions in this file apply the same changes to cache tags,
+ * replacement state, and directories as the event-driven NMOESI protocol in
+ * 'cpu-coherence.c', but synchronously. There are no concurrent accesses, so
+ * no port or directory entry is ever locked, no access is retried, and no
+ * message is sent through the interconnects. Each static function below
+ * corresponds to one of the event handlers in the detailed model, and the
+ * comments refer to the events whose actions are reproduced.
+ *
+ * Each function returns an estimate of its latency in cycles. Looking up a
+ * block costs the latency of the module. Requests to a lower level, and
+ * evictions, are serialized with the lookup, while requests sent to several
+ * upper-level modules at the same time overlap, costing the latency of the
+ * slowest one. The latency of the interconnects is not modeled.
+ */
+
+static int mod_atomic_evict(struct mod_t *mod, uint32_t set, uint32_t way,
+	int data_only);
+static int mod_atomic_invalidate(struct mod_t *mod, uint32_t set, uint32_t way,
+	struct mod_t *except_mod);
+
+
+/* Accesses bringing the data of the block they look for into a non-inclusive
+ * cache, needing a data frame */
+enum mod_atomic_fill_t
+{
+	mod_atomic_fill_none = 0,
+	mod_atomic_fill_miss = 1,  /* Data brought on misses */
+	mod_atomic_fill_dropped = 2,  /* Data brought on hits of blocks with no data */
+	mod_atomic_fill_always = 3
+};
+
+
+/* Return 1 if the sub-block of a lower-level module starting at 'dir_entry_tag'
+ * is part of the block of upper-level module 'mod' starting at 'addr'. */
+static int mod_atomic_sub_block_in_range(struct mod_t *mod, uint32_t addr,
+	uint32_t dir_entry_tag)
+{
+	return dir_entry_tag >= addr && dir_entry_tag < addr + mod->block_size;
+}
+
+
+/* Return the upper-level module connected to node 'index' of the high
+ * interconnect of 'mod'. */
+static struct mod_t *mod_atomic_high_mod(struct mod_t *mod, int index)
+{
+	struct net_node_t *node;
+
+	node = list_get(mod->high_net->node_list, index);
+	assert(node && node->kind == net_node_end);
+	return node->user_data;
+}
+
+
+/* EV_MOD_FIND_AND_LOCK. Look for a block, and evict a victim on a miss. If the
+ * block is not found and 'replace' is not set, return -1 without changing the
+ * cache. Otherwise, return the latency of the lookup and eviction, together
+ * with the set and way of the block in the cache, and its current state.
+ * Argument 'fill' tells whether the access brings the data of the block into a
+ * non-inclusive cache, which reserves a frame for it, to be filled by the
+ * caller with 'mod_fill_data'. */
+static int mod_atomic_find_block(struct mod_t *mod, uint32_t addr, int replace,
+	enum mod_atomic_fill_t fill, uint32_t *set_ptr, uint32_t *way_ptr,
+	uint32_t *tag_ptr, int *state_ptr)
+{
+	int latency;
+	int hit;
+	int need_data;
+	int data_way;
+
+	/* Look for block */
+	hit = mod_find_block(mod, addr, set_ptr, way_ptr, tag_ptr, state_ptr);
+	if (!hit && !replace)
+		return -1;
+
+	/* Statistics */
+	latency = mod->latency;
+	mod->atomic_accesses++;
+	if (hit)
+		mod->atomic_hits++;
+	if (mod->sdist)
+		sdist_access(mod->sdist, addr);
+
+	/* Find victim */
+	if (!hit)
+	{
+		*way_ptr = mod_replace_block(mod, *set_ptr);
+		cache_get_block(mod->cache, *set_ptr, *way_ptr, NULL, state_ptr);
+	}
+
+	/* Data frame of a non-inclusive cache. On a miss, a block taking a frame
+	 * is replaced instead of the victim. On a hit, the data of another block
+	 * is evicted. Frames reserved by detailed accesses are released, and the
+	 * frame is reserved before any eviction, as in FIND_AND_LOCK. */
+	need_data = 0;
+	if (mod->cache->data)
+	{
+		cache_set_data(mod->cache, *set_ptr, *way_ptr, cache_get_data(mod->cache,
+			*set_ptr, *way_ptr) & ~CACHE_DATA_RESERVED);
+		need_data = hit ? (fill & mod_atomic_fill_dropped) &&
+			!cache_block_has_data(mod->cache, *set_ptr, *way_ptr) :
+			(fill & mod_atomic_fill_miss);
+	}
+	data_way = -1;
+	if (need_data && !mod_find_data_frame(mod, *set_ptr, *way_ptr, hit, &data_way))
+	{
+		assert(data_way >= 0);
+		if (!hit)
+		{
+			*way_ptr = data_way;
+			cache_get_block(mod->cache, *set_ptr, *way_ptr, NULL, state_ptr);
+			data_way = -1;
+		}
+	}
+	if (need_data)
+		mod_reserve_data(mod, *set_ptr, *way_ptr);
+	if (data_way >= 0)
+	{
+		mod->data_evictions++;
+		latency += mod_atomic_evict(mod, *set_ptr, data_way, 1);
+	}
+
+	/* Update replacement state */
+	cache_access_block(mod->cache, *set_ptr, *way_ptr);
+
+	/* Evict victim */
+	if (!hit && *state_ptr)
+	{
+		mod->atomic_evictions++;
+		latency += mod_atomic_evict(mod, *set_ptr, *way_ptr, 0);
+		cache_get_block(mod->cache, *set_ptr, *way_ptr, NULL, state_ptr);
+		assert(!*state_ptr);
+	}
+
+	/* In main memory, a miss is just a miss in the directory */
+	if (mod->kind == mod_kind_main_memory && !*state_ptr)
+	{
+		*state_ptr = cache_block_exclusive;
+		cache_set_block(mod->cache, *set_ptr, *way_ptr, *tag_ptr, *state_ptr);
+	}
+	return latency;
+}
+
+
+/* Make sectors 'sectors' of a block valid, and also dirty if 'dirty' is set,
+ * without recording sector fills. */
+static void mod_atomic_set_sectors(struct mod_t *mod, uint32_t set, uint32_t way,
+	uint32_t sectors, int dirty)
+{
+	uint32_t valid_sectors;
+	uint32_t dirty_sectors;
+
+	cache_get_sectors(mod->cache, set, way, &valid_sectors, &dirty_sectors);
+	cache_set_sectors(mod->cache, set, way, valid_sectors | sectors,
+		dirty ? dirty_sectors | sectors : dirty_sectors);
+}
+
+
+/* EV_MOD_SECTOR_FILL. Bring sectors 'sectors' of the block of 'mod' at address
+ * 'addr', present in its 'set' and 'way', from the lower level, bringing them
+ * into the lower level first if they are missing there too. */
+static int mod_atomic_sector_fill(struct mod_t *mod, uint32_t set, uint32_t way,
+	uint32_t addr, uint32_t sectors)
+{
+	struct mod_t *target_mod;
+
+	uint32_t target_set, target_way, target_tag;
+	uint32_t valid_sectors, needed_sectors;
+	int target_state;
+	int latency;
+
+	/* Tags are inclusive, so the block is in the lower level */
+	target_mod = mod_get_low_mod(mod, addr);
+	latency = mod_atomic_find_block(target_mod, addr, 0, mod_atomic_fill_none,
+		&target_set, &target_way, &target_tag, &target_state);
+	if (latency < 0)
+		latency = 0;
+	else
+	{
+		cache_get_sectors(target_mod->cache, target_set, target_way,
+			&valid_sectors, NULL);
+		needed_sectors = mod_get_request_sectors(target_mod, mod, addr, sectors);
+		if (needed_sectors & ~valid_sectors)
+		{
+			latency += mod_atomic_sector_fill(target_mod, target_set,
+				target_way, target_tag, needed_sectors & ~valid_sectors);
+		}
+	}
+	mod_atomic_set_sectors(mod, set, way, sectors, 0);
+	return latency;
+}
+
+
+/* EV_MOD_READ_REQUEST with down-up direction. Make the copy of the block in
+ * 'target_mod' (and its upper levels) lose its ownership. */
+static int mod_atomic_read_request_downup(struct mod_t *target_mod, uint32_t addr)
+{
+	struct dir_t *dir;
+	struct dir_entry_t *dir_entry;
+	struct mod_t *owner;
+
+	uint32_t set, way, tag;
+	uint32_t dir_entry_tag, z;
+	int state;
+
+	int latency;
+	int owner_latency;
+	int request_latency;
+
+	/* The directory of the lower level guarantees that the block is here */
+	latency = mod_atomic_find_block(target_mod, addr, 0, mod_atomic_fill_none,
+		&set, &way, &tag, &state);
+	if (latency < 0)
+		return 0;
+	assert(state != cache_block_invalid && state != cache_block_shared);
+
+	/* Forward read request to the owners of all sub-blocks */
+	owner_latency = 0;
+	dir = target_mod->dir;
+	for (z = 0; z < dir->zsize; z++)
+	{
+		dir_entry_tag = tag + z * target_mod->sub_block_size;
+		dir_entry = dir_entry_get(dir, set, way, z);
+		if (!DIR_ENTRY_VALID_OWNER(dir_entry))
+			continue;
+		owner = mod_atomic_high_mod(target_mod, dir_entry->owner);
+		if (dir_entry_tag % owner->block_size)
+			continue;
+		request_latency = mod_atomic_read_request_downup(owner, dir_entry_tag);
+		owner_latency = MAX(owner_latency, request_latency);
+	}
+
+	/* EV_MOD_READ_REQUEST_DOWNUP_FINISH. M becomes O, E becomes S. */
+	if (state == cache_block_modified)
+	{
+		cache_set_block(target_mod->cache, set, way, tag, cache_block_owned);
+	}
+	else if (state == cache_block_exclusive)
+	{
+		for (z = 0; z < dir->zsize; z++)
+			dir_entry_set_owner(dir, set, way, z, DIR_ENTRY_OWNER_NONE);
+		cache_set_block(target_mod->cache, set, way, tag, cache_block_shared);
+	}
+	dir_group_release_if_empty(dir, set, way);
+	return latency + owner_latency;
+}
+
+
+/* EV_MOD_READ_REQUEST with up-down direction. Bring the block of 'mod' at
+ * address 'addr' into 'target_mod', the lower-level module, and record 'mod'
+ * as a sharer in its directory. Set 'shared_ptr' if the block is shared by
+ * other modules, in which case 'mod' cannot own it. Only the sectors of 'mod'
+ * given by mask 'sectors' are brought, or the whole block if it is 0. */
+static int mod_atomic_read_request_updown(struct mod_t *mod, struct mod_t *target_mod,
+	uint32_t addr, uint32_t sectors, int *shared_ptr)
+{
+	struct dir_t *dir;
+	struct dir_entry_t *dir_entry;
+	struct mod_t *owner;
+
+	uint32_t set, way, tag;
+	uint32_t dir_entry_tag, z;
+	int state;
+	int shared;
+	int refetch;
+
+	uint32_t valid_sectors;
+	uint32_t needed_sectors;
+
+	int latency;
+	int owner_latency;
+	int request_latency;
+
+	/* Find block in lower level */
+	latency = mod_atomic_find_block(target_mod, addr, 1,
+		target_mod->inclusion == mod_inclusion_non_inclusive ?
+		mod_atomic_fill_always : mod_atomic_fill_dropped,
+		&set, &way, &tag, &state);
+	needed_sectors = mod_get_request_sectors(target_mod, mod, addr, sectors);
+	dir = target_mod->dir;
+	if (state)
+	{
+		/* A clean block whose data was dropped in a non-inclusive cache, with
+		 * no upper-level owner to provide it, is brought again as on a miss,
+		 * while owners are downgraded. */
+		refetch = (state == cache_block_shared || state == cache_block_exclusive) &&
+			!cache_block_has_data(target_mod->cache, set, way) &&
+			!mod_owner_has_data(target_mod, set, way);
+
+
+		/* EV_MOD_SECTOR_FILL for sectors missing in the lower level */
+		cache_get_sectors(target_mod->cache, set, way, &valid_sectors, NULL);
+		if (needed_sectors & ~valid_sectors)
+			latency += mod_atomic_sector_fill(target_mod, set, way, tag,
+				needed_sectors & ~valid_sectors);
+
+		/* Send read request to owners other than mod */
+		owner_latency = 0;
+		for (z = 0; z < dir->zsize; z++)
+		{
+			dir_entry = dir_entry_get(dir, set, way, z);
+			dir_entry_tag = tag + z * target_mod->sub_block_size;
+			if (!DIR_ENTRY_VALID_OWNER(dir_entry))
+				continue;
+			if (dir_entry->owner == mod->low_net_node->index)
+				continue;
+			owner = mod_atomic_high_mod(target_mod, dir_entry->owner);
+			if (dir_entry_tag % owner->block_size)
+				continue;
+			request_latency = mod_atomic_read_request_downup(owner,
+				dir_entry_tag);
+			owner_latency = MAX(owner_latency, request_latency);
+		}
+		if (refetch)
+		{
+			request_latency = mod_atomic_read_request_updown(target_mod,
+				mod_get_low_mod(target_mod, tag), tag, needed_sectors, &shared);
+			owner_latency = MAX(owner_latency, request_latency);
+			cache_set_block(target_mod->cache, set, way, tag,
+				shared ? cache_block_shared : cache_block_exclusive);
+		}
+		latency += owner_latency;
+	}
+	else
+	{
+		/* EV_MOD_READ_REQUEST_UPDOWN_MISS */
+		latency += mod_atomic_read_request_updown(target_mod,
+			mod_get_low_mod(target_mod, tag), tag, needed_sectors, &shared);
+		cache_set_block(target_mod->cache, set, way, tag,
+			shared ? cache_block_shared : cache_block_exclusive);
+		mod_atomic_set_sectors(target_mod, set, way, needed_sectors, 0);
+	}
+
+	/* EV_MOD_READ_REQUEST_UPDOWN_FINISH. Clear owners other than mod. */
+	for (z = 0; z < dir->zsize; z++)
+	{
+		dir_entry = dir_entry_get(dir, set, way, z);
+		if (dir_entry->owner != mod->low_net_node->index)
+			dir_entry_set_owner(dir, set, way, z, DIR_ENTRY_OWNER_NONE);
+	}
+
+	/* Set mod as sharer of the requested sub-blocks */
+	shared = 0;
+	for (z = 0; z < dir->zsize; z++)
+	{
+		dir_entry_tag = tag + z * target_mod->sub_block_size;
+		if (!mod_atomic_sub_block_in_range(mod, addr, dir_entry_tag))
+			continue;
+		dir_entry = dir_entry_get(dir, set, way, z);
+		dir_entry_set_sharer(dir, set, way, z, mod->low_net_node->index);
+		if (dir_entry->num_sharers > 1)
+			shared = 1;
+	}
+
+	/* If not shared, mod owns all of them */
+	if (!shared)
+	{
+		for (z = 0; z < dir->zsize; z++)
+		{
+			dir_entry_tag = tag + z * target_mod->sub_block_size;
+			if (!mod_atomic_sub_block_in_range(mod, addr, dir_entry_tag))
+				continue;
+			dir_entry_set_owner(dir, set, way, z, mod->low_net_node->index);
+		}
+	}
+
+	/* Data brought into a non-inclusive cache, dropped by an exclusive cache
+	 * once mod owns the block */
+	mod_fill_data(target_mod, set, way);
+	if (!shared && target_mod->inclusion == mod_inclusion_exclusive)
+		mod_drop_data(target_mod, set, way);
+	*shared_ptr = shared;
+	dir_group_release_if_empty(dir, set, way);
+	return latency;
+}
+
+
+/* EV_MOD_WRITE_REQUEST with down-up direction. Invalidate the block in
+ * 'target_mod' and all its upper levels. */
+static int mod_atomic_write_request_downup(struct mod_t *target_mod, uint32_t addr)
+{
+	uint32_t set, way, tag;
+	int state;
+	int latency;
+
+	/* The directory of the lower level guarantees that the block is here */
+	latency = mod_atomic_find_block(target_mod, addr, 0, mod_atomic_fill_none,
+		&set, &way, &tag, &state);
+	if (latency < 0)
+		return 0;
+	assert(state != cache_block_invalid);
+
+	/* EV_MOD_WRITE_REQUEST_ACTION and EV_MOD_WRITE_REQUEST_DOWNUP_FINISH */
+	latency += mod_atomic_invalidate(target_mod, set, way, NULL);
+	cache_set_block(target_mod->cache, set, way, 0, cache_block_invalid);
+	return latency;
+}
+
+
+/* EV_MOD_WRITE_REQUEST with up-down direction. Bring the block of 'mod' at
+ * address 'addr' into 'target_mod' in an exclusive state, invalidating all
+ * other copies, and record 'mod' as its only sharer and owner. Argument
+ * 'sectors' is the mask of the sectors of 'mod' brought, 0 for all. */
+static int mod_atomic_write_request_updown(struct mod_t *mod, struct mod_t *target_mod,
+	uint32_t addr, uint32_t sectors)
+{
+	struct dir_t *dir;
+
+	uint32_t set, way, tag;
+	uint32_t dir_entry_tag, z;
+	uint32_t valid_sectors;
+	uint32_t needed_sectors;
+	int state;
+	int latency;
+
+	/* Find block in lower level and invalidate other sharers */
+	latency = mod_atomic_find_block(target_mod, addr, 1,
+		target_mod->inclusion == mod_inclusion_non_inclusive ?
+		mod_atomic_fill_miss : mod_atomic_fill_none,
+		&set, &way, &tag, &state);
+	latency += mod_atomic_invalidate(target_mod, set, way, mod);
+
+	/* EV_MOD_WRITE_REQUEST_UPDOWN. Request exclusive copy if state is O/S/I,
+	 * or fill missing sectors if M/E. */
+	needed_sectors = mod_get_request_sectors(target_mod, mod, addr, sectors);
+	cache_get_sectors(target_mod->cache, set, way, &valid_sectors, NULL);
+	if (state != cache_block_modified && state != cache_block_exclusive)
+		latency += mod_atomic_write_request_updown(target_mod,
+			mod_get_low_mod(target_mod, tag), tag, needed_sectors);
+	else if (needed_sectors & ~valid_sectors)
+		latency += mod_atomic_sector_fill(target_mod, set, way, tag,
+			needed_sectors & ~valid_sectors);
+
+	/* EV_MOD_WRITE_REQUEST_UPDOWN_FINISH. Set mod as sharer and owner. */
+	dir = target_mod->dir;
+	for (z = 0; z < dir->zsize; z++)
+	{
+		dir_entry_tag = tag + z * target_mod->sub_block_size;
+		if (!mod_atomic_sub_block_in_range(mod, addr, dir_entry_tag))
+			continue;
+		dir_entry_set_sharer(dir, set, way, z, mod->low_net_node->index);
+		dir_entry_set_owner(dir, set, way, z, mod->low_net_node->index);
+	}
+
+	/* Set state: M->M, O/E/S/I->E */
+	if (target_mod->cache && state != cache_block_modified)
+		cache_set_block(target_mod->cache, set, way, tag, cache_block_exclusive);
+	if (target_mod->cache)
+	{
+		mod_atomic_set_sectors(target_mod, set, way, needed_sectors, 0);
+		mod_fill_data(target_mod, set, way);
+		if (target_mod->inclusion == mod_inclusion_exclusive)
+			mod_drop_data(target_mod, set, way);
+	}
+	dir_group_release_if_empty(dir, set, way);
+	return latency;
+}
+
+
+/* EV_MOD_INVALIDATE. Invalidate all copies of a block in upper levels, except
+ * in 'except_mod', and remove them from the directory. */
+static int mod_atomic_invalidate(struct mod_t *mod, uint32_t set, uint32_t way,
+	struct mod_t *except_mod)
+{
+	struct dir_t *dir;
+	struct dir_entry_t *dir_entry;
+	struct mod_t *sharer;
+
+	uint32_t tag;
+	uint32_t dir_entry_tag, z;
+	int latency;
+	int request_latency;
+	int i;
+
+	cache_get_block(mod->cache, set, way, &tag, NULL);
+	latency = 0;
+	dir = mod->dir;
+	for (z = 0; z < dir->zsize; z++)
+	{
+		dir_entry_tag = tag + z * mod->sub_block_size;
+		dir_entry = dir_entry_get(dir, set, way, z);
+		for (i = dir_entry_next_sharer(dir, set, way, z, 0); i >= 0;
+			i = dir_entry_next_sharer(dir, set, way, z, i + 1))
+		{
+			/* Skip 'except_mod' */
+			sharer = mod_atomic_high_mod(mod, i);
+			if (sharer == except_mod)
+				continue;
+
+			/* Clear sharer and owner */
+			dir_entry_clear_sharer(dir, set, way, z, i);
+			if (dir_entry->owner == i)
+				dir_entry_set_owner(dir, set, way, z, DIR_ENTRY_OWNER_NONE);
+
+			/* Send write request upwards if beginning of block */
+			if (dir_entry_tag % sharer->block_size)
+				continue;
+			request_latency = mod_atomic_write_request_downup(sharer,
+				dir_entry_tag);
+			latency = MAX(latency, request_latency);
+		}
+	}
+	dir_group_release_if_empty(dir, set, way);
+	return latency;
+}
+
+
+/* EV_MOD_EVICT. Evict a valid block, invalidating its copies in upper levels,
+ * and writing it back into the lower level if it is dirty. If 'data_only' is
+ * set, only the data of a block of a non-inclusive cache is evicted, keeping
+ * the block and its upper-level copies. */
+static int mod_atomic_evict(struct mod_t *mod, uint32_t set, uint32_t way,
+	int data_only)
+{
+	struct mod_t *target_mod;
+	struct dir_t *dir;
+	struct dir_entry_t *dir_entry;
+
+	uint32_t src_tag;
+	uint32_t target_set, target_way, target_tag;
+	uint32_t dir_entry_tag, z;
+	uint32_t sectors;
+	int src_state;
+	int target_state;
+	int latency;
+
+	/* Invalidate upper levels */
+	cache_get_block(mod->cache, set, way, &src_tag, &src_state);
+	assert(src_state);
+	latency = data_only ? 0 : mod_atomic_invalidate(mod, set, way, NULL);
+
+	/* EV_MOD_EVICT_INVALID. No writeback from main memory. */
+	if (mod->kind == mod_kind_main_memory)
+	{
+		cache_set_block(mod->cache, set, way, 0, cache_block_invalid);
+		return latency;
+	}
+
+	/* EV_MOD_EVICT_RECEIVE. Find block in lower level. */
+	target_mod = mod_get_low_mod(mod, src_tag);
+	latency += mod_atomic_find_block(target_mod, src_tag, 1,
+		src_state == cache_block_shared ? mod_atomic_fill_none :
+		mod_atomic_fill_dropped, &target_set, &target_way, &target_tag,
+		&target_state);
+
+	/* EV_MOD_EVICT_WRITEBACK. A dirty block makes the lower-level copy
+	 * exclusive and modified. */
+	if (src_state == cache_block_modified || src_state == cache_block_owned)
+	{
+		sectors = mod_get_request_sectors(target_mod, mod, src_tag,
+			mod_get_writeback_sectors(mod, set, way));
+		latency += mod_atomic_invalidate(target_mod, target_set, target_way, mod);
+		if (target_state == cache_block_owned || target_state == cache_block_shared)
+			latency += mod_atomic_write_request_updown(target_mod,
+				mod_get_low_mod(target_mod, target_tag), target_tag, sectors);
+		if (target_mod->cache)
+		{
+			cache_set_block(target_mod->cache, target_set, target_way,
+				target_tag, cache_block_modified);
+			mod_atomic_set_sectors(target_mod, target_set, target_way,
+				sectors, 1);
+		}
+	}
+
+	/* EV_MOD_EVICT_PROCESS. Fill data into a non-inclusive cache, and remove
+	 * sharer and owner, or make mod the owner after a writeback of its data
+	 * only. */
+	if (target_mod->cache && mod_fill_data(target_mod, target_set, target_way))
+		target_mod->victim_fills++;
+	dir = target_mod->dir;
+	for (z = 0; z < dir->zsize; z++)
+	{
+		dir_entry_tag = target_tag + z * target_mod->sub_block_size;
+		if (!mod_atomic_sub_block_in_range(mod, src_tag, dir_entry_tag))
+			continue;
+		dir_entry = dir_entry_get(dir, target_set, target_way, z);
+		if (data_only)
+		{
+			if (src_state == cache_block_modified || src_state == cache_block_owned)
+				dir_entry_set_owner(dir, target_set, target_way, z,
+					mod->low_net_node->index);
+			continue;
+		}
+		dir_entry_clear_sharer(dir, target_set, target_way, z, mod->low_net_node->index);
+		if (dir_entry->owner == mod->low_net_node->index)
+			dir_entry_set_owner(dir, target_set, target_way, z, DIR_ENTRY_OWNER_NONE);
+	}
+	dir_group_release_if_empty(dir, target_set, target_way);
+
+	/* EV_MOD_EVICT_REPLY_RECEIVE. A block whose data was evicted stays clean. */
+	if (data_only)
+	{
+		if (src_state == cache_block_modified || src_state == cache_block_owned)
+			cache_set_block(mod->cache, set, way, src_tag, cache_block_exclusive);
+		cache_set_data(mod->cache, set, way, 0);
+		return latency;
+	}
+	cache_set_block(mod->cache, set, way, 0, cache_block_invalid);
+	assert(!dir_entry_group_shared_or_owned(mod->dir, set, way));
+	return latency;
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+/* Perform an access of kind 'access_kind' to address 'addr' in 'mod' as a
+ * single synchronous operation, updating the state of the whole memory
+ * hierarchy as EV_MOD_LOAD or EV_MOD_STORE would do, but without using the
+ * event-driven simulation or the interconnects. Non-coherent writes are
+ * performed as regular writes. The function returns the estimated latency of
+ * the access in cycles. No in-flight access must exist in the hierarchy. */
+int mod_access_atomic(struct mod_t *mod, enum mod_access_kind_t access_kind,
+	uint32_t addr)
+{
+	uint32_t set, way, tag;
+	uint32_t sectors;
+	uint32_t valid_sectors;
+	int state;
+	int shared;
+	int latency;
+
+	/* Find block */
+	assert(!mod->access_list_count);
+	latency = mod_atomic_find_block(mod, addr, 1, mod_atomic_fill_miss,
+		&set, &way, &tag, &state);
+	sectors = mod_get_sectors(mod, addr, 1);
+	cache_get_sectors(mod->cache, set, way, &valid_sectors, NULL);
+
+	/* Load */
+	if (access_kind == mod_access_read)
+	{
+		if (!state)
+		{
+			latency += mod_atomic_read_request_updown(mod,
+				mod_get_low_mod(mod, tag), tag, sectors, &shared);
+			cache_set_block(mod->cache, set, way, tag, shared ?
+				cache_block_shared : cache_block_exclusive);
+			mod_atomic_set_sectors(mod, set, way, sectors, 0);
+			mod_fill_data(mod, set, way);
+		}
+		else if (sectors & ~valid_sectors)
+			latency += mod_atomic_sector_fill(mod, set, way, tag, sectors);
+	}
+
+	/* Store */
+	else
+	{
+		if (state != cache_block_modified && state != cache_block_exclusive)
+			latency += mod_atomic_write_request_updown(mod,
+				mod_get_low_mod(mod, tag), tag, sectors);
+		else if (sectors & ~valid_sectors)
+			latency += mod_atomic_sector_fill(mod, set, way, tag, sectors);
+		cache_set_block(mod->cache, set, way, tag, cache_block_modified);
+		mod_atomic_set_sectors(mod, set, way, sectors, 1);
+		mod_fill_data(mod, set, way);
+	}
+
+	/* Statistics */
+	mod->atomic_entry_accesses++;
+	mod->atomic_latency += latency;
+	return latency;
+}
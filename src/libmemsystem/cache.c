@@ -16,6 +16,10 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include <mem-system.h>
 
 
@@ -25,10 +29,13 @@
 
 struct string_map_t cache_policy_map =
 {
-	3, {
+	6, {
 		{ "LRU", cache_policy_lru },
 		{ "FIFO", cache_policy_fifo },
-		{ "Random", cache_policy_random }
+		{ "Random", cache_policy_random },
+		{ "PLRU", cache_policy_plru },
+		{ "SRRIP", cache_policy_srrip },
+		{ "BRRIP", cache_policy_brrip }
 	}
 };
 
@@ -51,60 +58,295 @@ struct string_map_t cache_block_state_map =
  * Private Functions
  */
 
-enum cache_waylist_enum
+/* Re-reference prediction values (RRPV) used by SRRIP and BRRIP. Blocks are
+ * inserted with a long or distant re-reference interval, and victims are
+ * chosen among blocks with a distant one. */
+#define CACHE_RRPV_LONG  2
+#define CACHE_RRPV_DISTANT  3
+
+/* BRRIP inserts one out of every 'CACHE_BRRIP_EPSILON' blocks with a long
+ * re-reference interval, and the rest with a distant one. */
+#define CACHE_BRRIP_EPSILON  32
+
+
+/* Return the replacement state of a set */
+static uint8_t *cache_repl_get(struct cache_t *cache, uint32_t set)
 {
-	cache_waylist_head,
-	cache_waylist_tail
-};
+	return cache->repl + set * cache->repl_size;
+}
+
 
-static void cache_update_waylist(struct cache_set_t *set,
-	struct cache_block_t *blk, enum cache_waylist_enum where)
+/* Return 1 if there is any invalid block in ways 'first_way' to
+ * 'first_way + num_ways - 1' of a set */
+static int cache_any_invalid(struct cache_t *cache, uint32_t set,
+	int first_way, int num_ways)
 {
-	if (!blk->way_prev && !blk->way_next)
-	{
-		assert(set->way_head == blk && set->way_tail == blk);
+	int32_t *states;
+	int way;
+
+	states = cache->states + CACHE_BLOCK_INDEX(cache, set, 0);
+	for (way = first_way; way < first_way + num_ways; way++)
+		if (!states[way])
+			return 1;
+	return 0;
+}
+
+
+/* LRU, FIFO, Random. Make block the most recently used (or inserted) one in
+ * its set, increasing the age of all blocks that were younger than it. */
+static void cache_age_move_to_head(struct cache_t *cache, uint32_t set, uint32_t way)
+{
+	uint8_t *age;
+	int i;
+
+	age = cache_repl_get(cache, set);
+	if (!age[way])
 		return;
-		
-	}
-	else if (!blk->way_prev)
+	for (i = 0; i < cache->assoc; i++)
+		if (age[i] < age[way])
+			age[i]++;
+	age[way] = 0;
+}
+
+
+/* LRU, FIFO, Random. Return the oldest block in a set. */
+static uint32_t cache_age_tail(struct cache_t *cache, uint32_t set)
+{
+	uint8_t *age;
+	uint32_t way;
+
+	age = cache_repl_get(cache, set);
+	for (way = 0; way < cache->assoc - 1; way++)
+		if (age[way] == cache->assoc - 1)
+			break;
+	return way;
+}
+
+
+/* PLRU. The 'assoc - 1' tree nodes of a set are numbered from 1 (root), where
+ * the children of node 'n' are '2n' and '2n + 1', and leaves 'assoc' to
+ * '2 * assoc - 1' are ways 0 to 'assoc - 1'. Each node stores one bit,
+ * pointing to its left (0) or right (1) subtree. */
+static int cache_plru_get_node(uint8_t *bits, int node)
+{
+	return (bits[node >> 3] >> (node & 7)) & 1;
+}
+
+
+static void cache_plru_set_node(uint8_t *bits, int node, int value)
+{
+	bits[node >> 3] &= ~(1 << (node & 7));
+	bits[node >> 3] |= value << (node & 7);
+}
+
+
+/* PLRU. Make all nodes in the path to a block point away from it. */
+static void cache_plru_access(struct cache_t *cache, uint32_t set, uint32_t way)
+{
+	uint8_t *bits;
+	int node;
+
+	bits = cache_repl_get(cache, set);
+	for (node = way + cache->assoc; node > 1; node /= 2)
+		cache_plru_set_node(bits, node / 2, !(node & 1));
+}
+
+
+/* Return 1 if all flags in 'avoid[first_way..first_way + num_ways - 1]' are set */
+static int cache_all_avoided(unsigned char *avoid, int first_way, int num_ways)
+{
+	int way;
+
+	for (way = first_way; way < first_way + num_ways; way++)
+		if (!avoid[way])
+			return 0;
+	return 1;
+}
+
+
+/* PLRU. Return the block reached by following the tree nodes of a set. If
+ * 'invalid' is set, the path avoids subtrees with no invalid block, so the
+ * set must contain at least one. If 'avoid' is not NULL, the path avoids
+ * subtrees where all ways are flagged in it, so at least one must not be. */
+static uint32_t cache_plru_victim(struct cache_t *cache, uint32_t set, int invalid,
+	unsigned char *avoid)
+{
+	uint8_t *bits;
+	int node;
+	int first_way;
+	int num_ways;
+	int right;
+
+	bits = cache_repl_get(cache, set);
+	node = 1;
+	first_way = 0;
+	num_ways = cache->assoc;
+	while (node < cache->assoc)
 	{
-		assert(set->way_head == blk && set->way_tail != blk);
-		if (where == cache_waylist_head)
-			return;
-		set->way_head = blk->way_next;
-		blk->way_next->way_prev = NULL;
-		
+		num_ways /= 2;
+		right = cache_plru_get_node(bits, node);
+		if (invalid && !cache_any_invalid(cache, set, first_way + right * num_ways, num_ways))
+			right = !right;
+		else if (avoid && cache_all_avoided(avoid, first_way + right * num_ways, num_ways))
+			right = !right;
+		first_way += right * num_ways;
+		node = node * 2 + right;
 	}
-	else if (!blk->way_next)
+	return first_way;
+}
+
+
+/* SRRIP, BRRIP. The RRPVs of a set are packed as 2-bit fields. */
+static int cache_rrpv_get(uint8_t *rrpv, uint32_t way)
+{
+	return (rrpv[way >> 2] >> ((way & 3) * 2)) & 3;
+}
+
+
+static void cache_rrpv_set(uint8_t *rrpv, uint32_t way, int value)
+{
+	assert(IN_RANGE(value, 0, CACHE_RRPV_DISTANT));
+	rrpv[way >> 2] &= ~(3 << ((way & 3) * 2));
+	rrpv[way >> 2] |= value << ((way & 3) * 2);
+}
+
+
+/* SRRIP, BRRIP. Set the RRPV of a block brought to the cache. */
+static void cache_rrip_insert(struct cache_t *cache, uint32_t set, uint32_t way)
+{
+	int value;
+
+	value = CACHE_RRPV_LONG;
+	if (cache->policy == cache_policy_brrip && cache->insertions % CACHE_BRRIP_EPSILON)
+		value = CACHE_RRPV_DISTANT;
+	cache->insertions++;
+	cache_rrpv_set(cache_repl_get(cache, set), way, value);
+}
+
+
+/* SRRIP, BRRIP. Return the first block with a distant RRPV in a set, skipping
+ * ways flagged in 'avoid' if it is not NULL. If there is none, all blocks are
+ * aged until one of them reaches it. Avoided blocks may already be distant, so
+ * ages saturate. */
+static uint32_t cache_rrip_victim(struct cache_t *cache, uint32_t set, unsigned char *avoid)
+{
+	uint8_t *rrpv;
+	uint32_t way;
+	uint32_t victim;
+	int max_value;
+	int value;
+
+	/* Find first block with the highest RRPV */
+	rrpv = cache_repl_get(cache, set);
+	victim = 0;
+	max_value = -1;
+	for (way = 0; way < cache->assoc && max_value < CACHE_RRPV_DISTANT; way++)
 	{
-		assert(set->way_head != blk && set->way_tail == blk);
-		if (where == cache_waylist_tail)
-			return;
-		set->way_tail = blk->way_prev;
-		blk->way_prev->way_next = NULL;
-		
+		if (avoid && avoid[way])
+			continue;
+		value = cache_rrpv_get(rrpv, way);
+		if (value > max_value)
+		{
+			victim = way;
+			max_value = value;
+		}
 	}
-	else
+
+	/* Age all blocks */
+	if (max_value < CACHE_RRPV_DISTANT)
+		for (way = 0; way < cache->assoc; way++)
+			cache_rrpv_set(rrpv, way, MIN(cache_rrpv_get(rrpv, way)
+				+ CACHE_RRPV_DISTANT - max_value, CACHE_RRPV_DISTANT));
+	return victim;
+}
+
+
+/* Return the invalid block in a set that is closest to be replaced (oldest
+ * for LRU, FIFO, and Random; highest RRPV for SRRIP and BRRIP), or -1 if all
+ * blocks are valid. */
+static int cache_invalid_victim(struct cache_t *cache, uint32_t set)
+{
+	int32_t *states;
+	uint8_t *repl;
+	int victim;
+	int max_value;
+	int value;
+	int way;
+
+	states = cache->states + CACHE_BLOCK_INDEX(cache, set, 0);
+	repl = cache_repl_get(cache, set);
+	victim = -1;
+	max_value = -1;
+	for (way = 0; way < cache->assoc; way++)
 	{
-		assert(set->way_head != blk && set->way_tail != blk);
-		blk->way_prev->way_next = blk->way_next;
-		blk->way_next->way_prev = blk->way_prev;
+		if (states[way])
+			continue;
+		value = cache->policy == cache_policy_srrip || cache->policy == cache_policy_brrip ?
+			cache_rrpv_get(repl, way) : repl[way];
+		if (value > max_value)
+		{
+			victim = way;
+			max_value = value;
+		}
 	}
+	return victim;
+}
+
 
-	if (where == cache_waylist_head)
+/* Return the index of the first element in 'tags[first..last]' equal to
+ * 'tag'. If 'states' is not NULL, only elements with a state other than
+ * invalid are considered. Return -1 if there is no such element. The search
+ * compares 8 (AVX2) or 4 (SSE2) elements per instruction. */
+static int cache_search_tag(uint32_t *tags, int32_t *states,
+	int first, int last, uint32_t tag)
+{
+	int i;
+
+#if defined(__AVX2__)
+	unsigned int mask;
+	__m256i tag_vec = _mm256_set1_epi32(tag);
+	__m256i zero_vec = _mm256_setzero_si256();
+	__m256i eq_vec;
+
+	for (i = first & ~7; i + 7 <= last; i += 8)
 	{
-		blk->way_next = set->way_head;
-		blk->way_prev = NULL;
-		set->way_head->way_prev = blk;
-		set->way_head = blk;
+		eq_vec = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i *) (tags + i)), tag_vec);
+		if (states)
+			eq_vec = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_loadu_si256(
+				(__m256i *) (states + i)), zero_vec), eq_vec);
+		mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq_vec));
+		if (i < first)
+			mask &= ~0U << (first - i);
+		if (mask)
+			return i + __builtin_ctz(mask);
 	}
-	else
+#elif defined(__SSE2__)
+	unsigned int mask;
+	__m128i tag_vec = _mm_set1_epi32(tag);
+	__m128i zero_vec = _mm_setzero_si128();
+	__m128i eq_vec;
+
+	for (i = first & ~3; i + 3 <= last; i += 4)
 	{
-		blk->way_prev = set->way_tail;
-		blk->way_next = NULL;
-		set->way_tail->way_next = blk;
-		set->way_tail = blk;
+		eq_vec = _mm_cmpeq_epi32(_mm_loadu_si128((__m128i *) (tags + i)), tag_vec);
+		if (states)
+			eq_vec = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_loadu_si128(
+				(__m128i *) (states + i)), zero_vec), eq_vec);
+		mask = _mm_movemask_ps(_mm_castsi128_ps(eq_vec));
+		if (i < first)
+			mask &= ~0U << (first - i);
+		if (mask)
+			return i + __builtin_ctz(mask);
 	}
+#else
+	i = first;
+#endif
+
+	/* Remaining elements */
+	for (i = MAX(i, first); i <= last; i++)
+		if (tags[i] == tag && (!states || states[i]))
+			return i;
+	return -1;
 }
 
 
@@ -117,12 +359,16 @@ static void cache_update_waylist(struct cache_set_t *set,
 
 
 struct cache_t *cache_create(char *name, uint32_t num_sets, uint32_t block_size,
-	uint32_t assoc, enum cache_policy_t policy)
+	uint32_t assoc, enum cache_policy_t policy, int num_sectors)
 {
 	struct cache_t *cache;
-	struct cache_block_t *block;
+	uint8_t *repl;
 	uint32_t set, way;
 
+	int num_blocks;
+	int tags_size;
+	void *tag_store;
+
 	/* Create cache */
 	cache = calloc(1, sizeof(struct cache_t));
 	if (!cache)
@@ -137,37 +383,67 @@ struct cache_t *cache_create(char *name, uint32_t num_sets, uint32_t block_size,
 	cache->num_sets = num_sets;
 	cache->block_size = block_size;
 	cache->assoc = assoc;
+	cache->data_assoc = assoc;
 	cache->policy = policy;
 
 	/* Derived fields */
 	assert(!(num_sets & (num_sets - 1)));
 	assert(!(block_size & (block_size - 1)));
 	assert(!(assoc & (assoc - 1)));
+	assert(assoc <= CACHE_MAX_ASSOC);
+	assert(!(num_sectors & (num_sectors - 1)) && num_sectors > 0);
+	assert(num_sectors <= CACHE_MAX_SECTORS && num_sectors <= block_size);
 	cache->log_block_size = log_base2(block_size);
 	cache->block_mask = block_size - 1;
-	
-	/* Create array of sets */
-	cache->sets = calloc(num_sets, sizeof(struct cache_set_t));
-	if (!cache->sets)
+	cache->num_sectors = num_sectors;
+	cache->log_sector_size = log_base2(block_size / num_sectors);
+
+	/* Size of the replacement state of a set */
+	switch (policy)
+	{
+	case cache_policy_plru:
+		cache->repl_size = (assoc + 7) / 8;
+		break;
+	case cache_policy_srrip:
+	case cache_policy_brrip:
+		cache->repl_size = (assoc * 2 + 7) / 8;
+		break;
+	default:
+		cache->repl_size = assoc;
+	}
+
+	/* Allocate tag store and replacement state. Each array starts at a
+	 * multiple of 32 bytes. */
+	num_blocks = num_sets * assoc;
+	tags_size = ROUND_UP(num_blocks * sizeof(uint32_t), 32);
+	tag_store = calloc(1, tags_size * 3 + num_sets * cache->repl_size);
+	if (!tag_store)
 		fatal("%s: out of memory", __FUNCTION__);
+	cache->tags = tag_store;
+	cache->transient_tags = tag_store + tags_size;
+	cache->states = tag_store + tags_size * 2;
+	cache->repl = tag_store + tags_size * 3;
 
-	/* Initialize array of sets */
-	for (set = 0; set < num_sets; set++)
+	/* Sector masks */
+	if (num_sectors > 1)
 	{
-		/* Create array of blocks */
-		cache->sets[set].blocks = calloc(assoc, sizeof(struct cache_block_t));
-		if (!cache->sets[set].blocks)
+		cache->valid_sectors = calloc(num_blocks * 2, sizeof(uint32_t));
+		if (!cache->valid_sectors)
 			fatal("%s: out of memory", __FUNCTION__);
+		cache->dirty_sectors = cache->valid_sectors + num_blocks;
+	}
 
-		/* Initialize array of blocks */
-		cache->sets[set].way_head = &cache->sets[set].blocks[0];
-		cache->sets[set].way_tail = &cache->sets[set].blocks[assoc - 1];
+	/* Initial replacement state. Ages start in the order of ways, and RRPVs
+	 * are distant. PLRU tree nodes start pointing left. */
+	for (set = 0; set < num_sets; set++)
+	{
+		repl = cache_repl_get(cache, set);
 		for (way = 0; way < assoc; way++)
 		{
-			block = &cache->sets[set].blocks[way];
-			block->way = way;
-			block->way_prev = way ? &cache->sets[set].blocks[way - 1] : NULL;
-			block->way_next = way < assoc - 1 ? &cache->sets[set].blocks[way + 1] : NULL;
+			if (policy == cache_policy_srrip || policy == cache_policy_brrip)
+				cache_rrpv_set(repl, way, CACHE_RRPV_DISTANT);
+			else if (policy != cache_policy_plru)
+				repl[way] = way;
 		}
 	}
 	
@@ -178,11 +454,9 @@ struct cache_t *cache_create(char *name, uint32_t num_sets, uint32_t block_size,
 
 void cache_free(struct cache_t *cache)
 {
-	uint32_t set;
-
-	for (set = 0; set < cache->num_sets; set++)
-		free(cache->sets[set].blocks);
-	free(cache->sets);
+	free(cache->valid_sectors);
+	free(cache->data);
+	free(cache->tags);
 	free(cache->name);
 	free(cache);
 }
@@ -204,34 +478,38 @@ void cache_decode_address(struct cache_t *cache, uint32_t addr,
 int cache_find_block(struct cache_t *cache, uint32_t addr,
 	uint32_t *set_ptr, uint32_t *way_ptr, int *state_ptr)
 {
-	uint32_t set, tag, way;
+	uint32_t set, tag;
+	int way;
 
 	/* Locate block */
 	tag = addr & ~cache->block_mask;
 	set = (addr >> cache->log_block_size) % cache->num_sets;
 	PTR_ASSIGN(set_ptr, set);
 	PTR_ASSIGN(state_ptr, 0);  /* Invalid */
-	for (way = 0; way < cache->assoc; way++)
-		if (cache->sets[set].blocks[way].tag == tag && cache->sets[set].blocks[way].state)
-			break;
+	way = cache_find_way(cache, set, tag);
 	
 	/* Block not found */
-	if (way == cache->assoc)
+	if (way < 0)
 		return 0;
 	
 	/* Block found */
 	PTR_ASSIGN(way_ptr, way);
-	PTR_ASSIGN(state_ptr, cache->sets[set].blocks[way].state);
+	PTR_ASSIGN(state_ptr, cache->states[CACHE_BLOCK_INDEX(cache, set, way)]);
 	return 1;
 }
 
 
 /* Set the tag and state of a block.
- * If replacement policy is FIFO, update linked list in case a new
- * block is brought to cache, i.e., a new tag is set. */
+ * If replacement policy is FIFO, make the block the youngest in case a new
+ * block is brought to cache, i.e., a new tag is set. For SRRIP and BRRIP,
+ * set the RRPV of a new valid block. In a sectored cache, a new or invalid
+ * block has no valid sectors. In a non-inclusive cache, an invalid block
+ * loses its data. */
 void cache_set_block(struct cache_t *cache, uint32_t set, uint32_t way,
 	uint32_t tag, int state)
 {
+	int index;
+
 	assert(set >= 0 && set < cache->num_sets);
 	assert(way >= 0 && way < cache->assoc);
 	assert(set == (tag >> cache->log_block_size) % cache->num_sets || !state);
@@ -240,13 +518,21 @@ void cache_set_block(struct cache_t *cache, uint32_t set, uint32_t way,
 			cache->name, set, way, tag,
 			map_value(&cache_block_state_map, state));
 
-	if (cache->policy == cache_policy_fifo
-		&& cache->sets[set].blocks[way].tag != tag)
-		cache_update_waylist(&cache->sets[set],
-			&cache->sets[set].blocks[way],
-			cache_waylist_head);
-	cache->sets[set].blocks[way].tag = tag;
-	cache->sets[set].blocks[way].state = state;
+	index = CACHE_BLOCK_INDEX(cache, set, way);
+	if (cache->policy == cache_policy_fifo && cache->tags[index] != tag)
+		cache_age_move_to_head(cache, set, way);
+	if ((cache->policy == cache_policy_srrip || cache->policy == cache_policy_brrip)
+		&& (cache->tags[index] != tag || !cache->states[index]) && state)
+		cache_rrip_insert(cache, set, way);
+	if (cache->valid_sectors && (cache->tags[index] != tag || !state))
+	{
+		cache->valid_sectors[index] = 0;
+		cache->dirty_sectors[index] = 0;
+	}
+	if (cache->data && !state)
+		cache->data[index] &= ~CACHE_DATA_VALID;
+	cache->tags[index] = tag;
+	cache->states[index] = state;
 }
 
 
@@ -255,29 +541,138 @@ void cache_get_block(struct cache_t *cache, uint32_t set, uint32_t way,
 {
 	assert(set >= 0 && set < cache->num_sets);
 	assert(way >= 0 && way < cache->assoc);
-	PTR_ASSIGN(tag_ptr, cache->sets[set].blocks[way].tag);
-	PTR_ASSIGN(state_ptr, cache->sets[set].blocks[way].state);
+	PTR_ASSIGN(tag_ptr, cache->tags[CACHE_BLOCK_INDEX(cache, set, way)]);
+	PTR_ASSIGN(state_ptr, cache->states[CACHE_BLOCK_INDEX(cache, set, way)]);
+}
+
+
+/* Set the masks of valid and dirty sectors of a block. Ignored for caches
+ * without sectors. */
+void cache_set_sectors(struct cache_t *cache, uint32_t set, uint32_t way,
+	uint32_t valid, uint32_t dirty)
+{
+	int index;
+
+	assert(set >= 0 && set < cache->num_sets);
+	assert(way >= 0 && way < cache->assoc);
+	assert(!(dirty & ~valid));
+	if (!cache->valid_sectors)
+		return;
+	index = CACHE_BLOCK_INDEX(cache, set, way);
+	cache->valid_sectors[index] = valid;
+	cache->dirty_sectors[index] = dirty;
+}
+
+
+/* Return the masks of valid and dirty sectors of a block. In a cache without
+ * sectors, the only sector is always reported as valid and clean. */
+void cache_get_sectors(struct cache_t *cache, uint32_t set, uint32_t way,
+	uint32_t *valid_ptr, uint32_t *dirty_ptr)
+{
+	int index;
+
+	assert(set >= 0 && set < cache->num_sets);
+	assert(way >= 0 && way < cache->assoc);
+	if (!cache->valid_sectors)
+	{
+		PTR_ASSIGN(valid_ptr, 1);
+		PTR_ASSIGN(dirty_ptr, 0);
+		return;
+	}
+	index = CACHE_BLOCK_INDEX(cache, set, way);
+	PTR_ASSIGN(valid_ptr, cache->valid_sectors[index]);
+	PTR_ASSIGN(dirty_ptr, cache->dirty_sectors[index]);
+}
+
+
+/* Limit the number of data frames per set to 'data_assoc', which makes the
+ * cache non-inclusive. Blocks start without data. */
+void cache_set_data_assoc(struct cache_t *cache, uint32_t data_assoc)
+{
+	assert(data_assoc > 0 && data_assoc <= cache->assoc);
+	assert(!cache->data);
+	cache->data_assoc = data_assoc;
+	if (data_assoc == cache->assoc)
+		return;
+	cache->data = calloc(cache->num_sets * cache->assoc, sizeof(uint8_t));
+	if (!cache->data)
+		fatal("%s: out of memory", __FUNCTION__);
+}
+
+
+/* Set the 'CACHE_DATA_xxx' flags of a block. Ignored for caches where every
+ * block has a data frame. */
+void cache_set_data(struct cache_t *cache, uint32_t set, uint32_t way, int flags)
+{
+	assert(set >= 0 && set < cache->num_sets);
+	assert(way >= 0 && way < cache->assoc);
+	if (!cache->data)
+		return;
+	cache->data[CACHE_BLOCK_INDEX(cache, set, way)] = flags;
 }
 
 
-/* Update LRU counters, i.e., rearrange linked list in case
- * replacement policy is LRU. */
+/* Return the 'CACHE_DATA_xxx' flags of a block. In a cache where every block
+ * has a data frame, flag 'VALID' is always set. */
+int cache_get_data(struct cache_t *cache, uint32_t set, uint32_t way)
+{
+	assert(set >= 0 && set < cache->num_sets);
+	assert(way >= 0 && way < cache->assoc);
+	if (!cache->data)
+		return CACHE_DATA_VALID;
+	return cache->data[CACHE_BLOCK_INDEX(cache, set, way)];
+}
+
+
+/* Return 1 if a block is valid and holds its data */
+int cache_block_has_data(struct cache_t *cache, uint32_t set, uint32_t way)
+{
+	int index;
+
+	assert(set >= 0 && set < cache->num_sets);
+	assert(way >= 0 && way < cache->assoc);
+	index = CACHE_BLOCK_INDEX(cache, set, way);
+	if (!cache->states[index])
+		return 0;
+	return !cache->data || (cache->data[index] & CACHE_DATA_VALID);
+}
+
+
+/* Update replacement state after an access to a block */
 void cache_access_block(struct cache_t *cache, uint32_t set, uint32_t way)
 {
-	int move_to_head;
-	
 	assert(set >= 0 && set < cache->num_sets);
 	assert(way >= 0 && way < cache->assoc);
 
-	/* A block is moved to the head of the list for LRU policy.
+	switch (cache->policy)
+	{
+
+	/* A block is moved to the head for LRU policy.
 	 * It will also be moved if it is its first access for FIFO policy, i.e., if the
 	 * state of the block was invalid. */
-	move_to_head = cache->policy == cache_policy_lru ||
-		(cache->policy == cache_policy_fifo && !cache->sets[set].blocks[way].state);
-	if (move_to_head && cache->sets[set].blocks[way].way_prev)
-		cache_update_waylist(&cache->sets[set],
-			&cache->sets[set].blocks[way],
-			cache_waylist_head);
+	case cache_policy_lru:
+		cache_age_move_to_head(cache, set, way);
+		break;
+
+	case cache_policy_fifo:
+		if (!cache->states[CACHE_BLOCK_INDEX(cache, set, way)])
+			cache_age_move_to_head(cache, set, way);
+		break;
+
+	case cache_policy_plru:
+		cache_plru_access(cache, set, way);
+		break;
+
+	/* A hit predicts a near-immediate re-reference */
+	case cache_policy_srrip:
+	case cache_policy_brrip:
+		if (cache->states[CACHE_BLOCK_INDEX(cache, set, way)])
+			cache_rrpv_set(cache_repl_get(cache, set), way, 0);
+		break;
+
+	default:
+		break;
+	}
 }
 
 
@@ -285,36 +680,142 @@ void cache_access_block(struct cache_t *cache, uint32_t set, uint32_t way)
  * depending on the replacement policy */
 uint32_t cache_replace_block(struct cache_t *cache, uint32_t set)
 {
-	struct cache_block_t *block;
+	int way;
 
-	/* Try to find an invalid block. Do this in the LRU order, to avoid picking the
-	 * MRU while its state has not changed to valid yet. */
+	/* Try to find an invalid block. Do this in the replacement order, to avoid
+	 * picking the MRU while its state has not changed to valid yet. */
 	assert(set >= 0 && set < cache->num_sets);
-	for (block = cache->sets[set].way_tail; block; block = block->way_prev)
-		if (!block->state)
-			return block->way;
-
-	/* LRU and FIFO replacement: return block at the
-	 * tail of the linked list */
-	if (cache->policy == cache_policy_lru ||
-		cache->policy == cache_policy_fifo)
-		return cache->sets[set].way_tail->way;
-	
+	if (cache->policy == cache_policy_plru)
+	{
+		if (cache_any_invalid(cache, set, 0, cache->assoc))
+			return cache_plru_victim(cache, set, 1, NULL);
+	}
+	else
+	{
+		way = cache_invalid_victim(cache, set);
+		if (way >= 0)
+			return way;
+	}
+
+	switch (cache->policy)
+	{
+
+	/* LRU and FIFO replacement: return oldest block */
+	case cache_policy_lru:
+	case cache_policy_fifo:
+		return cache_age_tail(cache, set);
+
+	case cache_policy_plru:
+		return cache_plru_victim(cache, set, 0, NULL);
+
+	case cache_policy_srrip:
+	case cache_policy_brrip:
+		return cache_rrip_victim(cache, set, NULL);
+
 	/* Random replacement */
-	assert(cache->policy == cache_policy_random);
-	return random() % cache->assoc;
+	default:
+		assert(cache->policy == cache_policy_random);
+		return random() % cache->assoc;
+	}
 }
 
 
-void cache_set_transient_tag(struct cache_t *cache, uint32_t set, uint32_t way, uint32_t tag)
+/* Return the way of the block to be replaced in a set, like
+ * 'cache_replace_block', but skipping the valid blocks whose ways are flagged
+ * in 'avoid', an array of 'assoc' elements. If all ways are flagged, the
+ * victim is chosen among all blocks. */
+uint32_t cache_replace_block_avoid(struct cache_t *cache, uint32_t set,
+	unsigned char *avoid)
 {
-	struct cache_block_t *block;
+	/* Invalid blocks are replaced first anyway */
+	assert(set >= 0 && set < cache->num_sets);
+	if (cache_any_invalid(cache, set, 0, cache->assoc) ||
+		cache_all_avoided(avoid, 0, cache->assoc))
+		return cache_replace_block(cache, set);
+	return cache_replace_block_among(cache, set, avoid);
+}
 
+
+/* Return the way of the block to be replaced in a set among the blocks whose
+ * ways are not flagged in 'avoid', whether they are valid or not. At least one
+ * way must not be flagged. */
+uint32_t cache_replace_block_among(struct cache_t *cache, uint32_t set,
+	unsigned char *avoid)
+{
+	uint8_t *age;
+	int victim;
+	int count;
+	int way;
+
+	assert(set >= 0 && set < cache->num_sets);
+	assert(!cache_all_avoided(avoid, 0, cache->assoc));
+	switch (cache->policy)
+	{
+
+	/* Oldest block not avoided */
+	case cache_policy_lru:
+	case cache_policy_fifo:
+		age = cache_repl_get(cache, set);
+		victim = -1;
+		for (way = 0; way < cache->assoc; way++)
+			if (!avoid[way] && (victim < 0 || age[way] > age[victim]))
+				victim = way;
+		return victim;
+
+	case cache_policy_plru:
+		return cache_plru_victim(cache, set, 0, avoid);
+
+	case cache_policy_srrip:
+	case cache_policy_brrip:
+		return cache_rrip_victim(cache, set, avoid);
+
+	/* Random block among those not avoided */
+	default:
+		assert(cache->policy == cache_policy_random);
+		count = 0;
+		for (way = 0; way < cache->assoc; way++)
+			count += !avoid[way];
+		count = random() % count;
+		for (way = 0; way < cache->assoc; way++)
+			if (!avoid[way] && !count--)
+				break;
+		return way;
+	}
+}
+
+
+void cache_set_transient_tag(struct cache_t *cache, uint32_t set, uint32_t way, uint32_t tag)
+{
 	/* Set transient tag */
-	block = &cache->sets[set].blocks[way];
-	block->transient_tag = tag;
+	cache->transient_tags[CACHE_BLOCK_INDEX(cache, set, way)] = tag;
 
 	/* Debug */
 	mem_trace("mem.set_transient_tag cache=\"%s\" set=%d way=%d tag=0x%x\n",
 			cache->name, set, way, tag);
 }
+
+
+/* Return the way in 'set' holding a valid block with tag 'tag', or -1 if the
+ * block is not in the cache. */
+int cache_find_way(struct cache_t *cache, uint32_t set, uint32_t tag)
+{
+	int index;
+
+	index = CACHE_BLOCK_INDEX(cache, set, 0);
+	return cache_search_tag(cache->tags + index, cache->states + index,
+		0, cache->assoc - 1, tag);
+}
+
+
+/* Return the first way between 'first_way' and 'last_way' in 'set' with a
+ * transient tag equal to 'tag', or -1 if there is none or the range is empty. */
+int cache_find_transient_way(struct cache_t *cache, uint32_t set, uint32_t tag,
+	int first_way, int last_way)
+{
+	int index;
+
+	assert(first_way >= 0 && last_way < (int) cache->assoc);
+	index = CACHE_BLOCK_INDEX(cache, set, 0);
+	return cache_search_tag(cache->transient_tags + index, NULL,
+		first_way, last_way, tag);
+}
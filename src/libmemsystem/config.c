@@ -56,6 +56,24 @@ char *mem_config_help =
 	"  PageSize = <size>  (Default = 4096)\n"
 	"      Memory page size. Virtual addresses are translated into new physical\n"
 	"      addresses in ascending order at the granularity of the page size.\n"
+	"  HugePages = {t|f}  (Default = f)\n"
+	"      Allocate physical memory in huge pages, each one mapped by an entry of\n"
+	"      the page directory (4MB with 4KB pages). TLB entries then translate\n"
+	"      huge pages, and page walks read only the page directory.\n"
+	"  PageColors = <num>  (Default = 1)\n"
+	"      Number of page colors. When greater than 1, a page is placed at a\n"
+	"      physical page number with the same value modulo the number of colors as\n"
+	"      its virtual page number, so that consecutive virtual pages spread over\n"
+	"      the sets of physically indexed caches. Must be a power of 2. Ignored\n"
+	"      with huge pages.\n"
+	"  PagePlacement = {Sequential|Interleaved|FirstTouch}  (Default = Sequential)\n"
+	"      Placement of pages on NUMA nodes, which are the main memory modules\n"
+	"      accessible from CPU entries. With 'Sequential', pages take the lowest\n"
+	"      free physical address. With 'Interleaved', pages are distributed in a\n"
+	"      round-robin fashion among nodes. With 'FirstTouch', a page is placed on\n"
+	"      the node given by variable 'LocalMemory' of the CPU entry that accesses it\n"
+	"      first. The address ranges of main memory modules should be defined with\n"
+	"      a granularity of at least the page size.\n"
 	"\n"
 	"Section [Module <name>] defines a generic memory module. This section is used to\n"
 	"declare both caches and main memory modules accessible from CPU cores or GPU\n"
@@ -99,7 +117,15 @@ char *mem_config_help =
 	"  Latency = <cycles>\n"
 	"      Memory access latency. This variable is required for a main memory module,\n"
 	"      and should be omitted for a cache module (the access latency is specified\n"
-	"      in the corresponding cache geometry section in this case).\n"
+	"      in the corresponding cache geometry section in this case). If the main\n"
+	"      memory uses a DRAM timing model, this is the latency of the memory\n"
+	"      controller before a request is queued for the DRAM.\n"
+	"  DRAM = <dram>\n"
+	"      DRAM timing model for a main memory module, defined in a separate section\n"
+	"      of type [DRAM <dram>]. If omitted, every access to the main memory takes\n"
+	"      'Latency' cycles. The DRAM model is only used for accesses coming from CPU\n"
+	"      cores. With a DRAM model, variable 'Ports' gives the number of requests\n"
+	"      that the memory controller can hold at a time.\n"
 	"  AddressRange = { BOUNDS <low> <high> | ADDR DIV <div> MOD <mod> EQ <eq> }\n"
 	"      Physical address range served by the module. If not specified, the entire\n"
 	"      address space is served by the module. There are two possible formats for\n"
@@ -114,6 +140,70 @@ char *mem_config_help =
 	"      value of <div> must be a multiple of the block size. When a module serves\n"
 	"      only a subset of the address space, the user must make sure that the rest\n"
 	"      of the modules at the same level serve the remaining address space.\n"
+	"  StackDistance = {t|f} (Default = f)\n"
+	"      Run a stack distance analysis on the accesses to the module. In a single\n"
+	"      simulation, this analysis obtains the miss ratio that an LRU cache with the\n"
+	"      block size of the module would have for a range of numbers of sets and\n"
+	"      associativities, when receiving the same accesses. The results are dumped\n"
+	"      in section [ <mod>.StackDistance ] of the memory report.\n"
+	"  StackDistanceMinSets = <num> (Default = 1)\n"
+	"  StackDistanceMaxSets = <num> (Default = 16384)\n"
+	"      Smallest and largest number of sets analyzed in the stack distance\n"
+	"      analysis. Both values must be powers of two.\n"
+	"  StackDistanceMaxAssoc = <num> (Default = 16)\n"
+	"      Largest associativity analyzed, a power of two. Miss ratios are reported\n"
+	"      for every power of two up to this value.\n"
+	"  Prefetcher = {None|NextLine|Stride|Stream} (Default = None)\n"
+	"      Hardware prefetcher of a cache module, trained with the loads and stores\n"
+	"      from CPU cores or the requests from upper-level caches. 'NextLine'\n"
+	"      prefetches the blocks following a missed block. 'Stride' detects\n"
+	"      constant strides between the accesses of each instruction. 'Stream'\n"
+	"      detects ascending and descending sequences of missed blocks. Prefetches\n"
+	"      are dropped when the cache has no free port or MSHR. Useful, late, and\n"
+	"      useless prefetches are reported in section [ <mod>.Prefetcher ] of the\n"
+	"      memory report.\n"
+	"  PrefetcherDegree = <num> (Default = 2)\n"
+	"      Maximum number of blocks prefetched for each access training the\n"
+	"      prefetcher.\n"
+	"  PrefetcherDistance = <num> (Default = 8)\n"
+	"      For stream prefetchers, number of blocks that prefetches are kept ahead\n"
+	"      of the last access to a stream.\n"
+	"  PrefetcherTableSize = <num> (Default = 64)\n"
+	"      Number of instructions tracked by a stride prefetcher, or number of\n"
+	"      streams tracked by a stream prefetcher.\n"
+	"  Inclusion = {Inclusive|NonInclusive|Exclusive} (Default = Inclusive)\n"
+	"      Inclusion of the blocks of upper-level caches. An inclusive cache holds\n"
+	"      the data of every block present in upper levels, so replacing a block\n"
+	"      invalidates its upper-level copies ('InclusionVictims'). A non-inclusive\n"
+	"      cache keeps the directory entries of its blocks in 'DirectoryAssoc'\n"
+	"      ways per set, but only 'Assoc' of them hold data. To free a frame, the\n"
+	"      data of a block is dropped silently if an upper-level owner or the\n"
+	"      lower level can provide it again ('DataDrops'), or written to the lower\n"
+	"      level otherwise ('DataEvictions'). Upper levels bring the data back\n"
+	"      when evicting the block, dirty or clean ('VictimFills'). Blocks with\n"
+	"      upper-level copies are only replaced when all blocks in the set have\n"
+	"      one. An exclusive cache also drops the data of a block as soon as an\n"
+	"      upper level becomes its owner, so that data is not duplicated across\n"
+	"      levels. Non-inclusive and exclusive caches need upper-level caches with\n"
+	"      the same block size and no sectors, and are not supported below GPU\n"
+	"      global memory.\n"
+	"  DirectoryAssoc = <num> (Default = Assoc, or 2 * Assoc if not inclusive)\n"
+	"      For non-inclusive and exclusive caches, number of ways per set keeping\n"
+	"      the tags and directory entries of blocks, a power of two not smaller\n"
+	"      than 'Assoc'. A sparse directory keeps the host memory used by the\n"
+	"      extra ways low.\n"
+	"  DirectoryFormat = {FullMap|Sparse} (Default = FullMap)\n"
+	"      Organization of the directory keeping the sharers and owner of each\n"
+	"      block. A full-map directory allocates an entry with a bitmap of all\n"
+	"      possible sharers for every block at startup. A sparse directory only\n"
+	"      allocates the entries of a block while it has sharers or an owner, and\n"
+	"      keeps the sharers of an entry as a list of nodes, switching to a bitmap\n"
+	"      when the list is full. Both formats track sharers exactly. A sparse\n"
+	"      directory reduces the host memory used by main memory modules with a\n"
+	"      large 'DirectorySize', or by caches shared by many nodes.\n"
+	"  DirectoryPointers = <num> (Default = 4)\n"
+	"      For sparse directories, number of sharers kept as a list of nodes in\n"
+	"      each entry.\n"
 	"\n"
 	"Section [CacheGeometry <geo>] defines a geometry for a cache. Caches using this\n"
 	"geometry are instantiated [Module <name>] sections.\n"
@@ -128,17 +218,70 @@ char *mem_config_help =
 	"      the product Sets * Assoc * BlockSize.\n"
 	"  Latency = <cycles> (Required)\n"
 	"      Hit latency for a cache in number of cycles.\n"
-	"  Policy = {LRU|FIFO|Random} (Default = LRU)\n"
-	"      Block replacement policy.\n"
+	"  Policy = {LRU|FIFO|Random|PLRU|SRRIP|BRRIP} (Default = LRU)\n"
+	"      Block replacement policy. PLRU is a tree-based pseudo-LRU policy. SRRIP\n"
+	"      and BRRIP are the static and bimodal re-reference interval prediction\n"
+	"      policies, using 2-bit counters per block.\n"
 	"  MSHR = <size> (Default = 16)\n"
 	"      Miss status holding register (MSHR) size in number of entries. This value\n"
 	"      determines the maximum number of accesses that can be in flight for the\n"
 	"      cache, including the time since the access request is received, until a\n"
 	"      potential miss is resolved.\n"
 	"  Ports = <num> (Default = 2)\n"
-	"      Number of ports. The number of ports in a cache limits the number of\n"
-	"      concurrent hits. If an access is a miss, it remains in the MSHR while it\n"
+	"      Number of ports per bank. The number of ports in a cache limits the number\n"
+	"      of concurrent hits. If an access is a miss, it remains in the MSHR while it\n"
 	"      is resolved, but releases the cache port.\n"
+	"  Banks = <num> (Default = 1)\n"
+	"      Number of banks, as a power of two. Each bank has 'Ports' ports, and an\n"
+	"      access can only use a port of the bank serving its address. An access\n"
+	"      waiting for a port of its bank while other banks have free ports is\n"
+	"      counted as a bank conflict. Variables 'Banks', 'BankSelect', and 'Ports'\n"
+	"      can also be given in the section of a main memory module.\n"
+	"  BankSelect = {Block|Word|XOR} (Default = Block)\n"
+	"      Function mapping addresses to banks. 'Block' interleaves consecutive\n"
+	"      blocks across banks, and 'Word' consecutive 4-byte words. 'XOR' folds all\n"
+	"      bits of the block address with XOR, spreading strided accesses.\n"
+	"  Sectors = <num> (Default = 1)\n"
+	"      Number of sectors per block. Blocks are allocated as a whole, but only the\n"
+	"      sectors accessed are brought from the lower level, with a valid and dirty\n"
+	"      bit per sector. Only dirty sectors are written back. Must be a power of\n"
+	"      two up to 32, with sectors of at least 4 bytes.\n"
+	"\n"
+	"Section [DRAM <dram>] defines the organization and timing of the DRAM modules\n"
+	"behind a main memory. Blocks are read from the DRAM for every request to main\n"
+	"memory, and written back for every eviction of a dirty block. Timing parameters\n"
+	"are given in cycles.\n"
+	"\n"
+	"  Channels = <num> (Default = 1)\n"
+	"  Ranks = <num> (Default = 1)\n"
+	"  Banks = <num> (Default = 8)\n"
+	"      Number of independent channels, number of ranks per channel, and number of\n"
+	"      banks per rank. Each channel has its own request queue and data bus.\n"
+	"  RowSize = <size> (Default = 2048)\n"
+	"      Size of a row buffer in bytes. Consecutive blocks are mapped to the same\n"
+	"      row, and consecutive rows are mapped to different channels, then banks,\n"
+	"      and then ranks.\n"
+	"  PagePolicy = {Open|Closed} (Default = Open)\n"
+	"      With an open page policy, a row remains in the row buffer after it is\n"
+	"      accessed. With a closed page policy, the bank is precharged after every\n"
+	"      access.\n"
+	"  Scheduler = {FCFS|FRFCFS} (Default = FRFCFS)\n"
+	"      Request scheduler of each channel. FCFS serves requests in arrival order.\n"
+	"      FRFCFS serves first the oldest request hitting an open row, and then the\n"
+	"      oldest request.\n"
+	"  tCAS = <cycles> (Default = 41)\n"
+	"  tRCD = <cycles> (Default = 41)\n"
+	"  tRP = <cycles> (Default = 41)\n"
+	"  tRAS = <cycles> (Default = 105)\n"
+	"      Latency of a column access, a row activation, and a precharge, and\n"
+	"      minimum time between the activation and the precharge of a row.\n"
+	"  tBurst = <cycles> (Default = 15)\n"
+	"      Time to transfer a block on the data bus of a channel.\n"
+	"  tREFI = <cycles> (Default = 23400)\n"
+	"  tRFC = <cycles> (Default = 480)\n"
+	"      Interval between refreshes, and duration of a refresh. During a refresh,\n"
+	"      all banks of a channel are unavailable, and their rows are closed. A\n"
+	"      value of 0 for 'tREFI' disables refresh.\n"
 	"\n"
 	"Section [Network <net>] defines an internal default interconnect, formed of a\n"
 	"single switch connecting all modules pointing to the network. For every module\n"
@@ -181,6 +324,33 @@ char *mem_config_help =
 	"  Module = <mod>\n"
 	"      Module serving as an entry to a GPU compute unit when reading/writing\n"
 	"      program data in the global memory scope. Omitted for CPU entries.\n"
+	"  DataTLB = <tlb>\n"
+	"  InstTLB = <tlb>\n"
+	"      TLBs looked up by a CPU core/thread before accessing the data and\n"
+	"      instruction modules, respectively, defined in sections [TLB <tlb>].\n"
+	"      Translations have no latency when omitted. Omitted for GPU entries.\n"
+	"  LocalMemory = <mod>\n"
+	"      Main memory module where the pages first accessed by a CPU core/thread\n"
+	"      are placed, with 'PagePlacement = FirstTouch' in section [General].\n"
+	"      Omitted for GPU entries.\n"
+	"\n"
+	"Section [TLB <name>] defines a translation lookaside buffer with LRU\n"
+	"replacement. A TLB hit has no additional latency. On a miss, the access waits\n"
+	"until the lower-level TLBs are looked up and, if all of them miss, until a page\n"
+	"walk reads the page table entries through the data module of the CPU\n"
+	"core/thread.\n"
+	"\n"
+	"  Sets = <num_sets> (Default = 16)\n"
+	"      Number of sets. Must be a power of 2.\n"
+	"  Assoc = <num_ways> (Default = 4)\n"
+	"      Number of ways in each set.\n"
+	"  Latency = <cycles> (Default = 1)\n"
+	"      Cycles needed to find out whether a translation is present.\n"
+	"  MSHR = <size> (Default = 4)\n"
+	"      Maximum number of misses in flight started in this TLB.\n"
+	"  Next = <tlb> (Default = None)\n"
+	"      Lower-level TLB looked up on a miss, which can be shared by several\n"
+	"      TLBs. If omitted, a miss starts a page walk.\n"
 	"\n";
 
 
@@ -375,6 +545,7 @@ static void mem_config_gpu_default(struct config_t *config)
 static void mem_config_read_general(struct config_t *config)
 {
 	char *section;
+	char *placement_str;
 
 	/* Section with general parameters */
 	section = "General";
@@ -384,6 +555,20 @@ static void mem_config_read_general(struct config_t *config)
 	if ((mmu_page_size & (mmu_page_size - 1)))
 		fatal("%s: page size must be power of 2.\n%s",
 			mem_config_file_name, err_mem_config_note);
+
+	/* Physical page allocation */
+	mmu_huge_pages = config_read_bool(config, section, "HugePages", 0);
+	mmu_page_colors = config_read_int(config, section, "PageColors", 1);
+	if (mmu_page_colors < 1 || (mmu_page_colors & (mmu_page_colors - 1)))
+		fatal("%s: number of page colors must be a power of 2.\n%s",
+			mem_config_file_name, err_mem_config_note);
+	if (mmu_huge_pages)
+		mmu_page_colors = 1;
+	placement_str = config_read_string(config, section, "PagePlacement", "Sequential");
+	mmu_placement = map_string_case(&mmu_placement_map, placement_str);
+	if (mmu_placement == mmu_placement_invalid)
+		fatal("%s: %s: invalid page placement policy.\n%s",
+			mem_config_file_name, placement_str, err_mem_config_note);
 }
 
 
@@ -544,8 +729,17 @@ static struct mod_t *mem_config_read_cache(struct config_t *config, char *sectio
 	char *policy_str;
 	enum cache_policy_t policy;
 
+	char *inclusion_str;
+	enum mod_inclusion_t inclusion;
+	int dir_assoc;
+
 	int mshr_size;
 	int num_ports;
+	int num_banks;
+	int num_sectors;
+
+	char *bank_select_str;
+	enum mod_bank_select_t bank_select;
 
 	char *net_name;
 	char *net_node_name;
@@ -573,6 +767,10 @@ static struct mod_t *mem_config_read_cache(struct config_t *config, char *sectio
 	policy_str = config_read_string(config, buf, "Policy", "LRU");
 	mshr_size = config_read_int(config, buf, "MSHR", 16);
 	num_ports = config_read_int(config, buf, "Ports", 2);
+	num_banks = config_read_int(config, buf, "Banks", 1);
+	bank_select_str = config_read_string(config, buf, "BankSelect", "Block");
+	num_sectors = config_read_int(config, buf, "Sectors", 1);
+	inclusion_str = config_read_string(config, section, "Inclusion", "Inclusive");
 
 	/* Checks */
 	policy = map_string_case(&cache_policy_map, policy_str);
@@ -583,9 +781,9 @@ static struct mod_t *mem_config_read_cache(struct config_t *config, char *sectio
 	if (num_sets < 1 || (num_sets & (num_sets - 1)))
 		fatal("%s: cache %s: number of sets must be a power of two greater than 1.\n%s",
 			mem_config_file_name, mod_name, err_mem_config_note);
-	if (assoc < 1 || (assoc & (assoc - 1)))
-		fatal("%s: cache %s: associativity must be power of two and > 1.\n%s",
-			mem_config_file_name, mod_name, err_mem_config_note);
+	if (assoc < 1 || (assoc & (assoc - 1)) || assoc > CACHE_MAX_ASSOC)
+		fatal("%s: cache %s: associativity must be power of two between 1 and %d.\n%s",
+			mem_config_file_name, mod_name, CACHE_MAX_ASSOC, err_mem_config_note);
 	if (block_size < 4 || (block_size & (block_size - 1)))
 		fatal("%s: cache %s: block size must be power of two and at least 4.\n%s",
 			mem_config_file_name, mod_name, err_mem_config_note);
@@ -598,16 +796,49 @@ static struct mod_t *mem_config_read_cache(struct config_t *config, char *sectio
 	if (num_ports < 1)
 		fatal("%s: cache %s: invalid value for variable 'Ports'.\n%s",
 			mem_config_file_name, mod_name, err_mem_config_note);
+	if (num_banks < 1 || (num_banks & (num_banks - 1)))
+		fatal("%s: cache %s: number of banks must be a power of two.\n%s",
+			mem_config_file_name, mod_name, err_mem_config_note);
+	bank_select = map_string_case(&mod_bank_select_map, bank_select_str);
+	if (bank_select == mod_bank_select_invalid)
+		fatal("%s: cache %s: %s: invalid bank select function.\n%s",
+			mem_config_file_name, mod_name,
+			bank_select_str, err_mem_config_note);
+	if (num_sectors < 1 || (num_sectors & (num_sectors - 1)) ||
+		num_sectors > CACHE_MAX_SECTORS || block_size / num_sectors < 4)
+		fatal("%s: cache %s: number of sectors must be power of two between 1 and %d, "
+			"with sectors of at least 4 bytes.\n%s",
+			mem_config_file_name, mod_name, CACHE_MAX_SECTORS, err_mem_config_note);
+	inclusion = map_string_case(&mod_inclusion_map, inclusion_str);
+	if (inclusion == mod_inclusion_invalid)
+		fatal("%s: cache %s: %s: invalid inclusion policy.\n%s",
+			mem_config_file_name, mod_name,
+			inclusion_str, err_mem_config_note);
+	dir_assoc = config_read_int(config, section, "DirectoryAssoc",
+		inclusion == mod_inclusion_inclusive ? assoc : assoc * 2);
+	if (inclusion == mod_inclusion_inclusive && dir_assoc != assoc)
+		fatal("%s: cache %s: directory associativity of inclusive caches must "
+			"match the cache associativity.\n%s",
+			mem_config_file_name, mod_name, err_mem_config_note);
+	if (dir_assoc < assoc || (dir_assoc & (dir_assoc - 1)) || dir_assoc > CACHE_MAX_ASSOC)
+		fatal("%s: cache %s: directory associativity must be power of two between "
+			"the cache associativity and %d.\n%s",
+			mem_config_file_name, mod_name, CACHE_MAX_ASSOC, err_mem_config_note);
+	if (inclusion != mod_inclusion_inclusive && num_sectors > 1)
+		fatal("%s: cache %s: non-inclusive caches cannot be sectored.\n%s",
+			mem_config_file_name, mod_name, err_mem_config_note);
 
 	/* Create module */
-	mod = mod_create(mod_name, mod_kind_cache, num_ports,
+	mod = mod_create(mod_name, mod_kind_cache, num_banks, num_ports,
 		block_size, latency);
 	
 	/* Initialize */
+	mod->bank_select = bank_select;
 	mod->mshr_size = mshr_size;
-	mod->dir_assoc = assoc;
+	mod->inclusion = inclusion;
+	mod->dir_assoc = dir_assoc;
 	mod->dir_num_sets = num_sets;
-	mod->dir_size = num_sets * assoc;
+	mod->dir_size = num_sets * dir_assoc;
 
 	/* High network */
 	net_name = config_read_string(config, section, "HighNetwork", "");
@@ -625,8 +856,11 @@ static struct mod_t *mem_config_read_cache(struct config_t *config, char *sectio
 	mod->low_net = net;
 	mod->low_net_node = net_node;
 
-	/* Create cache */
-	mod->cache = cache_create(mod->name, num_sets, block_size, assoc, policy);
+	/* Create cache. Ways beyond the associativity only keep tags and
+	 * directory entries. */
+	mod->cache = cache_create(mod->name, num_sets, block_size, dir_assoc, policy,
+		num_sectors);
+	cache_set_data_assoc(mod->cache, assoc);
 
 	/* Return */
 	return mod;
@@ -640,9 +874,13 @@ static struct mod_t *mem_config_read_main_memory(struct config_t *config, char *
 	int block_size;
 	int latency;
 	int num_ports;
+	int num_banks;
 	int dir_size;
 	int dir_assoc;
 
+	char *bank_select_str;
+	enum mod_bank_select_t bank_select;
+
 	char *net_name;
 	char *net_node_name;
 
@@ -657,6 +895,8 @@ static struct mod_t *mem_config_read_main_memory(struct config_t *config, char *
 	block_size = config_read_int(config, section, "BlockSize", 64);
 	latency = config_read_int(config, section, "Latency", 1);
 	num_ports = config_read_int(config, section, "Ports", 2);
+	num_banks = config_read_int(config, section, "Banks", 1);
+	bank_select_str = config_read_string(config, section, "BankSelect", "Block");
 	dir_size = config_read_int(config, section, "DirectorySize", 1024);
 	dir_assoc = config_read_int(config, section, "DirectoryAssoc", 8);
 
@@ -670,19 +910,28 @@ static struct mod_t *mem_config_read_main_memory(struct config_t *config, char *
 	if (num_ports < 1)
 		fatal("%s: %s: invalid value for variable 'NumPorts'.\n%s",
 			mem_config_file_name, mod_name, err_mem_config_note);
+	if (num_banks < 1 || (num_banks & (num_banks - 1)))
+		fatal("%s: %s: number of banks must be a power of two.\n%s",
+			mem_config_file_name, mod_name, err_mem_config_note);
+	bank_select = map_string_case(&mod_bank_select_map, bank_select_str);
+	if (bank_select == mod_bank_select_invalid)
+		fatal("%s: %s: %s: invalid bank select function.\n%s",
+			mem_config_file_name, mod_name,
+			bank_select_str, err_mem_config_note);
 	if (dir_size < 1 || (dir_size & (dir_size - 1)))
 		fatal("%s: %s: directory size must be a power of two.\n%s",
 			mem_config_file_name, mod_name, err_mem_config_note);
-	if (dir_assoc < 1 || (dir_assoc & (dir_assoc - 1)))
-		fatal("%s: %s: directory associativity must be a power of two.\n%s",
-			mem_config_file_name, mod_name, err_mem_config_note);
+	if (dir_assoc < 1 || (dir_assoc & (dir_assoc - 1)) || dir_assoc > CACHE_MAX_ASSOC)
+		fatal("%s: %s: directory associativity must be a power of two not greater than %d.\n%s",
+			mem_config_file_name, mod_name, CACHE_MAX_ASSOC, err_mem_config_note);
 	if (dir_assoc > dir_size)
 		fatal("%s: %s: invalid directory associativity.\n%s",
 			mem_config_file_name, mod_name, err_mem_config_note);
 
 	/* Create module */
-	mod = mod_create(mod_name, mod_kind_main_memory, num_ports,
+	mod = mod_create(mod_name, mod_kind_main_memory, num_banks, num_ports,
 			block_size, latency);
+	mod->bank_select = bank_select;
 
 	/* Store directory size */
 	mod->dir_size = dir_size;
@@ -699,7 +948,7 @@ static struct mod_t *mem_config_read_main_memory(struct config_t *config, char *
 
 	/* Create cache and directory */
 	mod->cache = cache_create(mod->name, dir_size / dir_assoc, block_size,
-			dir_assoc, cache_policy_lru);
+			dir_assoc, cache_policy_lru, 1);
 
 	/* Return */
 	return mod;
@@ -821,6 +1070,193 @@ invalid_format:
 }
 
 
+static void mem_config_read_module_stack_distance(struct config_t *config,
+	struct mod_t *mod, char *section)
+{
+	int min_sets;
+	int max_sets;
+	int max_assoc;
+
+	/* Disabled */
+	if (!config_read_bool(config, section, "StackDistance", 0))
+		return;
+
+	/* Read values */
+	min_sets = config_read_int(config, section, "StackDistanceMinSets", 1);
+	max_sets = config_read_int(config, section, "StackDistanceMaxSets", 16384);
+	max_assoc = config_read_int(config, section, "StackDistanceMaxAssoc", 16);
+
+	/* Checks */
+	if (min_sets < 1 || (min_sets & (min_sets - 1)))
+		fatal("%s: %s: 'StackDistanceMinSets' must be a power of two.\n%s",
+			mem_config_file_name, mod->name, err_mem_config_note);
+	if (max_sets < min_sets || (max_sets & (max_sets - 1)) || max_sets > (1 << 24))
+		fatal("%s: %s: 'StackDistanceMaxSets' must be a power of two between\n"
+			"\t'StackDistanceMinSets' and %d.\n%s",
+			mem_config_file_name, mod->name, 1 << 24, err_mem_config_note);
+	if (max_assoc < 1 || (max_assoc & (max_assoc - 1)) || max_assoc > CACHE_MAX_ASSOC)
+		fatal("%s: %s: 'StackDistanceMaxAssoc' must be a power of two between 1 and %d.\n%s",
+			mem_config_file_name, mod->name, CACHE_MAX_ASSOC, err_mem_config_note);
+
+	/* Create */
+	mod->sdist = sdist_create(mod->name, mod->block_size, min_sets, max_sets,
+		max_assoc);
+	if (mod->range_kind == mod_range_interleaved)
+		mod->sdist->set_div = mod->range.interleaved.mod;
+}
+
+
+static void mem_config_read_module_dram(struct config_t *config,
+	struct mod_t *mod, char *section)
+{
+	char buf[MAX_STRING_SIZE];
+	char *dram_name;
+
+	int num_channels;
+	int num_ranks;
+	int num_banks;
+	int row_size;
+
+	char *page_policy_str;
+	char *scheduler_str;
+	enum dram_page_policy_t page_policy;
+	enum dram_scheduler_t scheduler;
+
+	struct dram_t *dram;
+	int i;
+
+	/* DRAM timing model. Without it, main memory has a fixed latency. */
+	dram_name = config_read_string(config, section, "DRAM", "");
+	if (!*dram_name)
+		return;
+	if (mod->kind != mod_kind_main_memory)
+		fatal("%s: %s: variable 'DRAM' only valid for main memory modules.\n%s",
+			mem_config_file_name, mod->name, err_mem_config_note);
+
+	/* Read organization */
+	snprintf(buf, sizeof buf, "DRAM %s", dram_name);
+	config_section_enforce(config, buf);
+	num_channels = config_read_int(config, buf, "Channels", 1);
+	num_ranks = config_read_int(config, buf, "Ranks", 1);
+	num_banks = config_read_int(config, buf, "Banks", 8);
+	row_size = config_read_int(config, buf, "RowSize", 2048);
+	page_policy_str = config_read_string(config, buf, "PagePolicy", "Open");
+	scheduler_str = config_read_string(config, buf, "Scheduler", "FRFCFS");
+
+	/* Checks */
+	page_policy = map_string_case(&dram_page_policy_map, page_policy_str);
+	if (page_policy == dram_page_policy_invalid)
+		fatal("%s: DRAM %s: %s: invalid page policy.\n%s",
+			mem_config_file_name, dram_name, page_policy_str,
+			err_mem_config_note);
+	scheduler = map_string_case(&dram_scheduler_map, scheduler_str);
+	if (scheduler == dram_scheduler_invalid)
+		fatal("%s: DRAM %s: %s: invalid scheduler.\n%s",
+			mem_config_file_name, dram_name, scheduler_str,
+			err_mem_config_note);
+	if (num_channels < 1 || num_ranks < 1 || num_banks < 1)
+		fatal("%s: DRAM %s: invalid number of channels, ranks, or banks.\n%s",
+			mem_config_file_name, dram_name, err_mem_config_note);
+	if (row_size < mod->block_size || (row_size & (row_size - 1)))
+		fatal("%s: DRAM %s: row size must be a power of two and at least the\n"
+			"\tblock size of module %s.\n%s", mem_config_file_name,
+			dram_name, mod->name, err_mem_config_note);
+
+	/* Create */
+	dram = dram_create(mod->name, mod->block_size, num_channels, num_ranks,
+		num_banks, row_size);
+	dram->page_policy = page_policy;
+	dram->scheduler = scheduler;
+	if (mod->range_kind == mod_range_interleaved)
+		dram->block_div = mod->range.interleaved.mod;
+	mod->dram = dram;
+
+	/* Timing */
+	dram->t_cas = config_read_int(config, buf, "tCAS", 41);
+	dram->t_rcd = config_read_int(config, buf, "tRCD", 41);
+	dram->t_rp = config_read_int(config, buf, "tRP", 41);
+	dram->t_ras = config_read_int(config, buf, "tRAS", 105);
+	dram->t_burst = config_read_int(config, buf, "tBurst", 15);
+	dram->t_refi = config_read_int(config, buf, "tREFI", 23400);
+	dram->t_rfc = config_read_int(config, buf, "tRFC", 480);
+	if (dram->t_cas < 1 || dram->t_rcd < 0 || dram->t_rp < 0 || dram->t_ras < 0
+		|| dram->t_burst < 1 || dram->t_refi < 0 || dram->t_rfc < 0)
+		fatal("%s: DRAM %s: invalid timing parameter.\n%s",
+			mem_config_file_name, dram_name, err_mem_config_note);
+	for (i = 0; i < dram->num_channels; i++)
+		dram->channels[i].next_refresh_cycle = dram->t_refi;
+}
+
+
+static void mem_config_read_module_prefetcher(struct config_t *config,
+	struct mod_t *mod, char *section)
+{
+	char *kind_str;
+	enum prefetcher_kind_t kind;
+
+	int degree;
+	int distance;
+	int table_size;
+
+	/* No prefetcher */
+	kind_str = config_read_string(config, section, "Prefetcher", "None");
+	if (!strcasecmp(kind_str, "None"))
+		return;
+	if (mod->kind != mod_kind_cache)
+		fatal("%s: %s: variable 'Prefetcher' only valid for cache modules.\n%s",
+			mem_config_file_name, mod->name, err_mem_config_note);
+
+	/* Read values */
+	degree = config_read_int(config, section, "PrefetcherDegree", 2);
+	distance = config_read_int(config, section, "PrefetcherDistance", 8);
+	table_size = config_read_int(config, section, "PrefetcherTableSize", 64);
+
+	/* Checks */
+	kind = map_string_case(&prefetcher_kind_map, kind_str);
+	if (kind == prefetcher_kind_invalid)
+		fatal("%s: %s: %s: invalid prefetcher.\n%s",
+			mem_config_file_name, mod->name, kind_str, err_mem_config_note);
+	if (degree < 1)
+		fatal("%s: %s: invalid value for variable 'PrefetcherDegree'.\n%s",
+			mem_config_file_name, mod->name, err_mem_config_note);
+	if (distance < 1)
+		fatal("%s: %s: invalid value for variable 'PrefetcherDistance'.\n%s",
+			mem_config_file_name, mod->name, err_mem_config_note);
+	if (table_size < 1)
+		fatal("%s: %s: invalid value for variable 'PrefetcherTableSize'.\n%s",
+			mem_config_file_name, mod->name, err_mem_config_note);
+
+	/* Create */
+	mod->prefetcher = prefetcher_create(mod->name, kind, mod->block_size,
+		mod->cache->num_sets * mod->cache->assoc, table_size);
+	mod->prefetcher->degree = degree;
+	mod->prefetcher->distance = distance;
+}
+
+
+static void mem_config_read_module_directory(struct config_t *config,
+	struct mod_t *mod, char *section)
+{
+	char *format;
+	int num_pointers;
+
+	/* Full-map directory */
+	format = config_read_string(config, section, "DirectoryFormat", "FullMap");
+	if (!strcasecmp(format, "FullMap"))
+		return;
+	if (strcasecmp(format, "Sparse"))
+		fatal("%s: %s: %s: invalid directory format.\n%s",
+			mem_config_file_name, mod->name, format, err_mem_config_note);
+
+	/* Sparse directory */
+	num_pointers = config_read_int(config, section, "DirectoryPointers", 4);
+	if (num_pointers < 1)
+		fatal("%s: %s: invalid value for variable 'DirectoryPointers'.\n%s",
+			mem_config_file_name, mod->name, err_mem_config_note);
+	mod->dir_num_pointers = num_pointers;
+}
+
+
 static void mem_config_read_modules(struct config_t *config)
 {
 	struct mod_t *mod;
@@ -855,6 +1291,18 @@ static void mem_config_read_modules(struct config_t *config)
 		/* Read module address range */
 		mem_config_read_module_address_range(config, mod, section);
 
+		/* Stack distance analysis */
+		mem_config_read_module_stack_distance(config, mod, section);
+
+		/* DRAM timing model */
+		mem_config_read_module_dram(config, mod, section);
+
+		/* Prefetcher */
+		mem_config_read_module_prefetcher(config, mod, section);
+
+		/* Directory format */
+		mem_config_read_module_directory(config, mod, section);
+
 		/* Add module */
 		list_add(mem_system->mod_list, mod);
 		mem_debug("\t%s\n", mod_name);
@@ -983,6 +1431,170 @@ static void mem_config_read_low_modules(struct config_t *config)
 }
 
 
+static void mem_config_read_tlbs(struct config_t *config)
+{
+	struct tlb_t *tlb;
+
+	char *section;
+	char *tlb_name;
+	char *next_name;
+
+	char buf[MAX_STRING_SIZE];
+
+	int num_sets;
+	int assoc;
+	int latency;
+	int mshr_size;
+	int i;
+
+	/* Create TLBs */
+	for (section = config_section_first(config); section; section = config_section_next(config))
+	{
+		/* Section for a TLB */
+		if (strncasecmp(section, "TLB ", 4))
+			continue;
+		tlb_name = section + 4;
+
+		/* Read values */
+		num_sets = config_read_int(config, section, "Sets", 16);
+		assoc = config_read_int(config, section, "Assoc", 4);
+		latency = config_read_int(config, section, "Latency", 1);
+		mshr_size = config_read_int(config, section, "MSHR", 4);
+		config_var_allow(config, section, "Next");
+
+		/* Checks */
+		if (num_sets < 1 || (num_sets & (num_sets - 1)))
+			fatal("%s: TLB %s: number of sets must be a power of two.\n%s",
+				mem_config_file_name, tlb_name, err_mem_config_note);
+		if (assoc < 1)
+			fatal("%s: TLB %s: invalid value for variable 'Assoc'.\n%s",
+				mem_config_file_name, tlb_name, err_mem_config_note);
+		if (latency < 0)
+			fatal("%s: TLB %s: invalid value for variable 'Latency'.\n%s",
+				mem_config_file_name, tlb_name, err_mem_config_note);
+		if (mshr_size < 1)
+			fatal("%s: TLB %s: invalid value for variable 'MSHR'.\n%s",
+				mem_config_file_name, tlb_name, err_mem_config_note);
+
+		/* Create TLB */
+		tlb = tlb_create(tlb_name, num_sets, assoc, latency, mshr_size);
+		list_add(mem_system->tlb_list, tlb);
+	}
+
+	/* Add TLB pointers to configuration file */
+	for (i = 0; i < list_count(mem_system->tlb_list); i++)
+	{
+		tlb = list_get(mem_system->tlb_list, i);
+		snprintf(buf, sizeof buf, "TLB %s", tlb->name);
+		config_write_ptr(config, buf, "ptr", tlb);
+	}
+
+	/* Lower-level TLBs */
+	for (i = 0; i < list_count(mem_system->tlb_list); i++)
+	{
+		tlb = list_get(mem_system->tlb_list, i);
+		snprintf(buf, sizeof buf, "TLB %s", tlb->name);
+		next_name = config_read_string(config, buf, "Next", "");
+		if (!*next_name)
+			continue;
+		snprintf(buf, sizeof buf, "TLB %s", next_name);
+		if (!config_section_exists(config, buf))
+			fatal("%s: TLB %s: invalid TLB in variable 'Next'.\n%s",
+				mem_config_file_name, tlb->name, err_mem_config_note);
+		tlb->next = config_read_ptr(config, buf, "ptr", NULL);
+		assert(tlb->next);
+	}
+
+	/* Check that there are no cycles of TLBs */
+	for (i = 0; i < list_count(mem_system->tlb_list); i++)
+	{
+		struct tlb_t *next;
+		int levels;
+
+		tlb = list_get(mem_system->tlb_list, i);
+		levels = 0;
+		for (next = tlb; next; next = next->next)
+			if (++levels > list_count(mem_system->tlb_list))
+				fatal("%s: TLB %s: cycle of lower-level TLBs.\n%s",
+					mem_config_file_name, tlb->name, err_mem_config_note);
+	}
+}
+
+
+/* Return the TLB named 'tlb_name' given in a CPU entry, or NULL if empty */
+static struct tlb_t *mem_config_get_tlb(struct config_t *config, char *tlb_name)
+{
+	struct tlb_t *tlb;
+	char buf[MAX_STRING_SIZE];
+
+	if (!*tlb_name)
+		return NULL;
+	snprintf(buf, sizeof buf, "TLB %s", tlb_name);
+	if (!config_section_exists(config, buf))
+		fatal("%s: %s: invalid TLB in CPU entry.\n%s",
+			mem_config_file_name, tlb_name, err_mem_config_note);
+	tlb = config_read_ptr(config, buf, "ptr", NULL);
+	assert(tlb);
+	return tlb;
+}
+
+
+/* Add 'mod' to the list of NUMA nodes if it is a main memory module, or the
+ * main memory modules below it otherwise. */
+static void mem_config_add_numa_node(struct mod_t *mod)
+{
+	struct mod_t *low_mod;
+
+	/* Main memory */
+	if (mod->kind == mod_kind_main_memory)
+	{
+		if (list_index_of(mem_system->node_list, mod) < 0)
+			list_add(mem_system->node_list, mod);
+		return;
+	}
+
+	/* Lower modules */
+	for (linked_list_head(mod->low_mod_list); !linked_list_is_end(mod->low_mod_list);
+		linked_list_next(mod->low_mod_list))
+	{
+		low_mod = linked_list_get(mod->low_mod_list);
+		mem_config_add_numa_node(low_mod);
+	}
+}
+
+
+/* Build the list of NUMA nodes, formed by the main memory modules accessible
+ * from CPU entries, in the order they are defined. */
+static void mem_config_add_numa_nodes(void)
+{
+	struct mod_t *mod;
+
+	int core;
+	int thread;
+	int i;
+
+	/* Main memory modules accessible from CPU entries */
+	FOREACH_CORE FOREACH_THREAD
+	{
+		mem_config_add_numa_node(THREAD.data_mod);
+		mem_config_add_numa_node(THREAD.inst_mod);
+		if (THREAD.local_mem && list_index_of(mem_system->node_list,
+				THREAD.local_mem) < 0)
+			fatal("%s: local memory %s of CPU core %d - thread %d not accessible from its entry modules.\n%s",
+				mem_config_file_name, THREAD.local_mem->name,
+				core, thread, err_mem_config_note);
+	}
+
+	/* Sort as in the module list */
+	for (i = 0; i < list_count(mem_system->mod_list); i++)
+	{
+		mod = list_get(mem_system->mod_list, i);
+		if (list_remove(mem_system->node_list, mod))
+			list_add(mem_system->node_list, mod);
+	}
+}
+
+
 static void mem_config_read_cpu_entries(struct config_t *config)
 {
 	struct mod_t *mod;
@@ -1000,6 +1612,9 @@ static void mem_config_read_cpu_entries(struct config_t *config)
 	{
 		char data_mod_name[MAX_STRING_SIZE];
 		char inst_mod_name[MAX_STRING_SIZE];
+		char data_tlb_name[MAX_STRING_SIZE];
+		char inst_tlb_name[MAX_STRING_SIZE];
+		char local_mem_name[MAX_STRING_SIZE];
 	} *entry, *entry_list;
 
 	/* Allocate entry list */
@@ -1046,6 +1661,9 @@ static void mem_config_read_cpu_entries(struct config_t *config)
 		{
 			config_var_allow(config, section, "DataModule");
 			config_var_allow(config, section, "InstModule");
+			config_var_allow(config, section, "DataTLB");
+			config_var_allow(config, section, "InstTLB");
+			config_var_allow(config, section, "LocalMemory");
 			warning("%s: entry %s ignored.\n%s",
 				mem_config_file_name, entry_name, err_mem_ignored_entry);
 			continue;
@@ -1070,6 +1688,16 @@ static void mem_config_read_cpu_entries(struct config_t *config)
 			fatal("%s: entry %s: wrong of missing value for 'InstModule'",
 				mem_config_file_name, entry_name);
 		snprintf(entry->inst_mod_name, MAX_STRING_SIZE, "%s", value);
+
+		/* Get entry TLBs */
+		snprintf(entry->data_tlb_name, MAX_STRING_SIZE, "%s",
+			config_read_string(config, section, "DataTLB", ""));
+		snprintf(entry->inst_tlb_name, MAX_STRING_SIZE, "%s",
+			config_read_string(config, section, "InstTLB", ""));
+
+		/* Get local main memory module */
+		snprintf(entry->local_mem_name, MAX_STRING_SIZE, "%s",
+			config_read_string(config, section, "LocalMemory", ""));
 	}
 
 	/* Stop here if we are doing CPU functional simulation */
@@ -1111,8 +1739,33 @@ static void mem_config_read_cpu_entries(struct config_t *config)
 		THREAD.inst_mod = mod;
 		mem_debug("\tCPU core %d - thread %d - instructions -> %s\n",
 			core, thread, mod->name);
+
+		/* Assign TLBs */
+		THREAD.data_tlb = mem_config_get_tlb(config, entry->data_tlb_name);
+		THREAD.inst_tlb = mem_config_get_tlb(config, entry->inst_tlb_name);
+
+		/* Assign local main memory module */
+		if (*entry->local_mem_name)
+		{
+			snprintf(buf, sizeof buf, "Module %s", entry->local_mem_name);
+			if (!config_section_exists(config, buf))
+				fatal("%s: invalid local memory for CPU core %d - thread %d",
+					mem_config_file_name, core, thread);
+			mod = config_read_ptr(config, buf, "ptr", NULL);
+			assert(mod);
+			if (mod->kind != mod_kind_main_memory)
+				fatal("%s: local memory for CPU core %d - thread %d is not a main memory module",
+					mem_config_file_name, core, thread);
+			THREAD.local_mem = mod;
+		}
+		else if (mmu_placement == mmu_placement_first_touch)
+			fatal("%s: no local memory given for CPU core %d - thread %d.\n%s",
+				mem_config_file_name, core, thread, err_mem_config_note);
 	}
 
+	/* NUMA nodes */
+	mem_config_add_numa_nodes();
+
 	/* Debug */
 	mem_debug("\n");
 
@@ -1469,7 +2122,8 @@ static void mem_config_calculate_sub_block_sizes(void)
 
 		/* Create directory */
 		mod->num_sub_blocks = mod->block_size / mod->sub_block_size;
-		mod->dir = dir_create(mod->name, mod->dir_num_sets, mod->dir_assoc, mod->num_sub_blocks, num_nodes);
+		mod->dir = dir_create(mod->name, mod->dir_num_sets, mod->dir_assoc, mod->num_sub_blocks,
+			num_nodes, mod->dir_num_pointers);
 		mem_debug("\t%s - %dx%dx%d (%dx%dx%d effective) - %d entries, %d sub-blocks\n",
 			mod->name, mod->dir_num_sets, mod->dir_assoc, num_nodes,
 			mod->dir_num_sets, mod->dir_assoc, linked_list_count(mod->high_mod_list),
@@ -1481,6 +2135,65 @@ static void mem_config_calculate_sub_block_sizes(void)
 }
 
 
+/* Check that a module reachable from GPU global memory, and all its
+ * lower-level modules, are inclusive */
+static void mem_config_check_gpu_inclusion(struct mod_t *mod)
+{
+	struct mod_t *low_mod;
+
+	if (mod->inclusion != mod_inclusion_inclusive)
+		fatal("%s: %s: non-inclusive caches are not supported in GPU memory hierarchies.\n%s",
+			mem_config_file_name, mod->name, err_mem_config_note);
+	for (linked_list_head(mod->low_mod_list); !linked_list_is_end(mod->low_mod_list);
+		linked_list_next(mod->low_mod_list))
+	{
+		low_mod = linked_list_get(mod->low_mod_list);
+		mem_config_check_gpu_inclusion(low_mod);
+	}
+}
+
+
+static void mem_config_check_inclusion(void)
+{
+	struct mod_t *mod;
+	struct mod_t *high_mod;
+
+	int compute_unit_id;
+	int i;
+
+	/* Non-inclusive caches */
+	for (i = 0; i < list_count(mem_system->mod_list); i++)
+	{
+		mod = list_get(mem_system->mod_list, i);
+		if (mod->inclusion == mod_inclusion_inclusive)
+			continue;
+		if (!linked_list_count(mod->high_mod_list))
+			fatal("%s: %s: non-inclusive caches need upper-level caches.\n%s",
+				mem_config_file_name, mod->name, err_mem_config_note);
+		if (mod->num_sub_blocks != 1)
+			fatal("%s: %s: upper-level caches of non-inclusive caches must have "
+				"the same block size.\n%s",
+				mem_config_file_name, mod->name, err_mem_config_note);
+		for (linked_list_head(mod->high_mod_list); !linked_list_is_end(mod->high_mod_list);
+			linked_list_next(mod->high_mod_list))
+		{
+			high_mod = linked_list_get(mod->high_mod_list);
+			if (high_mod->cache && high_mod->cache->num_sectors > 1)
+				fatal("%s: %s: upper-level caches of non-inclusive caches cannot be "
+					"sectored.\n%s",
+					mem_config_file_name, mod->name, err_mem_config_note);
+		}
+	}
+
+	/* GPU memory hierarchy */
+	if (gpu_sim_kind == gpu_sim_detailed)
+	{
+		FOREACH_COMPUTE_UNIT(compute_unit_id)
+			mem_config_check_gpu_inclusion(gpu->compute_units[compute_unit_id]->global_memory);
+	}
+}
+
+
 static void mem_config_set_mod_level(struct mod_t *mod, int level)
 {
 	struct mod_t *low_mod;
@@ -1625,6 +2338,9 @@ void mem_system_config_read(void)
 	/* Read low level caches */
 	mem_config_read_low_modules(config);
 
+	/* Read TLBs */
+	mem_config_read_tlbs(config);
+
 	/* Read memory system entries */
 	mem_config_read_cpu_entries(config);
 	mem_config_read_gpu_entries(config);
@@ -1645,6 +2361,9 @@ void mem_system_config_read(void)
 	/* Compute sub-block sizes, based on high modules */
 	mem_config_calculate_sub_block_sizes();
 
+	/* Check restrictions of non-inclusive caches */
+	mem_config_check_inclusion();
+
 	/* Compute cache levels relative to the CPU/GPU entry points */
 	mem_config_calculate_mod_levels();
 
@@ -82,6 +82,13 @@ int EV_MOD_PEER_RECEIVE;
 int EV_MOD_PEER_REPLY_ACK;
 int EV_MOD_PEER_FINISH;
 
+int EV_MOD_SECTOR_FILL;
+int EV_MOD_SECTOR_FILL_RECEIVE;
+int EV_MOD_SECTOR_FILL_ACTION;
+int EV_MOD_SECTOR_FILL_MISS;
+int EV_MOD_SECTOR_FILL_REPLY;
+int EV_MOD_SECTOR_FILL_FINISH;
+
 
 
 
@@ -108,6 +115,10 @@ void mod_handler_load(int event, void *data)
 		mem_trace("mem.new_access_mod mod=\"%s\" access=\"A-%lld\"\n",
 			mod->name, stack->id);
 
+		/* A prefetch of the block that is still in flight is late */
+		if (mod->prefetcher)
+			prefetcher_check_late(mod, stack);
+
 		/* Record access */
 		mod_access_start(mod, stack, mod_access_read);
 
@@ -185,9 +196,34 @@ void mod_handler_load(int event, void *data)
 			return;
 		}
 
+		/* Sectors needed. Prefetches bring the whole block. */
+		stack->sectors = stack->prefetch ?
+			mod_get_sectors(mod, stack->tag, mod->block_size) :
+			mod_get_sectors(mod, stack->addr, 1);
+
 		/* Hit */
 		if (stack->state)
 		{
+			uint32_t valid_sectors;
+
+			/* Sector miss. The block stays in its state, and only the
+			 * missing sectors are brought from the lower level. */
+			cache_get_sectors(mod->cache, stack->set, stack->way,
+				&valid_sectors, NULL);
+			if (stack->sectors & ~valid_sectors)
+			{
+				stack->sector_miss = 1;
+				new_stack = mod_stack_create(stack->id, mod, stack->tag,
+					EV_MOD_LOAD_MISS, stack);
+				new_stack->sectors = stack->sectors & ~valid_sectors;
+				new_stack->target_mod = mod_get_low_mod(mod, stack->tag);
+				new_stack->request_dir = mod_request_up_down;
+				new_stack->src_set = stack->set;
+				new_stack->src_way = stack->way;
+				esim_schedule_event(EV_MOD_SECTOR_FILL, new_stack, 0);
+				return;
+			}
+
 			esim_schedule_event(EV_MOD_LOAD_UNLOCK, stack, 0);
 			return;
 		}
@@ -195,7 +231,9 @@ void mod_handler_load(int event, void *data)
 		/* Miss */
 		new_stack = mod_stack_create(stack->id, mod, stack->tag,
 			EV_MOD_LOAD_MISS, stack);
+		new_stack->eip = stack->eip;
 		new_stack->peer = mod;
+		new_stack->sectors = stack->sectors;
 		new_stack->target_mod = mod_get_low_mod(mod, stack->tag);
 		new_stack->request_dir = mod_request_up_down;
 		esim_schedule_event(EV_MOD_READ_REQUEST, new_stack, 0);
@@ -219,14 +257,31 @@ void mod_handler_load(int event, void *data)
 			dir_entry_unlock(mod->dir, stack->set, stack->way);
 			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
 			stack->retry = 1;
+			stack->sector_miss = 0;
 			esim_schedule_event(EV_MOD_LOAD_LOCK, stack, retry_lat);
 			return;
 		}
 
+		/* Sectors were filled into the block present */
+		if (stack->sector_miss)
+		{
+			stack->sector_miss = 0;
+			esim_schedule_event(EV_MOD_LOAD_UNLOCK, stack, 0);
+			return;
+		}
+
 		/* Set block state to excl/shared depending on return var 'shared'.
 		 * Also set the tag of the block. */
 		cache_set_block(mod->cache, stack->set, stack->way, stack->tag,
 			stack->shared ? cache_block_shared : cache_block_exclusive);
+		mod_fill_sectors(mod, stack->set, stack->way, stack->sectors, 0);
+		mod_fill_data(mod, stack->set, stack->way);
+
+		/* Flag block brought by a prefetch, unless a demand access is
+		 * already waiting for it. */
+		if (stack->prefetch && !stack->prefetch_late)
+			mod->prefetcher->prefetched[CACHE_BLOCK_INDEX(mod->cache,
+				stack->set, stack->way)] = 1;
 
 		/* Continue */
 		esim_schedule_event(EV_MOD_LOAD_UNLOCK, stack, 0);
@@ -295,6 +350,10 @@ void mod_handler_store(int event, void *data)
 		mem_trace("mem.new_access_mod mod=\"%s\" access=\"A-%lld\"\n",
 			mod->name, stack->id);
 
+		/* A prefetch of the block that is still in flight is late */
+		if (mod->prefetcher)
+			prefetcher_check_late(mod, stack);
+
 		/* Record access */
 		mod_access_start(mod, stack, mod_access_write);
 
@@ -322,8 +381,12 @@ void mod_handler_store(int event, void *data)
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:store_lock\"\n",
 			stack->id, mod->name);
 
-		/* If there is any older access, wait for it */
+		/* If there is any older access, wait for it. Prefetches of other
+		 * blocks do not need to be ordered with the store. */
 		older_stack = stack->access_list_prev;
+		while (older_stack && older_stack->prefetch && older_stack->addr >>
+			mod->log_block_size != stack->addr >> mod->log_block_size)
+			older_stack = older_stack->access_list_prev;
 		if (older_stack)
 		{
 			mem_debug("    %lld wait for access %lld\n",
@@ -362,10 +425,31 @@ void mod_handler_store(int event, void *data)
 			return;
 		}
 
+		/* Sector written */
+		stack->sectors = mod_get_sectors(mod, stack->addr, 1);
+
 		/* Hit - state=M/E */
 		if (stack->state == cache_block_modified ||
 			stack->state == cache_block_exclusive)
 		{
+			uint32_t valid_sectors;
+
+			/* Sector miss. Bring the sector from the lower level. */
+			cache_get_sectors(mod->cache, stack->set, stack->way,
+				&valid_sectors, NULL);
+			if (stack->sectors & ~valid_sectors)
+			{
+				new_stack = mod_stack_create(stack->id, mod, stack->tag,
+					EV_MOD_STORE_UNLOCK, stack);
+				new_stack->sectors = stack->sectors;
+				new_stack->target_mod = mod_get_low_mod(mod, stack->tag);
+				new_stack->request_dir = mod_request_up_down;
+				new_stack->src_set = stack->set;
+				new_stack->src_way = stack->way;
+				esim_schedule_event(EV_MOD_SECTOR_FILL, new_stack, 0);
+				return;
+			}
+
 			esim_schedule_event(EV_MOD_STORE_UNLOCK, stack, 0);
 			return;
 		}
@@ -373,7 +457,9 @@ void mod_handler_store(int event, void *data)
 		/* Miss - state=O/S/I */
 		new_stack = mod_stack_create(stack->id, mod, stack->tag,
 			EV_MOD_STORE_UNLOCK, stack);
+		new_stack->eip = stack->eip;
 		new_stack->peer = mod;
+		new_stack->sectors = stack->sectors;
 		new_stack->target_mod = mod_get_low_mod(mod, stack->tag);
 		new_stack->request_dir = mod_request_up_down;
 		esim_schedule_event(EV_MOD_WRITE_REQUEST, new_stack, 0);
@@ -404,6 +490,8 @@ void mod_handler_store(int event, void *data)
 		/* Update tag/state and unlock */
 		cache_set_block(mod->cache, stack->set, stack->way,
 			stack->tag, cache_block_modified);
+		mod_fill_sectors(mod, stack->set, stack->way, stack->sectors, 1);
+		mod_fill_data(mod, stack->set, stack->way);
 		dir_entry_unlock(mod->dir, stack->set, stack->way);
 
 		/* Continue */
@@ -438,6 +526,37 @@ void mod_handler_store(int event, void *data)
 }
 
 
+/* Return 1 if the access looking for a block in a non-inclusive cache brings
+ * its data into the cache, needing a data frame. Read and write requests from
+ * upper levels only do on misses in caches that are not exclusive, or on read
+ * hits of blocks whose data was dropped, brought again from the upper-level
+ * owner. Evictions from upper levels carry the data of all blocks but shared
+ * ones. */
+static int mod_find_and_lock_need_data(struct mod_stack_t *stack)
+{
+	struct mod_stack_t *ret = stack->ret_stack;
+	struct mod_t *mod = stack->mod;
+	int event = stack->ret_event;
+
+	if (!mod->cache->data)
+		return 0;
+	if (event == EV_MOD_LOAD_ACTION || event == EV_MOD_STORE_ACTION)
+		return !stack->hit;
+	if ((event == EV_MOD_READ_REQUEST_ACTION || event == EV_MOD_WRITE_REQUEST_ACTION) &&
+		ret->request_dir == mod_request_up_down)
+	{
+		if (!stack->hit)
+			return mod->inclusion == mod_inclusion_non_inclusive;
+		return stack->read && !cache_block_has_data(mod->cache,
+			stack->set, stack->way);
+	}
+	if (event == EV_MOD_EVICT_WRITEBACK)
+		return stack->hit && ret->state != cache_block_shared &&
+			!cache_block_has_data(mod->cache, stack->set, stack->way);
+	return 0;
+}
+
+
 void mod_handler_find_and_lock(int event, void *data)
 {
 	struct mod_stack_t *stack = data;
@@ -471,6 +590,9 @@ void mod_handler_find_and_lock(int event, void *data)
 		struct mod_port_t *port = stack->port;
 		struct dir_lock_t *dir_lock;
 
+		int need_data;
+		int data_way;
+
 		assert(stack->port);
 		mem_debug("  %lld %lld 0x%x %s find and lock port\n", esim_cycle, stack->id,
 			stack->addr, mod->name);
@@ -512,6 +634,8 @@ void mod_handler_find_and_lock(int event, void *data)
 		}
 		if (!stack->retry)
 		{
+			if (mod->sdist)
+				sdist_access(mod->sdist, stack->addr);
 			mod->no_retry_accesses++;
 			if (stack->hit)
 				mod->no_retry_hits++;
@@ -529,11 +653,15 @@ void mod_handler_find_and_lock(int event, void *data)
 			}
 		}
 
+		/* A prefetch of the block that is still in flight is late */
+		if (mod->prefetcher)
+			prefetcher_check_late(mod, stack);
+
 		/* Miss */
 		if (!stack->hit)
 		{
 			/* Find victim */
-			stack->way = cache_replace_block(mod->cache, stack->set);
+			stack->way = mod_replace_block(mod, stack->set);
 			cache_get_block(mod->cache, stack->set, stack->way, NULL, &stack->state);
 			assert(stack->state || !dir_entry_group_shared_or_owned(mod->dir,
 				stack->set, stack->way));
@@ -542,6 +670,35 @@ void mod_handler_find_and_lock(int event, void *data)
 				map_value(&cache_block_state_map, stack->state));
 		}
 
+		/* Non-inclusive caches need a data frame for a block receiving its
+		 * data. On a miss, a block taking a frame is replaced instead of the
+		 * victim. On a hit, the data of another block is evicted, or an error
+		 * is returned if there is none to evict. */
+		need_data = mod_find_and_lock_need_data(stack);
+		data_way = -1;
+		if (need_data && !mod_find_data_frame(mod, stack->set, stack->way,
+			stack->hit, &data_way))
+		{
+			if (!stack->hit)
+			{
+				assert(data_way >= 0);
+				stack->way = data_way;
+				cache_get_block(mod->cache, stack->set, stack->way, NULL, &stack->state);
+				mem_debug("    %lld 0x%x %s no data frame -> way=%d, state=%s\n",
+					stack->id, stack->tag, mod->name, stack->way,
+					map_value(&cache_block_state_map, stack->state));
+			}
+			else if (data_way < 0)
+			{
+				mem_debug("    %lld 0x%x %s no data frame to free: set=%d, way=%d\n",
+					stack->id, stack->tag, mod->name, stack->set, stack->way);
+				ret->err = 1;
+				mod_unlock_port(mod, port, stack);
+				mod_stack_return(stack);
+				return;
+			}
+		}
+
 		/* If directory entry is locked and the call to FIND_AND_LOCK is not
 		 * blocking, release port and return error. */
 		dir_lock = dir_lock_get(mod->dir, stack->set, stack->way);
@@ -569,8 +726,37 @@ void mod_handler_find_and_lock(int event, void *data)
 		cache_set_transient_tag(mod->cache, stack->set, stack->way, stack->tag);
 		cache_access_block(mod->cache, stack->set, stack->way);
 
-		/* Access latency */
-		esim_schedule_event(EV_MOD_FIND_AND_LOCK_ACTION, stack, mod->latency);
+		/* Data frame of a non-inclusive cache. A frame reserved by an access
+		 * that did not get the data is released. The block whose data is
+		 * evicted on a hit is not locked, so locking it cannot fail. */
+		if (mod->cache->data)
+			cache_set_data(mod->cache, stack->set, stack->way, cache_get_data(mod->cache,
+				stack->set, stack->way) & ~CACHE_DATA_RESERVED);
+		if (stack->hit && data_way >= 0)
+		{
+			if (!dir_entry_lock(mod->dir, stack->set, data_way, EV_MOD_FIND_AND_LOCK, stack))
+				panic("%s: block evicted to free a data frame is locked", __FUNCTION__);
+			stack->data_way = data_way;
+			stack->data_eviction = 1;
+		}
+		if (need_data)
+			mod_reserve_data(mod, stack->set, stack->way);
+
+		/* Prefetcher */
+		if (mod->prefetcher)
+			prefetcher_access(mod, stack);
+
+		/* Access latency. With a DRAM model, blocks are read for every request
+		 * to main memory, and written for every dirty eviction. Clean
+		 * evictions only update the directory. */
+		if (mod->dram && stack->ret_event != EV_MOD_EVICT_WRITEBACK)
+			dram_access(mod->dram, stack->tag, 0, mod->latency,
+				EV_MOD_FIND_AND_LOCK_ACTION, stack);
+		else if (mod->dram && ret->writeback)
+			dram_access(mod->dram, stack->tag, 1, mod->latency,
+				EV_MOD_FIND_AND_LOCK_ACTION, stack);
+		else
+			esim_schedule_event(EV_MOD_FIND_AND_LOCK_ACTION, stack, mod->latency);
 		return;
 	}
 
@@ -599,6 +785,18 @@ void mod_handler_find_and_lock(int event, void *data)
 			return;
 		}
 
+		/* On hit, evict the data of the block whose frame is taken */
+		if (stack->data_eviction)
+		{
+			new_stack = mod_stack_create(stack->id, mod, 0,
+				EV_MOD_FIND_AND_LOCK_FINISH, stack);
+			new_stack->set = stack->set;
+			new_stack->way = stack->data_way;
+			new_stack->data_only = 1;
+			esim_schedule_event(EV_MOD_EVICT, new_stack, 0);
+			return;
+		}
+
 		/* Continue */
 		esim_schedule_event(EV_MOD_FIND_AND_LOCK_FINISH, stack, 0);
 		return;
@@ -614,9 +812,16 @@ void mod_handler_find_and_lock(int event, void *data)
 		/* If evict produced err, return err */
 		if (stack->err)
 		{
-			cache_get_block(mod->cache, stack->set, stack->way, NULL, &stack->state);
-			assert(stack->state);
-			assert(stack->eviction);
+			if (stack->data_eviction)
+			{
+				dir_entry_unlock(mod->dir, stack->set, stack->data_way);
+			}
+			else
+			{
+				cache_get_block(mod->cache, stack->set, stack->way, NULL, &stack->state);
+				assert(stack->state);
+				assert(stack->eviction);
+			}
 			ret->err = 1;
 			dir_entry_unlock(mod->dir, stack->set, stack->way);
 			mod_stack_return(stack);
@@ -631,6 +836,14 @@ void mod_handler_find_and_lock(int event, void *data)
 			assert(!stack->state);
 		}
 
+		/* Data eviction freeing a frame */
+		if (stack->data_eviction)
+		{
+			mod->data_evictions++;
+			assert(!cache_block_has_data(mod->cache, stack->set, stack->data_way));
+			dir_entry_unlock(mod->dir, stack->set, stack->data_way);
+		}
+
 		/* If this is a main memory, the block is here. A previous miss was just a miss
 		 * in the directory. */
 		if (mod->kind == mod_kind_main_memory && !stack->state)
@@ -691,6 +904,19 @@ void mod_handler_evict(int event, void *data)
 		stack->target_mod = mod_get_low_mod(mod, stack->tag);
 		target_mod = stack->target_mod;
 
+		/* Only the data of a block of a non-inclusive cache is evicted. The
+		 * block stays, together with its copies in upper levels. */
+		if (stack->data_only)
+		{
+			assert(mod->kind == mod_kind_cache);
+			esim_schedule_event(EV_MOD_EVICT_INVALID, stack, 0);
+			return;
+		}
+
+		/* Statistics */
+		if (dir_entry_group_shared_or_owned(mod->dir, stack->set, stack->way))
+			mod->inclusion_victims++;
+
 		/* Send write request to all sharers */
 		new_stack = mod_stack_create(stack->id, mod, 0,
 			EV_MOD_EVICT_INVALID, stack);
@@ -750,12 +976,28 @@ void mod_handler_evict(int event, void *data)
 		/* State = M/O */
 		if (stack->state == cache_block_modified ||
 			stack->state == cache_block_owned)
+		{
+			/* In sectored caches, only dirty sectors are written back */
+			stack->sectors = mod_get_writeback_sectors(mod,
+				stack->src_set, stack->src_way);
+
+			/* Send message */
+			stack->msg = net_try_send_ev(mod->low_net, mod->low_net_node,
+				low_node, mod_get_sectors_size(mod, stack->sectors) + 8,
+				EV_MOD_EVICT_RECEIVE, stack, event, stack);
+			stack->writeback = 1;
+			return;
+		}
+
+		/* State = E, with a non-inclusive lower-level cache. The data is sent
+		 * with no writeback, to be filled into the lower level if it does not
+		 * have it. */
+		if (stack->state == cache_block_exclusive && low_mod->cache->data)
 		{
 			/* Send message */
 			stack->msg = net_try_send_ev(mod->low_net, mod->low_net_node,
 				low_node, mod->block_size + 8, EV_MOD_EVICT_RECEIVE, stack,
 				event, stack);
-			stack->writeback = 1;
 			return;
 		}
 
@@ -840,6 +1082,8 @@ void mod_handler_evict(int event, void *data)
 		{
 			new_stack = mod_stack_create(stack->id, target_mod, stack->tag,
 				EV_MOD_EVICT_WRITEBACK_FINISH, stack);
+			new_stack->sectors = mod_get_request_sectors(target_mod, mod,
+				stack->src_tag, stack->sectors);
 			new_stack->target_mod = mod_get_low_mod(target_mod, stack->tag);
 			new_stack->request_dir = mod_request_up_down;
 			esim_schedule_event(EV_MOD_WRITE_REQUEST, new_stack, 0);
@@ -867,10 +1111,15 @@ void mod_handler_evict(int event, void *data)
 			return;
 		}
 
-		/* Set tag and state */
+		/* Set tag and state, and the sectors written back */
 		if (target_mod->cache)
+		{
 			cache_set_block(target_mod->cache, stack->set, stack->way, stack->tag,
 				cache_block_modified);
+			mod_fill_sectors(target_mod, stack->set, stack->way,
+				mod_get_request_sectors(target_mod, mod, stack->src_tag,
+				stack->sectors), 1);
+		}
 		esim_schedule_event(EV_MOD_EVICT_PROCESS, stack, 0);
 		return;
 	}
@@ -882,7 +1131,13 @@ void mod_handler_evict(int event, void *data)
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:evict_process\"\n",
 			stack->id, target_mod->name);
 
-		/* Remove sharer, owner, and unlock */
+		/* Data of the evicted block filled into a non-inclusive cache */
+		if (target_mod->cache && mod_fill_data(target_mod, stack->set, stack->way))
+			target_mod->victim_fills++;
+
+		/* Remove sharer, owner, and unlock. After evicting only its data, mod
+		 * keeps the block, and owns it if it was written back, since the
+		 * other sharers were invalidated. */
 		dir = target_mod->dir;
 		for (z = 0; z < dir->zsize; z++)
 		{
@@ -891,6 +1146,13 @@ void mod_handler_evict(int event, void *data)
 			if (dir_entry_tag < stack->src_tag || dir_entry_tag >= stack->src_tag + mod->block_size)
 				continue;
 			dir_entry = dir_entry_get(dir, stack->set, stack->way, z);
+			if (stack->data_only)
+			{
+				if (stack->writeback)
+					dir_entry_set_owner(dir, stack->set, stack->way, z,
+						mod->low_net_node->index);
+				continue;
+			}
 			dir_entry_clear_sharer(dir, stack->set, stack->way, z, mod->low_net_node->index);
 			if (dir_entry->owner == mod->low_net_node->index)
 				dir_entry_set_owner(dir, stack->set, stack->way, z, DIR_ENTRY_OWNER_NONE);
@@ -926,10 +1188,30 @@ void mod_handler_evict(int event, void *data)
 		/* Receive message */
 		net_receive(mod->low_net, mod->low_net_node, stack->msg);
 
+		/* After evicting only the data of a block, the block is clean, and
+		 * stays with no data. */
+		if (stack->data_only)
+		{
+			if (!stack->err)
+			{
+				if (stack->writeback)
+					cache_set_block(mod->cache, stack->src_set, stack->src_way,
+						stack->src_tag, cache_block_exclusive);
+				cache_set_data(mod->cache, stack->src_set, stack->src_way, 0);
+			}
+			esim_schedule_event(EV_MOD_EVICT_FINISH, stack, 0);
+			return;
+		}
+
 		/* Invalidate block if there was no error. */
 		if (!stack->err)
+		{
+			if (stack->writeback && mod->cache->num_sectors > 1)
+				mod->sector_writebacks += __builtin_popcount(stack->sectors);
+			mod_evict_sectors(mod, stack->src_set, stack->src_way);
 			cache_set_block(mod->cache, stack->src_set, stack->src_way,
 				0, cache_block_invalid);
+		}
 		assert(!dir_entry_group_shared_or_owned(mod->dir,
 			stack->src_set, stack->src_way));
 		esim_schedule_event(EV_MOD_EVICT_FINISH, stack, 0);
@@ -1062,18 +1344,60 @@ void mod_handler_read_request(int event, void *data)
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:read_request_updown\"\n",
 			stack->id, target_mod->name);
 
+		/* Error filling sectors */
+		if (stack->err)
+		{
+			dir_entry_unlock(target_mod->dir, stack->set, stack->way);
+			ret->err = 1;
+			ret->reply = reply_ACK_ERROR;
+			stack->reply_size = 8;
+			esim_schedule_event(EV_MOD_READ_REQUEST_REPLY, stack, 0);
+			return;
+		}
+
 		stack->pending = 1;
 
 		/* Set the initial reply message and size.  This will be adjusted later if
 		 * a transfer occur between peers. */
-		stack->reply_size = mod->block_size + 8;
+		stack->reply_size = mod_get_sectors_size(mod, stack->sectors) + 8;
 		stack->reply = reply_ACK_DATA;
-		
+
+		/* Sectors needed by the requester missing in a valid block are
+		 * brought first, and the request is processed again. */
 		if (stack->state)
 		{
+			uint32_t valid_sectors;
+			uint32_t needed_sectors;
+
+			cache_get_sectors(target_mod->cache, stack->set, stack->way,
+				&valid_sectors, NULL);
+			needed_sectors = mod_get_request_sectors(target_mod, mod,
+				stack->addr, stack->sectors);
+			if (needed_sectors & ~valid_sectors)
+			{
+				new_stack = mod_stack_create(stack->id, target_mod, stack->tag,
+					EV_MOD_READ_REQUEST_UPDOWN, stack);
+				new_stack->sectors = needed_sectors & ~valid_sectors;
+				new_stack->target_mod = mod_get_low_mod(target_mod, stack->tag);
+				new_stack->request_dir = mod_request_up_down;
+				new_stack->src_set = stack->set;
+				new_stack->src_way = stack->way;
+				esim_schedule_event(EV_MOD_SECTOR_FILL, new_stack, 0);
+				return;
+			}
+		}
+
+		if (stack->state)
+		{
+			void *owner_stacks[target_mod->dir->zsize];
+			int owner_count = 0;
+			int refetch;
+
 			/* Status = M/O/E/S
 			 * Check: address is a multiple of requester's block_size
-			 * Check: no sub-block requested by mod is already owned by mod */
+			 * Check: no sub-block requested by mod is already owned by mod,
+			 * unless mod is a non-inclusive cache bringing again the data it
+			 * dropped */
 			assert(stack->addr % mod->block_size == 0);
 			dir = target_mod->dir;
 			for (z = 0; z < dir->zsize; z++)
@@ -1083,10 +1407,11 @@ void mod_handler_read_request(int event, void *data)
 				if (dir_entry_tag < stack->addr || dir_entry_tag >= stack->addr + mod->block_size)
 					continue;
 				dir_entry = dir_entry_get(dir, stack->set, stack->way, z);
-				assert(dir_entry->owner != mod->low_net_node->index);
+				assert(dir_entry->owner != mod->low_net_node->index || mod->cache->data);
 			}
 
-			/* Send read request to owners other than mod for all sub-blocks. */
+			/* Send read request to owners other than mod for all sub-blocks.
+			 * Requests are scheduled together after the loop. */
 			for (z = 0; z < dir->zsize; z++)
 			{
 				struct net_node_t *node;
@@ -1112,16 +1437,40 @@ void mod_handler_read_request(int event, void *data)
 				if (dir_entry_tag % owner->block_size)
 					continue;
 
-				/* Send read request */
+				/* Send read request. If the data was dropped in a
+				 * non-inclusive cache, the owner sends it here rather than to
+				 * the requester, and it is filled into the cache. */
 				stack->pending++;
 				new_stack = mod_stack_create(stack->id, target_mod, dir_entry_tag,
 					EV_MOD_READ_REQUEST_UPDOWN_FINISH, stack);
-				new_stack->peer = stack->mod;
+				if (cache_block_has_data(target_mod->cache, stack->set, stack->way))
+					new_stack->peer = stack->mod;
 				new_stack->target_mod = owner;
 				new_stack->request_dir = mod_request_down_up;
+				owner_stacks[owner_count++] = new_stack;
+			}
+			esim_schedule_events(EV_MOD_READ_REQUEST, owner_stacks, owner_count, 0);
+
+			/* A clean block whose data was dropped in a non-inclusive cache,
+			 * with no upper-level owner to provide it, is brought again from
+			 * the lower level as on a miss, while owners are downgraded. */
+			refetch = (stack->state == cache_block_shared ||
+				stack->state == cache_block_exclusive) &&
+				!cache_block_has_data(target_mod->cache, stack->set, stack->way) &&
+				!mod_owner_has_data(target_mod, stack->set, stack->way);
+			if (refetch)
+			{
+				new_stack = mod_stack_create(stack->id, target_mod, stack->tag,
+					EV_MOD_READ_REQUEST_UPDOWN_MISS, stack);
+				new_stack->eip = stack->eip;
+				new_stack->sectors = mod_get_request_sectors(target_mod, mod,
+					stack->addr, stack->sectors);
+				new_stack->target_mod = mod_get_low_mod(target_mod, stack->tag);
+				new_stack->request_dir = mod_request_up_down;
 				esim_schedule_event(EV_MOD_READ_REQUEST, new_stack, 0);
 			}
-			esim_schedule_event(EV_MOD_READ_REQUEST_UPDOWN_FINISH, stack, 0);
+			else
+				esim_schedule_event(EV_MOD_READ_REQUEST_UPDOWN_FINISH, stack, 0);
 		}
 		else
 		{
@@ -1130,6 +1479,9 @@ void mod_handler_read_request(int event, void *data)
 				stack->set, stack->way));
 			new_stack = mod_stack_create(stack->id, target_mod, stack->tag,
 				EV_MOD_READ_REQUEST_UPDOWN_MISS, stack);
+			new_stack->eip = stack->eip;
+			new_stack->sectors = mod_get_request_sectors(target_mod, mod,
+				stack->addr, stack->sectors);
 			/* Peer is NULL since we keep going up-down */
 			new_stack->target_mod = mod_get_low_mod(target_mod, stack->tag);
 			new_stack->request_dir = mod_request_up_down;
@@ -1161,6 +1513,9 @@ void mod_handler_read_request(int event, void *data)
 		 * Also set the tag of the block. */
 		cache_set_block(target_mod->cache, stack->set, stack->way, stack->tag,
 			stack->shared ? cache_block_shared : cache_block_exclusive);
+		mod_fill_sectors(target_mod, stack->set, stack->way,
+			mod_get_request_sectors(target_mod, mod, stack->addr,
+			stack->sectors), 0);
 		esim_schedule_event(EV_MOD_READ_REQUEST_UPDOWN_FINISH, stack, 0);
 		return;
 	}
@@ -1239,6 +1594,12 @@ void mod_handler_read_request(int event, void *data)
 			}
 		}
 
+		/* Data brought into a non-inclusive cache. An exclusive cache drops
+		 * it once the requester owns the block. */
+		mod_fill_data(target_mod, stack->set, stack->way);
+		if (!shared && target_mod->inclusion == mod_inclusion_exclusive)
+			mod_drop_data(target_mod, stack->set, stack->way);
+
 		dir_entry_unlock(dir, stack->set, stack->way);
 		esim_schedule_event(EV_MOD_READ_REQUEST_REPLY, stack, 0);
 		return;
@@ -1247,6 +1608,8 @@ void mod_handler_read_request(int event, void *data)
 	if (event == EV_MOD_READ_REQUEST_DOWNUP)
 	{
 		struct mod_t *owner;
+		void *owner_stacks[target_mod->dir->zsize];
+		int owner_count = 0;
 
 		mem_debug("  %lld %lld 0x%x %s read request downup\n", esim_cycle, stack->id,
 			stack->tag, target_mod->name);
@@ -1260,7 +1623,8 @@ void mod_handler_read_request(int event, void *data)
 		assert(stack->state != cache_block_shared);
 		stack->pending = 1;
 
-		/* Send a read request to the owner of each subblock. */
+		/* Send a read request to the owner of each subblock. Requests are
+		 * scheduled together after the loop. */
 		dir = target_mod->dir;
 		for (z = 0; z < dir->zsize; z++)
 		{
@@ -1288,32 +1652,40 @@ void mod_handler_read_request(int event, void *data)
 				EV_MOD_READ_REQUEST_DOWNUP_FINISH, stack);
 			new_stack->target_mod = owner;
 			new_stack->request_dir = mod_request_down_up;
-			esim_schedule_event(EV_MOD_READ_REQUEST, new_stack, 0);
+			owner_stacks[owner_count++] = new_stack;
 		}
+		esim_schedule_events(EV_MOD_READ_REQUEST, owner_stacks, owner_count, 0);
 
 		/* Set up the reply that will take place after all read
 		 * requests for blocks have returned */
-		if (stack->state == cache_block_exclusive) 
+		if (stack->state == cache_block_exclusive && (mod_has_data(mod, stack->tag) ||
+			(!cache_block_has_data(target_mod->cache, stack->set, stack->way) &&
+			!mod_owner_has_data(target_mod, stack->set, stack->way))))
 		{
-			/* Exclusive state only sends an ACK */
+			/* Exclusive state only sends an ACK, unless the data was dropped
+			 * in a non-inclusive lower-level cache and is here or in the
+			 * owner. Then it is sent as for M/O states. */
 			stack->reply_size = 8;
 			stack->reply = reply_ACK;
 		}
 		else if (stack->peer == NULL) 
 		{
-			/* State is M/O and no peer exists, so data is returned to mod */
-			stack->reply_size = target_mod->block_size + 8;
+			/* State is M/O/E and no peer exists, so data is returned to mod */
+			stack->reply_size = mod_get_sectors_size(target_mod,
+				mod_get_writeback_sectors(target_mod, stack->set,
+				stack->way)) + 8;
 			stack->reply = reply_ACK_DATA;
 		}
 		else 
 		{
-			/* State is M/O and peer exists, so data is sent directly to peer */
+			/* State is M/O/E and peer exists, so data is sent directly to peer */
 			stack->reply_size = 8;
 			stack->reply = reply_ACK_DATA_SENT_TO_PEER;
 
 			/* Decrease the amount of data that mod will have to send back
-			 * to its higher level cache */
-			ret->reply_size -= target_mod->block_size;
+			 * to its higher level cache. Sectored peers may have requested
+			 * less than a block. */
+			ret->reply_size -= MIN(target_mod->block_size, ret->reply_size - 8);
 			assert(ret->reply_size >= 8);
 		}
 
@@ -1339,6 +1711,8 @@ void mod_handler_read_request(int event, void *data)
 			/* Send this block (or subblock) to the peer */
 			new_stack = mod_stack_create(stack->id, target_mod, stack->tag,
 				EV_MOD_READ_REQUEST_DOWNUP_FINISH, stack);
+			cache_get_sectors(target_mod->cache, stack->set, stack->way,
+				&new_stack->sectors, NULL);
 			new_stack->peer = stack->peer;
 			new_stack->target_mod = stack->target_mod;
 			esim_schedule_event(EV_MOD_PEER_SEND, new_stack, 0);
@@ -1488,7 +1862,7 @@ void mod_handler_write_request(int event, void *data)
 		 * in updown, peer transfers must be allowed to decrease this value
 		 * (during invalidate). If the request turns out to be downup, then 
 		 * these values will get overwritten. */
-		stack->reply_size = mod->block_size + 8;
+		stack->reply_size = mod_get_sectors_size(mod, stack->sectors) + 8;
 		stack->reply = reply_ACK_DATA;
 
 		/* Checks */
@@ -1591,10 +1965,43 @@ void mod_handler_write_request(int event, void *data)
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:write_request_updown\"\n",
 			stack->id, target_mod->name);
 
+		/* Error filling sectors */
+		if (stack->err)
+		{
+			ret->err = 1;
+			ret->reply = reply_ACK_ERROR;
+			stack->reply_size = 8;
+			dir_entry_unlock(target_mod->dir, stack->set, stack->way);
+			esim_schedule_event(EV_MOD_WRITE_REQUEST_REPLY, stack, 0);
+			return;
+		}
+
 		/* state = M/E */
 		if (stack->state == cache_block_modified ||
 			stack->state == cache_block_exclusive)
 		{
+			uint32_t valid_sectors;
+			uint32_t needed_sectors;
+
+			/* Bring sectors needed by the requester first, and process
+			 * the request again. */
+			cache_get_sectors(target_mod->cache, stack->set, stack->way,
+				&valid_sectors, NULL);
+			needed_sectors = mod_get_request_sectors(target_mod, mod,
+				stack->addr, stack->sectors);
+			if (needed_sectors & ~valid_sectors)
+			{
+				new_stack = mod_stack_create(stack->id, target_mod, stack->tag,
+					EV_MOD_WRITE_REQUEST_UPDOWN, stack);
+				new_stack->sectors = needed_sectors & ~valid_sectors;
+				new_stack->target_mod = mod_get_low_mod(target_mod, stack->tag);
+				new_stack->request_dir = mod_request_up_down;
+				new_stack->src_set = stack->set;
+				new_stack->src_way = stack->way;
+				esim_schedule_event(EV_MOD_SECTOR_FILL, new_stack, 0);
+				return;
+			}
+
 			esim_schedule_event(EV_MOD_WRITE_REQUEST_UPDOWN_FINISH, stack, 0);
 		}
 		/* state = O/S/I */
@@ -1603,7 +2010,10 @@ void mod_handler_write_request(int event, void *data)
 		{
 			new_stack = mod_stack_create(stack->id, target_mod, stack->tag,
 				EV_MOD_WRITE_REQUEST_UPDOWN_FINISH, stack);
+			new_stack->eip = stack->eip;
 			new_stack->peer = mod;
+			new_stack->sectors = mod_get_request_sectors(target_mod, mod,
+				stack->addr, stack->sectors);
 			new_stack->target_mod = mod_get_low_mod(target_mod, stack->tag);
 			new_stack->request_dir = mod_request_up_down;
 			esim_schedule_event(EV_MOD_WRITE_REQUEST, new_stack, 0);
@@ -1657,6 +2067,19 @@ void mod_handler_write_request(int event, void *data)
 		if (target_mod->cache && stack->state != cache_block_modified)
 			cache_set_block(target_mod->cache, stack->set, stack->way,
 				stack->tag, cache_block_exclusive);
+		if (target_mod->cache)
+			mod_fill_sectors(target_mod, stack->set, stack->way,
+				mod_get_request_sectors(target_mod, mod, stack->addr,
+				stack->sectors), 0);
+
+		/* Data brought into a non-inclusive cache. An exclusive cache drops
+		 * it, since the requester owns the block. */
+		if (target_mod->cache)
+		{
+			mod_fill_data(target_mod, stack->set, stack->way);
+			if (target_mod->inclusion == mod_inclusion_exclusive)
+				mod_drop_data(target_mod, stack->set, stack->way);
+		}
 
 		/* Unlock, reply_size is the data of the size of the requester's block. */
 		dir_entry_unlock(target_mod->dir, stack->set, stack->way);
@@ -1692,30 +2115,36 @@ void mod_handler_write_request(int event, void *data)
 		assert(!dir_entry_group_shared_or_owned(target_mod->dir, stack->set, stack->way));
 
 		/* Compute reply size */	
-		if (stack->state == cache_block_exclusive || 
+		if ((stack->state == cache_block_exclusive && mod_has_data(mod, stack->tag)) ||
 			stack->state == cache_block_shared) 
 		{
-			/* Exclusive and shared states send an ACK */
+			/* Exclusive and shared states send an ACK. Exclusive states send
+			 * their data as M/O states if it was dropped in a non-inclusive
+			 * lower-level cache. */
 			stack->reply_size = 8;
 			stack->reply = reply_ACK;
 		}
 		else if (stack->state == cache_block_modified || 
-			stack->state == cache_block_owned)
+			stack->state == cache_block_owned ||
+			stack->state == cache_block_exclusive)
 		{
 			if (stack->peer) 
 			{
-				/* Modified or owned entries send data directly to peer if it exists */
+				/* Modified, owned, or exclusive entries send data directly to peer if it exists */
 				stack->reply = reply_ACK_DATA_SENT_TO_PEER;
 				stack->reply_size = 8;
 
 				/* This control path uses an intermediate stack that disappears, so 
 				 * we have to update the return stack of the return stack */
-				ret->ret_stack->reply_size -= target_mod->block_size;
+				ret->ret_stack->reply_size -= MIN(target_mod->block_size,
+					ret->ret_stack->reply_size - 8);
 				assert(ret->ret_stack->reply_size >= 8);
 
 				/* Send data to the peer */
 				new_stack = mod_stack_create(stack->id, target_mod, stack->tag,
 					EV_MOD_WRITE_REQUEST_DOWNUP_FINISH, stack);
+				cache_get_sectors(target_mod->cache, stack->set, stack->way,
+					&new_stack->sectors, NULL);
 				new_stack->peer = stack->peer;
 				new_stack->target_mod = stack->target_mod;
 
@@ -1726,7 +2155,9 @@ void mod_handler_write_request(int event, void *data)
 			{
 				/* If peer does not exist, data is returned to mod */
 				stack->reply = reply_ACK_DATA;
-				stack->reply_size = target_mod->block_size + 8;
+				stack->reply_size = mod_get_sectors_size(target_mod,
+					mod_get_writeback_sectors(target_mod, stack->set,
+					stack->way)) + 8;
 			}
 		}
 		else 
@@ -1824,9 +2255,10 @@ void mod_handler_peer(int event, void *data)
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:peer\"\n",
 			stack->id, src->name);
 
-		/* Send message from src to peer */
+		/* Send message from src to peer, with the sectors it holds */
 		stack->msg = net_try_send_ev(src->low_net, src->low_net_node, peer->low_net_node, 
-			src->block_size + 8, EV_MOD_PEER_RECEIVE, stack, event, stack);
+			mod_get_sectors_size(src, stack->sectors) + 8,
+			EV_MOD_PEER_RECEIVE, stack, event, stack);
 
 		return;
 	}
@@ -1878,6 +2310,166 @@ void mod_handler_peer(int event, void *data)
 }
 
 
+/* Bring sectors 'sectors' of a block present in 'mod', at 'src_set' and
+ * 'src_way', from the lower-level module 'target_mod'. The block stays locked in
+ * 'mod' and keeps its state, since only data moves. The lower-level block is
+ * present, given that tags are inclusive, and sectors missing in it are brought
+ * from its own lower level first. A locked block in 'target_mod' returns an
+ * error, so that the access is retried. */
+void mod_handler_sector_fill(int event, void *data)
+{
+	struct mod_stack_t *stack = data;
+	struct mod_stack_t *ret = stack->ret_stack;
+	struct mod_stack_t *new_stack;
+
+	struct mod_t *mod = stack->mod;
+	struct mod_t *target_mod = stack->target_mod;
+
+	if (event == EV_MOD_SECTOR_FILL)
+	{
+		mem_debug("  %lld %lld 0x%x %s sector fill (sectors=0x%x)\n", esim_cycle,
+			stack->id, stack->addr, mod->name, stack->sectors);
+		mem_trace("mem.access name=\"A-%lld\" state=\"%s:sector_fill\"\n",
+			stack->id, mod->name);
+
+		/* Default return value */
+		ret->err = 0;
+
+		/* Statistics */
+		mod->sector_misses++;
+
+		/* Send message */
+		assert(stack->sectors);
+		assert(mod_get_low_mod(mod, stack->addr) == target_mod);
+		stack->msg = net_try_send_ev(mod->low_net, mod->low_net_node,
+			target_mod->high_net_node, 8, EV_MOD_SECTOR_FILL_RECEIVE,
+			stack, event, stack);
+		return;
+	}
+
+	if (event == EV_MOD_SECTOR_FILL_RECEIVE)
+	{
+		mem_debug("  %lld %lld 0x%x %s sector fill receive\n", esim_cycle,
+			stack->id, stack->addr, target_mod->name);
+		mem_trace("mem.access name=\"A-%lld\" state=\"%s:sector_fill_receive\"\n",
+			stack->id, target_mod->name);
+
+		/* Receive message */
+		net_receive(target_mod->high_net, target_mod->high_net_node, stack->msg);
+
+		/* Find and lock */
+		new_stack = mod_stack_create(stack->id, target_mod, stack->addr,
+			EV_MOD_SECTOR_FILL_ACTION, stack);
+		new_stack->blocking = 0;
+		new_stack->read = 1;
+		new_stack->retry = 0;
+		esim_schedule_event(EV_MOD_FIND_AND_LOCK, new_stack, 0);
+		return;
+	}
+
+	if (event == EV_MOD_SECTOR_FILL_ACTION)
+	{
+		uint32_t valid_sectors;
+		uint32_t needed_sectors;
+
+		mem_debug("  %lld %lld 0x%x %s sector fill action\n", esim_cycle,
+			stack->id, stack->tag, target_mod->name);
+		mem_trace("mem.access name=\"A-%lld\" state=\"%s:sector_fill_action\"\n",
+			stack->id, target_mod->name);
+
+		/* Error locking block */
+		if (stack->err)
+		{
+			ret->err = 1;
+			stack->reply_size = 8;
+			esim_schedule_event(EV_MOD_SECTOR_FILL_REPLY, stack, 0);
+			return;
+		}
+
+		/* Sectors missing in the lower level */
+		assert(stack->state);
+		cache_get_sectors(target_mod->cache, stack->set, stack->way,
+			&valid_sectors, NULL);
+		needed_sectors = mod_get_request_sectors(target_mod, mod,
+			stack->addr, stack->sectors);
+		if (needed_sectors & ~valid_sectors)
+		{
+			new_stack = mod_stack_create(stack->id, target_mod, stack->tag,
+				EV_MOD_SECTOR_FILL_MISS, stack);
+			new_stack->sectors = needed_sectors & ~valid_sectors;
+			new_stack->target_mod = mod_get_low_mod(target_mod, stack->tag);
+			new_stack->request_dir = mod_request_up_down;
+			new_stack->src_set = stack->set;
+			new_stack->src_way = stack->way;
+			esim_schedule_event(EV_MOD_SECTOR_FILL, new_stack, 0);
+			return;
+		}
+
+		/* Reply with data */
+		dir_entry_unlock(target_mod->dir, stack->set, stack->way);
+		stack->reply_size = mod_get_sectors_size(mod, stack->sectors) + 8;
+		esim_schedule_event(EV_MOD_SECTOR_FILL_REPLY, stack, 0);
+		return;
+	}
+
+	if (event == EV_MOD_SECTOR_FILL_MISS)
+	{
+		mem_debug("  %lld %lld 0x%x %s sector fill miss\n", esim_cycle,
+			stack->id, stack->tag, target_mod->name);
+		mem_trace("mem.access name=\"A-%lld\" state=\"%s:sector_fill_miss\"\n",
+			stack->id, target_mod->name);
+
+		/* Unlock, and reply with data unless the lower level failed */
+		dir_entry_unlock(target_mod->dir, stack->set, stack->way);
+		if (stack->err)
+		{
+			ret->err = 1;
+			stack->reply_size = 8;
+		}
+		else
+			stack->reply_size = mod_get_sectors_size(mod, stack->sectors) + 8;
+		esim_schedule_event(EV_MOD_SECTOR_FILL_REPLY, stack, 0);
+		return;
+	}
+
+	if (event == EV_MOD_SECTOR_FILL_REPLY)
+	{
+		mem_debug("  %lld %lld 0x%x %s sector fill reply\n", esim_cycle,
+			stack->id, stack->tag, target_mod->name);
+		mem_trace("mem.access name=\"A-%lld\" state=\"%s:sector_fill_reply\"\n",
+			stack->id, target_mod->name);
+
+		/* Send message */
+		stack->msg = net_try_send_ev(mod->low_net, target_mod->high_net_node,
+			mod->low_net_node, stack->reply_size, EV_MOD_SECTOR_FILL_FINISH,
+			stack, event, stack);
+		return;
+	}
+
+	if (event == EV_MOD_SECTOR_FILL_FINISH)
+	{
+		mem_debug("  %lld %lld 0x%x %s sector fill finish\n", esim_cycle,
+			stack->id, stack->addr, mod->name);
+		mem_trace("mem.access name=\"A-%lld\" state=\"%s:sector_fill_finish\"\n",
+			stack->id, mod->name);
+
+		/* Receive message */
+		net_receive(mod->low_net, mod->low_net_node, stack->msg);
+
+		/* Sectors are valid now */
+		if (!ret->err)
+			mod_fill_sectors(mod, stack->src_set, stack->src_way,
+				stack->sectors, 0);
+
+		/* Return */
+		mod_stack_return(stack);
+		return;
+	}
+
+	abort();
+}
+
+
 void mod_handler_invalidate(int event, void *data)
 {
 	struct mod_stack_t *stack = data;
@@ -1894,6 +2486,9 @@ void mod_handler_invalidate(int event, void *data)
 	if (event == EV_MOD_INVALIDATE)
 	{
 		struct mod_t *sharer;
+		void *sharer_stacks[dir_entry_group_num_sharers(mod->dir,
+			stack->set, stack->way) + 1];
+		int sharer_count = 0;
 		int i;
 
 		/* Get block info */
@@ -1907,7 +2502,8 @@ void mod_handler_invalidate(int event, void *data)
 		/* At least one pending reply */
 		stack->pending = 1;
 		
-		/* Send write request to all upper level sharers except 'except_mod' */
+		/* Send write request to all upper level sharers except 'except_mod'.
+		 * Requests are scheduled together after the loop. */
 		dir = mod->dir;
 		for (z = 0; z < dir->zsize; z++)
 		{
@@ -1915,14 +2511,12 @@ void mod_handler_invalidate(int event, void *data)
 			dir_entry_tag = stack->tag + z * mod->sub_block_size;
 			assert(dir_entry_tag < stack->tag + mod->block_size);
 			dir_entry = dir_entry_get(dir, stack->set, stack->way, z);
-			for (i = 0; i < dir->num_nodes; i++)
+			for (i = dir_entry_next_sharer(dir, stack->set, stack->way, z, 0); i >= 0;
+				i = dir_entry_next_sharer(dir, stack->set, stack->way, z, i + 1))
 			{
 				struct net_node_t *node;
 				
-				/* Skip non-sharers and 'except_mod' */
-				if (!dir_entry_is_sharer(dir, stack->set, stack->way, z, i))
-					continue;
-
+				/* Skip 'except_mod' */
 				node = list_get(mod->high_net->node_list, i);
 				sharer = node->user_data;
 				if (sharer == stack->except_mod)
@@ -1949,10 +2543,11 @@ void mod_handler_invalidate(int event, void *data)
 					new_stack->peer = stack->peer;
 					first_sharer = 0;
 				}
-				esim_schedule_event(EV_MOD_WRITE_REQUEST, new_stack, 0);
+				sharer_stacks[sharer_count++] = new_stack;
 				stack->pending++;
 			}
 		}
+		esim_schedule_events(EV_MOD_WRITE_REQUEST, sharer_stacks, sharer_count, 0);
 		esim_schedule_event(EV_MOD_INVALIDATE_FINISH, stack, 0);
 		return;
 	}
@@ -18,16 +18,168 @@
  */
 
 
+#include <limits.h>
 #include <mem-system.h>
 
 
-#define DIR_ENTRY_SHARERS_SIZE ((dir->num_nodes + 7) / 8)
-#define DIR_ENTRY_SIZE (sizeof(struct dir_entry_t) + DIR_ENTRY_SHARERS_SIZE)
-#define DIR_ENTRY(X, Y, Z) ((struct dir_entry_t *) (((void *) &dir->data) + DIR_ENTRY_SIZE * \
+/* Sharers are kept in bitmaps of 64-bit words */
+#define DIR_ENTRY_SHARERS_SIZE ((dir->num_nodes + 63) / 64)
+#define DIR_SHARER_WORD(node) ((node) / 64)
+#define DIR_SHARER_BIT(node) (1ULL << ((node) % 64))
+#define DIR_ENTRY(X, Y, Z) ((struct dir_entry_t *) (((void *) &dir->data) + dir->entry_size * \
 	((X) * dir->ysize * dir->zsize + (Y) * dir->zsize + (Z))))
 
+/* Sharers of an entry in a sparse directory, kept as a list of nodes while
+ * there are at most 'num_pointers' of them, or as a pointer to a bitmap. */
+#define DIR_ENTRY_POINTERS(dir_entry) ((unsigned short *) (dir_entry)->sharer)
 
-struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_nodes)
+
+
+
+/*
+ * Private Functions
+ */
+
+/* Return the entries of a block in a sparse directory, or NULL if they are
+ * not allocated. */
+static struct dir_entry_t *dir_group_get(struct dir_t *dir, int x, int y, int z)
+{
+	unsigned char *group;
+
+	group = dir->group[x * dir->ysize + y];
+	if (!group)
+		return NULL;
+	return (struct dir_entry_t *) (group + dir->entry_size * z);
+}
+
+
+/* Allocate the entries of a block in a sparse directory */
+static void dir_group_create(struct dir_t *dir, int x, int y)
+{
+	struct dir_entry_t *dir_entry;
+	unsigned char *group;
+	int z;
+
+	/* Objects from a repository are returned with all bytes set to 0 */
+	group = repos_create_object(dir->group_repos);
+	for (z = 0; z < dir->zsize; z++)
+	{
+		dir_entry = (struct dir_entry_t *) (group + dir->entry_size * z);
+		dir_entry->owner = DIR_ENTRY_OWNER_NONE;
+	}
+	dir->group[x * dir->ysize + y] = group;
+
+	/* Statistics */
+	dir->num_groups++;
+	dir->max_groups = MAX(dir->max_groups, dir->num_groups);
+}
+
+
+/* Free the entries of a block in a sparse directory if none of them has
+ * sharers or an owner. This is only done when the block is unlocked, since
+ * callers keep pointers to directory entries while the block is locked. */
+static void dir_group_release(struct dir_t *dir, int x, int y)
+{
+	struct dir_entry_t *dir_entry;
+	unsigned char *group;
+	int z;
+
+	group = dir->group[x * dir->ysize + y];
+	if (!group)
+		return;
+	for (z = 0; z < dir->zsize; z++)
+	{
+		dir_entry = (struct dir_entry_t *) (group + dir->entry_size * z);
+		if (dir_entry->num_sharers || DIR_ENTRY_VALID_OWNER(dir_entry))
+			return;
+	}
+	repos_free_object(dir->group_repos, group);
+	dir->group[x * dir->ysize + y] = NULL;
+	dir->num_groups--;
+}
+
+
+/* Pointer to the bitmap of sharers of an entry in a sparse directory. It is
+ * copied in and out of the sharers field, which holds 64-bit words, so that
+ * it is not accessed through a type-punned pointer. */
+static uint64_t *dir_entry_get_bitmap_ptr(struct dir_entry_t *dir_entry)
+{
+	uint64_t *bitmap;
+
+	memcpy(&bitmap, dir_entry->sharer, sizeof bitmap);
+	return bitmap;
+}
+
+
+static void dir_entry_set_bitmap_ptr(struct dir_entry_t *dir_entry, uint64_t *bitmap)
+{
+	memcpy(dir_entry->sharer, &bitmap, sizeof bitmap);
+}
+
+
+/* Return the bitmap of sharers of an entry, or NULL if the entry keeps its
+ * sharers as a list of nodes. */
+static uint64_t *dir_entry_bitmap(struct dir_t *dir, struct dir_entry_t *dir_entry)
+{
+	if (!dir->num_pointers)
+		return dir_entry->sharer;
+	if (dir_entry->num_sharers > dir->num_pointers)
+		return dir_entry_get_bitmap_ptr(dir_entry);
+	return NULL;
+}
+
+
+static int dir_entry_has_sharer(struct dir_t *dir, struct dir_entry_t *dir_entry, int node)
+{
+	uint64_t *bitmap;
+	unsigned short *pointers;
+	int i;
+
+	/* Bitmap */
+	bitmap = dir_entry_bitmap(dir, dir_entry);
+	if (bitmap)
+		return (bitmap[DIR_SHARER_WORD(node)] & DIR_SHARER_BIT(node)) != 0;
+
+	/* List of nodes */
+	pointers = DIR_ENTRY_POINTERS(dir_entry);
+	for (i = 0; i < dir_entry->num_sharers; i++)
+		if (pointers[i] == node)
+			return 1;
+	return 0;
+}
+
+
+/* Return the lowest node set in 'bitmap' that is equal to or greater than
+ * 'node', or -1 if there is none. Words with no sharers are skipped at once. */
+static int dir_bitmap_next(struct dir_t *dir, uint64_t *bitmap, int node)
+{
+	uint64_t bits;
+	int word;
+
+	word = DIR_SHARER_WORD(node);
+	if (word >= DIR_ENTRY_SHARERS_SIZE)
+		return -1;
+	bits = bitmap[word] & (~0ULL << (node % 64));
+	while (!bits)
+	{
+		if (++word == DIR_ENTRY_SHARERS_SIZE)
+			return -1;
+		bits = bitmap[word];
+	}
+	return word * 64 + __builtin_ctzll(bits);
+}
+
+
+
+
+
+/*
+ * Public Functions
+ */
+
+
+struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_nodes,
+	int num_pointers)
 {
 	struct dir_t *dir;
 	struct dir_entry_t *dir_entry;
@@ -39,10 +191,25 @@ struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_no
 	int y;
 	int z;
 	
-	/* Calculate sizes */
+	/* Calculate sizes. Entries of a sparse directory have room for either
+	 * the list of sharers or a pointer to the bitmap, and are aligned for
+	 * the latter. */
 	assert(num_nodes > 0);
-	dir_entry_size = sizeof(struct dir_entry_t) + (num_nodes + 7) / 8;
-	dir_size = sizeof(struct dir_t) + dir_entry_size * xsize * ysize * zsize;
+	assert(num_pointers >= 0);
+	if (num_pointers)
+	{
+		if (num_nodes > USHRT_MAX + 1)
+			fatal("%s: too many nodes for a sparse directory", name);
+		dir_entry_size = sizeof(struct dir_entry_t) + MAX(num_pointers *
+			sizeof(unsigned short), sizeof(uint64_t *));
+		dir_entry_size = (dir_entry_size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+		dir_size = sizeof(struct dir_t);
+	}
+	else
+	{
+		dir_entry_size = sizeof(struct dir_entry_t) + (num_nodes + 63) / 64 * sizeof(uint64_t);
+		dir_size = sizeof(struct dir_t) + dir_entry_size * xsize * ysize * zsize;
+	}
 
 	/* Create directory */
 	dir = calloc(1, dir_size);
@@ -64,6 +231,19 @@ struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_no
 	dir->xsize = xsize;
 	dir->ysize = ysize;
 	dir->zsize = zsize;
+	dir->entry_size = dir_entry_size;
+	dir->num_pointers = num_pointers;
+
+	/* Sparse directory. Entries are allocated on demand. */
+	if (num_pointers)
+	{
+		dir->group = calloc(xsize * ysize, sizeof(unsigned char *));
+		if (!dir->group)
+			fatal("%s: out of memory", __FUNCTION__);
+		dir->group_repos = repos_create(dir_entry_size * zsize, dir->name);
+		dir->bitmap_repos = repos_create((num_nodes + 63) / 64 * sizeof(uint64_t), dir->name);
+		return dir;
+	}
 
 	/* Reset all owners */
 	for (x = 0; x < xsize; x++)
@@ -85,6 +265,14 @@ struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_no
 
 void dir_free(struct dir_t *dir)
 {
+	if (dir->num_pointers)
+	{
+		repos_free_all_objects(dir->group_repos);
+		repos_free_all_objects(dir->bitmap_repos);
+		repos_free(dir->group_repos);
+		repos_free(dir->bitmap_repos);
+		free(dir->group);
+	}
 	free(dir->name);
 	free(dir->dir_lock);
 	free(dir);
@@ -96,7 +284,27 @@ struct dir_entry_t *dir_entry_get(struct dir_t *dir, int x, int y, int z)
 	assert(IN_RANGE(x, 0, dir->xsize - 1));
 	assert(IN_RANGE(y, 0, dir->ysize - 1));
 	assert(IN_RANGE(z, 0, dir->zsize - 1));
-	return DIR_ENTRY(x, y, z);
+	if (!dir->num_pointers)
+		return DIR_ENTRY(x, y, z);
+
+	/* Sparse directory. Callers may update the entry after obtaining it, so
+	 * the entries of the block are allocated now if they were not. */
+	if (!dir->group[x * dir->ysize + y])
+		dir_group_create(dir, x, y);
+	return dir_group_get(dir, x, y, z);
+}
+
+
+/* Free the entries of a block in a sparse directory if none of them is used
+ * and the block is not locked. Accesses that do not lock directory entries,
+ * such as atomic accesses, call this function after updating them. */
+void dir_group_release_if_empty(struct dir_t *dir, int x, int y)
+{
+	assert(IN_RANGE(x, 0, dir->xsize - 1));
+	assert(IN_RANGE(y, 0, dir->ysize - 1));
+	if (!dir->num_pointers || dir->dir_lock[x * dir->ysize + y].lock)
+		return;
+	dir_group_release(dir, x, y);
 }
 
 
@@ -107,9 +315,9 @@ void dir_entry_dump_sharers(struct dir_t *dir, int x, int y, int z)
 
 	dir_entry = dir_entry_get(dir, x, y, z);
 	mem_debug("  %d sharers: { ", dir_entry->num_sharers);
-	for (i = 0; i < dir->num_nodes; i++)
-		if (dir_entry_is_sharer(dir, x, y, z, i))
-			printf("%d ", i);
+	for (i = dir_entry_next_sharer(dir, x, y, z, 0); i >= 0;
+		i = dir_entry_next_sharer(dir, x, y, z, i + 1))
+		printf("%d ", i);
 	mem_debug("}\n");
 }
 
@@ -132,15 +340,36 @@ void dir_entry_set_owner(struct dir_t *dir, int x, int y, int z, int node)
 void dir_entry_set_sharer(struct dir_t *dir, int x, int y, int z, int node)
 {
 	struct dir_entry_t *dir_entry;
+	uint64_t *bitmap;
+	unsigned short *pointers;
+	int i;
 
 	/* Nothing if sharer was already set */
 	assert(IN_RANGE(node, 0, dir->num_nodes - 1));
 	dir_entry = dir_entry_get(dir, x, y, z);
-	if (dir_entry->sharer[node / 8] & (1 << (node % 8)))
+	if (dir_entry_has_sharer(dir, dir_entry, node))
 		return;
 
-	/* Set sharer */
-	dir_entry->sharer[node / 8] |= 1 << (node % 8);
+	/* Set sharer. In a sparse directory, an entry with a full list of
+	 * sharers is converted into a bitmap. */
+	bitmap = dir_entry_bitmap(dir, dir_entry);
+	if (!bitmap && dir_entry->num_sharers < dir->num_pointers)
+	{
+		DIR_ENTRY_POINTERS(dir_entry)[dir_entry->num_sharers] = node;
+	}
+	else
+	{
+		if (!bitmap)
+		{
+			bitmap = repos_create_object(dir->bitmap_repos);
+			pointers = DIR_ENTRY_POINTERS(dir_entry);
+			for (i = 0; i < dir_entry->num_sharers; i++)
+				bitmap[DIR_SHARER_WORD(pointers[i])] |= DIR_SHARER_BIT(pointers[i]);
+			dir_entry_set_bitmap_ptr(dir_entry, bitmap);
+			dir->overflows++;
+		}
+		bitmap[DIR_SHARER_WORD(node)] |= DIR_SHARER_BIT(node);
+	}
 	dir_entry->num_sharers++;
 	assert(dir_entry->num_sharers <= dir->num_nodes);
 
@@ -153,16 +382,38 @@ void dir_entry_set_sharer(struct dir_t *dir, int x, int y, int z, int node)
 void dir_entry_clear_sharer(struct dir_t *dir, int x, int y, int z, int node)
 {
 	struct dir_entry_t *dir_entry;
+	uint64_t *bitmap;
+	unsigned short *pointers;
+	int i;
 
 	/* Nothing if sharer is not set */
 	dir_entry = dir_entry_get(dir, x, y, z);
 	assert(IN_RANGE(node, 0, dir->num_nodes - 1));
-	if (!(dir_entry->sharer[node / 8] & (1 << (node % 8))))
+	if (!dir_entry_has_sharer(dir, dir_entry, node))
 		return;
 
-	/* Clear sharer */
-	dir_entry->sharer[node / 8] &= ~(1 << (node % 8));
+	/* Clear sharer. In a sparse directory, a bitmap is converted back into
+	 * a list of sharers when they fit. */
 	assert(dir_entry->num_sharers > 0);
+	bitmap = dir_entry_bitmap(dir, dir_entry);
+	pointers = DIR_ENTRY_POINTERS(dir_entry);
+	if (!bitmap)
+	{
+		for (i = 0; pointers[i] != node; i++)
+			assert(i < dir_entry->num_sharers);
+		pointers[i] = pointers[dir_entry->num_sharers - 1];
+	}
+	else
+	{
+		bitmap[DIR_SHARER_WORD(node)] &= ~DIR_SHARER_BIT(node);
+		if (dir->num_pointers && dir_entry->num_sharers - 1 == dir->num_pointers)
+		{
+			for (i = dir_bitmap_next(dir, bitmap, 0); i >= 0;
+				i = dir_bitmap_next(dir, bitmap, i + 1))
+				*pointers++ = i;
+			repos_free_object(dir->bitmap_repos, bitmap);
+		}
+	}
 	dir_entry->num_sharers--;
 
 	/* Debug */
@@ -174,13 +425,20 @@ void dir_entry_clear_sharer(struct dir_t *dir, int x, int y, int z, int node)
 void dir_entry_clear_all_sharers(struct dir_t *dir, int x, int y, int z)
 {
 	struct dir_entry_t *dir_entry;
-	int i;
 
 	/* Clear sharers */
 	dir_entry = dir_entry_get(dir, x, y, z);
+	if (dir->num_pointers)
+	{
+		if (dir_entry->num_sharers > dir->num_pointers)
+			repos_free_object(dir->bitmap_repos,
+				dir_entry_get_bitmap_ptr(dir_entry));
+	}
+	else
+	{
+		memset(dir_entry->sharer, 0, DIR_ENTRY_SHARERS_SIZE * sizeof(uint64_t));
+	}
 	dir_entry->num_sharers = 0;
-	for (i = 0; i < DIR_ENTRY_SHARERS_SIZE; i++)
-		dir_entry->sharer[i] = 0;
 
 	/* Debug */
 	mem_trace("mem.clear_all_sharers dir=\"%s\" x=%d y=%d z=%d\n",
@@ -193,8 +451,47 @@ int dir_entry_is_sharer(struct dir_t *dir, int x, int y, int z, int node)
 	struct dir_entry_t *dir_entry;
 
 	assert(IN_RANGE(node, 0, dir->num_nodes - 1));
+	if (dir->num_pointers)
+	{
+		dir_entry = dir_group_get(dir, x, y, z);
+		return dir_entry && dir_entry_has_sharer(dir, dir_entry, node);
+	}
 	dir_entry = dir_entry_get(dir, x, y, z);
-	return (dir_entry->sharer[node / 8] & (1 << (node % 8))) > 0;
+	return (dir_entry->sharer[DIR_SHARER_WORD(node)] & DIR_SHARER_BIT(node)) != 0;
+}
+
+
+/* Return the lowest sharer of an entry that is equal to or greater than
+ * 'node', or -1 if there is none. All sharers are visited in increasing
+ * order with a loop starting at node 0 and continuing after the last sharer
+ * returned. Sharers can be cleared while iterating. */
+int dir_entry_next_sharer(struct dir_t *dir, int x, int y, int z, int node)
+{
+	struct dir_entry_t *dir_entry;
+	unsigned short *pointers;
+	uint64_t *bitmap;
+	int next;
+	int i;
+
+	/* Entry */
+	assert(node >= 0);
+	dir_entry = dir->num_pointers ? dir_group_get(dir, x, y, z) :
+		dir_entry_get(dir, x, y, z);
+	if (!dir_entry || !dir_entry->num_sharers)
+		return -1;
+
+	/* Bitmap */
+	bitmap = dir_entry_bitmap(dir, dir_entry);
+	if (bitmap)
+		return dir_bitmap_next(dir, bitmap, node);
+
+	/* List of nodes */
+	next = -1;
+	pointers = DIR_ENTRY_POINTERS(dir_entry);
+	for (i = 0; i < dir_entry->num_sharers; i++)
+		if (pointers[i] >= node && (next < 0 || pointers[i] < next))
+			next = pointers[i];
+	return next;
 }
 
 
@@ -202,9 +499,14 @@ int dir_entry_group_shared_or_owned(struct dir_t *dir, int x, int y)
 {
 	struct dir_entry_t *dir_entry;
 	int z;
+
+	/* Blocks of a sparse directory with no entries allocated */
+	if (dir->num_pointers && !dir->group[x * dir->ysize + y])
+		return 0;
+
 	for (z = 0; z < dir->zsize; z++)
 	{
-		dir_entry = DIR_ENTRY(x, y, z);
+		dir_entry = dir->num_pointers ? dir_group_get(dir, x, y, z) : DIR_ENTRY(x, y, z);
 		if (dir_entry->num_sharers || DIR_ENTRY_VALID_OWNER(dir_entry))
 			return 1;
 	}
@@ -212,6 +514,47 @@ int dir_entry_group_shared_or_owned(struct dir_t *dir, int x, int y)
 }
 
 
+/* Return the owner of all sub-blocks of block (x, y), or DIR_ENTRY_OWNER_NONE
+ * if any of them has no owner or a different one. Entries of a sparse
+ * directory are not allocated. */
+int dir_entry_group_owner(struct dir_t *dir, int x, int y)
+{
+	struct dir_entry_t *dir_entry;
+	int owner = DIR_ENTRY_OWNER_NONE;
+	int z;
+
+	/* Blocks of a sparse directory with no entries allocated */
+	if (dir->num_pointers && !dir->group[x * dir->ysize + y])
+		return DIR_ENTRY_OWNER_NONE;
+
+	for (z = 0; z < dir->zsize; z++)
+	{
+		dir_entry = dir->num_pointers ? dir_group_get(dir, x, y, z) : DIR_ENTRY(x, y, z);
+		if (!DIR_ENTRY_VALID_OWNER(dir_entry) || (z && dir_entry->owner != owner))
+			return DIR_ENTRY_OWNER_NONE;
+		owner = dir_entry->owner;
+	}
+	return owner;
+}
+
+
+/* Return the number of sharers of all sub-blocks of block (x, y) */
+int dir_entry_group_num_sharers(struct dir_t *dir, int x, int y)
+{
+	int num_sharers = 0;
+	int z;
+
+	/* Blocks of a sparse directory with no entries allocated */
+	if (dir->num_pointers && !dir->group[x * dir->ysize + y])
+		return 0;
+
+	for (z = 0; z < dir->zsize; z++)
+		num_sharers += (dir->num_pointers ? dir_group_get(dir, x, y, z) :
+			DIR_ENTRY(x, y, z))->num_sharers;
+	return num_sharers;
+}
+
+
 struct dir_lock_t *dir_lock_get(struct dir_t *dir, int x, int y)
 {
 	struct dir_lock_t *dir_lock;
@@ -274,4 +617,9 @@ void dir_entry_unlock(struct dir_t *dir, int x, int y)
 
 	/* Unlock entry */
 	dir_lock->lock = 0;
+
+	/* Free the entries of a block in a sparse directory that are no
+	 * longer used */
+	if (dir->num_pointers)
+		dir_group_release(dir, x, y);
 }
@@ -0,0 +1,405 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2011  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <mem-system.h>
+
+
+/*
+ * DRAM
+ *
+ * Each channel has a queue of requests, a data bus, and 'num_ranks * num_banks'
+ * banks with one row buffer each. Requests are scheduled by event
+ * EV_DRAM_SCHEDULE, which issues at most one request per channel and cycle,
+ * among those whose bank is ready. The FR-FCFS scheduler picks the oldest
+ * request hitting an open row, or the oldest request otherwise. The FCFS
+ * scheduler always waits for the oldest request.
+ *
+ * The latency of a request depends on the state of its bank: a column access
+ * on a row buffer hit; an activation and a column access if the bank is
+ * precharged; or a precharge, an activation, and a column access if another
+ * row is open. The block is then transferred on the data bus of the channel.
+ * With the closed page policy, the bank is precharged after every access.
+ */
+
+struct string_map_t dram_page_policy_map =
+{
+	2, {
+		{ "Open", dram_page_policy_open },
+		{ "Closed", dram_page_policy_closed }
+	}
+};
+
+struct string_map_t dram_scheduler_map =
+{
+	2, {
+		{ "FCFS", dram_scheduler_fcfs },
+		{ "FRFCFS", dram_scheduler_frfcfs }
+	}
+};
+
+int EV_DRAM_SCHEDULE;
+
+
+/* Schedule event EV_DRAM_SCHEDULE for 'channel' in 'cycle', unless it is already
+ * scheduled for that cycle or earlier. */
+static void dram_channel_schedule(struct dram_channel_t *channel, long long cycle)
+{
+	if (channel->schedule_cycle >= 0 && channel->schedule_cycle <= cycle)
+		return;
+	channel->schedule_cycle = cycle;
+	esim_schedule_event(EV_DRAM_SCHEDULE, channel, cycle - esim_cycle);
+}
+
+
+/* Apply all refreshes of 'channel' started up to cycle 'now'. A refresh closes
+ * the rows of all banks, and keeps them busy for 't_rfc' cycles. */
+static void dram_channel_refresh(struct dram_channel_t *channel, long long now)
+{
+	struct dram_t *dram = channel->dram;
+	struct dram_bank_t *bank;
+	int i;
+
+	if (!dram->t_refi)
+		return;
+	while (channel->next_refresh_cycle <= now)
+	{
+		for (i = 0; i < dram->num_ranks * dram->num_banks; i++)
+		{
+			bank = &channel->banks[i];
+			bank->open_row = DRAM_ROW_NONE;
+			bank->ready_cycle = MAX(bank->ready_cycle,
+				channel->next_refresh_cycle + dram->t_rfc);
+		}
+		channel->next_refresh_cycle += dram->t_refi;
+		dram->refreshes++;
+	}
+}
+
+
+/* Return the request to issue in 'channel' in cycle 'now', or NULL if no request
+ * can be issued. The request is removed from the queue. */
+static struct dram_request_t *dram_channel_pick(struct dram_channel_t *channel,
+	long long now)
+{
+	struct dram_t *dram = channel->dram;
+	struct dram_request_t *request;
+	struct dram_request_t *prev;
+	struct dram_request_t *found;
+	struct dram_request_t *found_prev;
+	struct dram_bank_t *bank;
+
+	/* Find oldest ready request, or oldest ready row buffer hit for FR-FCFS */
+	found = NULL;
+	found_prev = NULL;
+	for (prev = NULL, request = channel->queue_head; request;
+		prev = request, request = request->next)
+	{
+		bank = &channel->banks[request->bank];
+		if (request->arrival_cycle > now || bank->ready_cycle > now)
+		{
+			if (dram->scheduler == dram_scheduler_fcfs)
+				break;
+			continue;
+		}
+		if (!found)
+		{
+			found = request;
+			found_prev = prev;
+		}
+		if (dram->scheduler == dram_scheduler_fcfs || bank->open_row == request->row)
+		{
+			found = request;
+			found_prev = prev;
+			break;
+		}
+	}
+
+	/* Remove from queue */
+	if (!found)
+		return NULL;
+	if (found_prev)
+		found_prev->next = found->next;
+	else
+		channel->queue_head = found->next;
+	if (channel->queue_tail == found)
+		channel->queue_tail = found_prev;
+	channel->queue_count--;
+	return found;
+}
+
+
+/* Issue 'request' in 'channel' in cycle 'now', and return the cycle when the
+ * transfer of the block completes. */
+static long long dram_channel_issue(struct dram_channel_t *channel,
+	struct dram_request_t *request, long long now)
+{
+	struct dram_t *dram = channel->dram;
+	struct dram_bank_t *bank;
+
+	long long activate_cycle;
+	long long precharge_cycle;
+	long long column_cycle;
+	long long data_cycle;
+	long long done_cycle;
+
+	/* Row buffer hit, miss, or conflict */
+	bank = &channel->banks[request->bank];
+	if (bank->open_row == request->row)
+	{
+		dram->row_hits++;
+		column_cycle = now;
+	}
+	else
+	{
+		if (bank->open_row == DRAM_ROW_NONE)
+		{
+			dram->row_misses++;
+			activate_cycle = now;
+		}
+		else
+		{
+			dram->row_conflicts++;
+			precharge_cycle = MAX(now, bank->activate_cycle + dram->t_ras);
+			activate_cycle = precharge_cycle + dram->t_rp;
+		}
+		bank->open_row = request->row;
+		bank->activate_cycle = activate_cycle;
+		column_cycle = activate_cycle + dram->t_rcd;
+	}
+
+	/* Data transfer */
+	data_cycle = MAX(column_cycle + dram->t_cas, channel->bus_ready_cycle);
+	done_cycle = data_cycle + dram->t_burst;
+	channel->bus_ready_cycle = done_cycle;
+
+	/* Next column access to the open row, or precharge after the access */
+	bank->ready_cycle = column_cycle + dram->t_burst;
+	if (dram->page_policy == dram_page_policy_closed)
+	{
+		precharge_cycle = MAX(bank->ready_cycle, bank->activate_cycle + dram->t_ras);
+		bank->open_row = DRAM_ROW_NONE;
+		bank->ready_cycle = precharge_cycle + dram->t_rp;
+	}
+
+	/* Statistics */
+	dram->accesses++;
+	if (request->write)
+		dram->writes++;
+	else
+		dram->reads++;
+	dram->total_latency += done_cycle - request->arrival_cycle;
+
+	/* Return */
+	return done_cycle;
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+struct dram_t *dram_create(char *name, int block_size, int num_channels,
+	int num_ranks, int num_banks, int row_size)
+{
+	struct dram_t *dram;
+	struct dram_channel_t *channel;
+
+	int i;
+	int j;
+
+	/* Create */
+	dram = calloc(1, sizeof(struct dram_t));
+	if (!dram)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Name */
+	dram->name = strdup(name);
+	if (!dram->name)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Initialize */
+	assert(row_size >= block_size && !(row_size % block_size));
+	dram->num_channels = num_channels;
+	dram->num_ranks = num_ranks;
+	dram->num_banks = num_banks;
+	dram->row_size = row_size;
+	dram->log_block_size = log_base2(block_size);
+	dram->blocks_per_row = row_size / block_size;
+	dram->block_div = 1;
+	dram->page_policy = dram_page_policy_open;
+	dram->scheduler = dram_scheduler_frfcfs;
+	dram->request_repos = repos_create(sizeof(struct dram_request_t), dram->name);
+
+	/* Channels and banks */
+	dram->channels = calloc(num_channels, sizeof(struct dram_channel_t));
+	if (!dram->channels)
+		fatal("%s: out of memory", __FUNCTION__);
+	for (i = 0; i < num_channels; i++)
+	{
+		channel = &dram->channels[i];
+		channel->dram = dram;
+		channel->schedule_cycle = -1;
+		channel->last_issue_cycle = -1;
+		channel->banks = calloc(num_ranks * num_banks, sizeof(struct dram_bank_t));
+		if (!channel->banks)
+			fatal("%s: out of memory", __FUNCTION__);
+		for (j = 0; j < num_ranks * num_banks; j++)
+			channel->banks[j].open_row = DRAM_ROW_NONE;
+	}
+
+	/* Return */
+	return dram;
+}
+
+
+void dram_free(struct dram_t *dram)
+{
+	int i;
+
+	for (i = 0; i < dram->num_channels; i++)
+		free(dram->channels[i].banks);
+	free(dram->channels);
+	repos_free_all_objects(dram->request_repos);
+	repos_free(dram->request_repos);
+	free(dram->name);
+	free(dram);
+}
+
+
+/* Access the block containing 'addr'. The request is received by the memory
+ * controller after 'delay' cycles, and 'event' is scheduled for 'stack' when
+ * the block has been transferred. */
+void dram_access(struct dram_t *dram, uint32_t addr, int write, int delay,
+	int event, struct mod_stack_t *stack)
+{
+	struct dram_channel_t *channel;
+	struct dram_request_t *request;
+	uint32_t chunk;
+
+	/* Create request */
+	request = repos_create_object(dram->request_repos);
+	request->stack = stack;
+	request->event = event;
+	request->write = write;
+	request->arrival_cycle = esim_cycle + delay;
+
+	/* Map address. Consecutive rows go to different channels, then to
+	 * different banks, and then to different ranks. */
+	chunk = (addr >> dram->log_block_size) / dram->block_div / dram->blocks_per_row;
+	channel = &dram->channels[chunk % dram->num_channels];
+	chunk /= dram->num_channels;
+	request->bank = chunk % dram->num_banks;
+	chunk /= dram->num_banks;
+	request->bank += (chunk % dram->num_ranks) * dram->num_banks;
+	request->row = chunk / dram->num_ranks;
+
+	/* Enqueue */
+	if (channel->queue_tail)
+		channel->queue_tail->next = request;
+	else
+		channel->queue_head = request;
+	channel->queue_tail = request;
+	channel->queue_count++;
+	channel->queue_max = MAX(channel->queue_max, channel->queue_count);
+
+	/* Schedule */
+	dram_channel_schedule(channel, request->arrival_cycle);
+}
+
+
+/* Event handler for EV_DRAM_SCHEDULE. Argument 'data' is a channel. */
+void dram_handler(int event, void *data)
+{
+	struct dram_channel_t *channel = data;
+	struct dram_t *dram = channel->dram;
+	struct dram_request_t *request;
+	struct dram_bank_t *bank;
+
+	long long now = esim_cycle;
+	long long done_cycle;
+	long long next_cycle;
+
+	/* Ignore events replaced by an earlier one */
+	assert(event == EV_DRAM_SCHEDULE);
+	if (channel->schedule_cycle != now)
+		return;
+	channel->schedule_cycle = -1;
+
+	/* Issue one request per cycle */
+	dram_channel_refresh(channel, now);
+	request = channel->last_issue_cycle < now ? dram_channel_pick(channel, now) : NULL;
+	if (request)
+	{
+		channel->last_issue_cycle = now;
+		done_cycle = dram_channel_issue(channel, request, now);
+		esim_schedule_event(request->event, request->stack, done_cycle - now);
+		repos_free_object(dram->request_repos, request);
+	}
+
+	/* Next cycle when a request can be issued */
+	next_cycle = -1;
+	for (request = channel->queue_head; request; request = request->next)
+	{
+		bank = &channel->banks[request->bank];
+		if (next_cycle < 0 || MAX(request->arrival_cycle, bank->ready_cycle) < next_cycle)
+			next_cycle = MAX(request->arrival_cycle, bank->ready_cycle);
+		if (dram->scheduler == dram_scheduler_fcfs)
+			break;
+	}
+	if (next_cycle >= 0)
+		dram_channel_schedule(channel, MAX(next_cycle, now + 1));
+}
+
+
+void dram_dump_report(struct dram_t *dram, FILE *f)
+{
+	int queue_max;
+	int i;
+
+	/* Configuration */
+	fprintf(f, "[ %s.DRAM ]\n", dram->name);
+	fprintf(f, "\n");
+	fprintf(f, "Channels = %d\n", dram->num_channels);
+	fprintf(f, "Ranks = %d\n", dram->num_ranks);
+	fprintf(f, "Banks = %d\n", dram->num_banks);
+	fprintf(f, "RowSize = %d\n", dram->row_size);
+	fprintf(f, "PagePolicy = %s\n", map_value(&dram_page_policy_map, dram->page_policy));
+	fprintf(f, "Scheduler = %s\n", map_value(&dram_scheduler_map, dram->scheduler));
+	fprintf(f, "\n");
+
+	/* Statistics */
+	queue_max = 0;
+	for (i = 0; i < dram->num_channels; i++)
+		queue_max = MAX(queue_max, dram->channels[i].queue_max);
+	fprintf(f, "Accesses = %lld\n", dram->accesses);
+	fprintf(f, "Reads = %lld\n", dram->reads);
+	fprintf(f, "Writes = %lld\n", dram->writes);
+	fprintf(f, "RowHits = %lld\n", dram->row_hits);
+	fprintf(f, "RowMisses = %lld\n", dram->row_misses);
+	fprintf(f, "RowConflicts = %lld\n", dram->row_conflicts);
+	fprintf(f, "RowHitRatio = %.4g\n", dram->accesses ?
+		(double) dram->row_hits / dram->accesses : 0.0);
+	fprintf(f, "Refreshes = %lld\n", dram->refreshes);
+	fprintf(f, "AverageLatency = %.4g\n", dram->accesses ?
+		(double) dram->total_latency / dram->accesses : 0.0);
+	fprintf(f, "MaxQueueLength = %d\n", queue_max);
+	fprintf(f, "\n\n");
+}
@@ -48,6 +48,43 @@ int EV_MOD_GPU_WRITE_UNLOCK;
 int EV_MOD_GPU_WRITE_FINISH;
 
 
+/* Return a free port of the bank serving the address of 'stack', or NULL if all
+ * of them are locked. Bank statistics are recorded as in 'mod_lock_port'. */
+static struct mod_port_t *mod_gpu_get_port(struct mod_t *mod,
+	struct mod_stack_t *stack)
+{
+	struct mod_bank_t *bank;
+	int bank_id;
+	int i;
+
+	/* Free port in the bank */
+	bank_id = mod_get_bank(mod, stack->addr);
+	bank = &mod->banks[bank_id];
+	for (i = bank_id * mod->bank_ports; i < (bank_id + 1) * mod->bank_ports; i++)
+	{
+		if (mod->ports[i].locked)
+			continue;
+		bank->accesses++;
+		if (stack->port_waiting)
+		{
+			stack->port_waiting = 0;
+			mod->bank_wait_cycles += esim_cycle - stack->port_wait_when;
+		}
+		return &mod->ports[i];
+	}
+
+	/* Bank conflict if ports in other banks are free */
+	if (!stack->port_waiting)
+	{
+		stack->port_waiting = 1;
+		stack->port_wait_when = esim_cycle;
+		if (mod->num_locked_ports < mod->num_ports)
+			mod->bank_conflicts++;
+	}
+	return NULL;
+}
+
+
 void mod_handler_gpu_load(int event, void *data)
 {
 	struct mod_stack_t *stack = data;
@@ -65,6 +102,7 @@ void mod_handler_gpu_load(int event, void *data)
 		new_stack = mod_stack_create(stack->id, mod, stack->addr,
 			EV_MOD_GPU_LOAD_FINISH, stack);
 		new_stack->witness_ptr = stack->witness_ptr;
+		new_stack->sectors = mod_get_sectors(mod, stack->addr, 1);
 		esim_execute_event(EV_MOD_GPU_READ, new_stack);
 		return;
 	}
@@ -182,16 +220,8 @@ void mod_handler_gpu_read(int event, void *data)
 		}
 
 		/* Look for a free port */
-		for (i = 0; i < mod->num_ports; i++)
-		{
-			port = &mod->ports[i];
-			if (!port->locked)
-			{
-				stack->port = port;
-				break;
-			}
-		}
-		
+		stack->port = mod_gpu_get_port(mod, stack);
+
 		/* If there is no free read port, enqueue in cache waiting list. */
 		if (!stack->port)
 		{
@@ -209,6 +239,7 @@ void mod_handler_gpu_read(int event, void *data)
 		port->locked = 1;
 		port->lock_when = esim_cycle;
 		port->stack = stack;
+		mod->banks[(port - mod->ports) / mod->bank_ports].num_locked_ports++;
 		mod->num_locked_ports++;
 	
 		/* Statistics */
@@ -227,20 +258,42 @@ void mod_handler_gpu_read(int event, void *data)
 			return;
 		}
 
+		/* Sectors needed, the whole block if not given */
+		if (!stack->sectors)
+			stack->sectors = mod_get_sectors(mod, stack->tag, mod->block_size);
+
 		/* Get block from cache, consuming 'latency' cycles. */
 		stack->hit = cache_find_block(mod->cache, stack->tag,
 			&stack->set, &stack->way, &stack->state);
 		if (stack->hit)
 		{
-			mod->effective_read_hits++;
-			esim_schedule_event(EV_MOD_GPU_READ_UNLOCK, stack, mod->latency);
+			uint32_t valid_sectors;
+
+			/* Sector miss. Only the missing sectors are requested, and the
+			 * block is not replaced. */
+			cache_get_sectors(mod->cache, stack->set, stack->way,
+				&valid_sectors, NULL);
+			if (stack->sectors & ~valid_sectors)
+			{
+				mod->sector_misses++;
+				stack->sectors &= ~valid_sectors;
+				esim_schedule_event(EV_MOD_GPU_READ_REQUEST, stack, mod->latency);
+			}
+			else
+			{
+				mod->effective_read_hits++;
+				esim_schedule_event(EV_MOD_GPU_READ_UNLOCK, stack, mod->latency);
+			}
 		}
 		else
 		{
 			stack->way = cache_replace_block(mod->cache, stack->set);
 			cache_get_block(mod->cache, stack->set, stack->way, NULL, &stack->state);
 			if (stack->state)
+			{
 				mod->evictions++;
+				mod_evict_sectors(mod, stack->set, stack->way);
+			}
 			esim_schedule_event(EV_MOD_GPU_READ_REQUEST, stack, mod->latency);
 		}
 
@@ -283,6 +336,8 @@ void mod_handler_gpu_read(int event, void *data)
 		newstack = mod_stack_create(stack->id,
 			target_mod, stack->tag,
 			EV_MOD_GPU_READ_REQUEST_REPLY, stack);
+		newstack->sectors = mod_get_request_sectors(target_mod, mod,
+			stack->tag, stack->sectors);
 		esim_schedule_event(EV_MOD_GPU_READ, newstack, 0);
 		return;
 	}
@@ -298,8 +353,8 @@ void mod_handler_gpu_read(int event, void *data)
 
 		/* Send message */
 		stack->msg = net_try_send_ev(net, target_mod->high_net_node, mod->low_net_node,
-			mod->block_size + 8, EV_MOD_GPU_READ_REQUEST_FINISH, stack,
-			event, stack);
+			mod_get_sectors_size(mod, stack->sectors) + 8,
+			EV_MOD_GPU_READ_REQUEST_FINISH, stack, event, stack);
 		return;
 	}
 
@@ -314,6 +369,7 @@ void mod_handler_gpu_read(int event, void *data)
 		/* Set tag and state of the new block.
 		 * A set other than 0 means that the block is valid. */
 		cache_set_block(mod->cache, stack->set, stack->way, stack->tag, 1);
+		mod_fill_sectors(mod, stack->set, stack->way, stack->sectors, 0);
 		esim_schedule_event(EV_MOD_GPU_READ_UNLOCK, stack, 0);
 		return;
 	}
@@ -333,6 +389,7 @@ void mod_handler_gpu_read(int event, void *data)
 		assert(mod->num_locked_ports > 0);
 		port->locked = 0;
 		port->stack = NULL;
+		mod->banks[(port - mod->ports) / mod->bank_ports].num_locked_ports--;
 		mod->num_locked_ports--;
 
 		/* Wake up accesses in waiting lists */
@@ -426,16 +483,8 @@ void mod_handler_gpu_write(int event, void *data)
 		}
 
 		/* Look for a free write port */
-		for (i = 0; i < mod->num_ports; i++)
-		{
-			port = &mod->ports[i];
-			if (!port->locked)
-			{
-				stack->port = port;
-				break;
-			}
-		}
-		
+		stack->port = mod_gpu_get_port(mod, stack);
+
 		/* If there is no free write port, enqueue in cache waiting list. */
 		if (!stack->port)
 		{
@@ -453,6 +502,7 @@ void mod_handler_gpu_write(int event, void *data)
 		port->locked = 1;
 		port->lock_when = esim_cycle;
 		port->stack = stack;
+		mod->banks[(port - mod->ports) / mod->bank_ports].num_locked_ports++;
 		mod->num_locked_ports++;
 		mem_debug("%lld %lld write cache=\"%s\" addr=%u\n",
 			esim_cycle, stack->id, mod->name, stack->addr);
@@ -580,6 +630,7 @@ void mod_handler_gpu_write(int event, void *data)
 		assert(mod->num_locked_ports > 0);
 		port->locked = 0;
 		port->stack = NULL;
+		mod->banks[(port - mod->ports) / mod->bank_ports].num_locked_ports--;
 		mod->num_locked_ports--;
 
 		/* Wake up accesses in waiting lists */
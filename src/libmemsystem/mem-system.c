@@ -53,91 +53,106 @@ void mem_system_init(void)
 	/* Create network and module list */
 	mem_system->net_list = list_create();
 	mem_system->mod_list = list_create();
+	mem_system->tlb_list = list_create();
+	mem_system->node_list = list_create();
 
 	/* GPU memory event-driven simulation */
-	EV_MOD_GPU_LOAD = esim_register_event(mod_handler_gpu_load);
-	EV_MOD_GPU_LOAD_FINISH = esim_register_event(mod_handler_gpu_load);
-
-	EV_MOD_GPU_STORE = esim_register_event(mod_handler_gpu_store);
-	EV_MOD_GPU_STORE_FINISH = esim_register_event(mod_handler_gpu_store);
-
-	EV_MOD_GPU_READ = esim_register_event(mod_handler_gpu_read);
-	EV_MOD_GPU_READ_REQUEST = esim_register_event(mod_handler_gpu_read);
-	EV_MOD_GPU_READ_REQUEST_RECEIVE = esim_register_event(mod_handler_gpu_read);
-	EV_MOD_GPU_READ_REQUEST_REPLY = esim_register_event(mod_handler_gpu_read);
-	EV_MOD_GPU_READ_REQUEST_FINISH = esim_register_event(mod_handler_gpu_read);
-	EV_MOD_GPU_READ_UNLOCK = esim_register_event(mod_handler_gpu_read);
-	EV_MOD_GPU_READ_FINISH = esim_register_event(mod_handler_gpu_read);
-
-	EV_MOD_GPU_WRITE = esim_register_event(mod_handler_gpu_write);
-	EV_MOD_GPU_WRITE_REQUEST_SEND = esim_register_event(mod_handler_gpu_write);
-	EV_MOD_GPU_WRITE_REQUEST_RECEIVE = esim_register_event(mod_handler_gpu_write);
-	EV_MOD_GPU_WRITE_REQUEST_REPLY = esim_register_event(mod_handler_gpu_write);
-	EV_MOD_GPU_WRITE_REQUEST_REPLY_RECEIVE = esim_register_event(mod_handler_gpu_write);
-	EV_MOD_GPU_WRITE_UNLOCK = esim_register_event(mod_handler_gpu_write);
-	EV_MOD_GPU_WRITE_FINISH = esim_register_event(mod_handler_gpu_write);
+	EV_MOD_GPU_LOAD = esim_register_event("EV_MOD_GPU_LOAD", mod_handler_gpu_load);
+	EV_MOD_GPU_LOAD_FINISH = esim_register_event("EV_MOD_GPU_LOAD_FINISH", mod_handler_gpu_load);
+
+	EV_MOD_GPU_STORE = esim_register_event("EV_MOD_GPU_STORE", mod_handler_gpu_store);
+	EV_MOD_GPU_STORE_FINISH = esim_register_event("EV_MOD_GPU_STORE_FINISH", mod_handler_gpu_store);
+
+	EV_MOD_GPU_READ = esim_register_event("EV_MOD_GPU_READ", mod_handler_gpu_read);
+	EV_MOD_GPU_READ_REQUEST = esim_register_event("EV_MOD_GPU_READ_REQUEST", mod_handler_gpu_read);
+	EV_MOD_GPU_READ_REQUEST_RECEIVE = esim_register_event("EV_MOD_GPU_READ_REQUEST_RECEIVE", mod_handler_gpu_read);
+	EV_MOD_GPU_READ_REQUEST_REPLY = esim_register_event("EV_MOD_GPU_READ_REQUEST_REPLY", mod_handler_gpu_read);
+	EV_MOD_GPU_READ_REQUEST_FINISH = esim_register_event("EV_MOD_GPU_READ_REQUEST_FINISH", mod_handler_gpu_read);
+	EV_MOD_GPU_READ_UNLOCK = esim_register_event("EV_MOD_GPU_READ_UNLOCK", mod_handler_gpu_read);
+	EV_MOD_GPU_READ_FINISH = esim_register_event("EV_MOD_GPU_READ_FINISH", mod_handler_gpu_read);
+
+	EV_MOD_GPU_WRITE = esim_register_event("EV_MOD_GPU_WRITE", mod_handler_gpu_write);
+	EV_MOD_GPU_WRITE_REQUEST_SEND = esim_register_event("EV_MOD_GPU_WRITE_REQUEST_SEND", mod_handler_gpu_write);
+	EV_MOD_GPU_WRITE_REQUEST_RECEIVE = esim_register_event("EV_MOD_GPU_WRITE_REQUEST_RECEIVE", mod_handler_gpu_write);
+	EV_MOD_GPU_WRITE_REQUEST_REPLY = esim_register_event("EV_MOD_GPU_WRITE_REQUEST_REPLY", mod_handler_gpu_write);
+	EV_MOD_GPU_WRITE_REQUEST_REPLY_RECEIVE = esim_register_event("EV_MOD_GPU_WRITE_REQUEST_REPLY_RECEIVE", mod_handler_gpu_write);
+	EV_MOD_GPU_WRITE_UNLOCK = esim_register_event("EV_MOD_GPU_WRITE_UNLOCK", mod_handler_gpu_write);
+	EV_MOD_GPU_WRITE_FINISH = esim_register_event("EV_MOD_GPU_WRITE_FINISH", mod_handler_gpu_write);
 
 	/* CPU memory event-driven simulation */
-	EV_MOD_LOAD = esim_register_event(mod_handler_load);
-	EV_MOD_LOAD_LOCK = esim_register_event(mod_handler_load);
-	EV_MOD_LOAD_ACTION = esim_register_event(mod_handler_load);
-	EV_MOD_LOAD_MISS = esim_register_event(mod_handler_load);
-	EV_MOD_LOAD_UNLOCK = esim_register_event(mod_handler_load);
-	EV_MOD_LOAD_FINISH = esim_register_event(mod_handler_load);
-
-	EV_MOD_STORE = esim_register_event(mod_handler_store);
-	EV_MOD_STORE_LOCK = esim_register_event(mod_handler_store);
-	EV_MOD_STORE_ACTION = esim_register_event(mod_handler_store);
-	EV_MOD_STORE_UNLOCK = esim_register_event(mod_handler_store);
-	EV_MOD_STORE_FINISH = esim_register_event(mod_handler_store);
-
-	EV_MOD_FIND_AND_LOCK = esim_register_event(mod_handler_find_and_lock);
-	EV_MOD_FIND_AND_LOCK_PORT = esim_register_event(mod_handler_find_and_lock);
-	EV_MOD_FIND_AND_LOCK_ACTION = esim_register_event(mod_handler_find_and_lock);
-	EV_MOD_FIND_AND_LOCK_FINISH = esim_register_event(mod_handler_find_and_lock);
-
-	EV_MOD_EVICT = esim_register_event(mod_handler_evict);
-	EV_MOD_EVICT_INVALID = esim_register_event(mod_handler_evict);
-	EV_MOD_EVICT_ACTION = esim_register_event(mod_handler_evict);
-	EV_MOD_EVICT_RECEIVE = esim_register_event(mod_handler_evict);
-	EV_MOD_EVICT_WRITEBACK = esim_register_event(mod_handler_evict);
-	EV_MOD_EVICT_WRITEBACK_EXCLUSIVE = esim_register_event(mod_handler_evict);
-	EV_MOD_EVICT_WRITEBACK_FINISH = esim_register_event(mod_handler_evict);
-	EV_MOD_EVICT_PROCESS = esim_register_event(mod_handler_evict);
-	EV_MOD_EVICT_REPLY = esim_register_event(mod_handler_evict);
-	EV_MOD_EVICT_REPLY_RECEIVE = esim_register_event(mod_handler_evict);
-	EV_MOD_EVICT_FINISH = esim_register_event(mod_handler_evict);
-
-	EV_MOD_WRITE_REQUEST = esim_register_event(mod_handler_write_request);
-	EV_MOD_WRITE_REQUEST_RECEIVE = esim_register_event(mod_handler_write_request);
-	EV_MOD_WRITE_REQUEST_ACTION = esim_register_event(mod_handler_write_request);
-	EV_MOD_WRITE_REQUEST_EXCLUSIVE = esim_register_event(mod_handler_write_request);
-	EV_MOD_WRITE_REQUEST_UPDOWN = esim_register_event(mod_handler_write_request);
-	EV_MOD_WRITE_REQUEST_UPDOWN_FINISH = esim_register_event(mod_handler_write_request);
-	EV_MOD_WRITE_REQUEST_DOWNUP = esim_register_event(mod_handler_write_request);
-	EV_MOD_WRITE_REQUEST_DOWNUP_FINISH = esim_register_event(mod_handler_write_request);
-	EV_MOD_WRITE_REQUEST_REPLY = esim_register_event(mod_handler_write_request);
-	EV_MOD_WRITE_REQUEST_FINISH = esim_register_event(mod_handler_write_request);
-
-	EV_MOD_READ_REQUEST = esim_register_event(mod_handler_read_request);
-	EV_MOD_READ_REQUEST_RECEIVE = esim_register_event(mod_handler_read_request);
-	EV_MOD_READ_REQUEST_ACTION = esim_register_event(mod_handler_read_request);
-	EV_MOD_READ_REQUEST_UPDOWN = esim_register_event(mod_handler_read_request);
-	EV_MOD_READ_REQUEST_UPDOWN_MISS = esim_register_event(mod_handler_read_request);
-	EV_MOD_READ_REQUEST_UPDOWN_FINISH = esim_register_event(mod_handler_read_request);
-	EV_MOD_READ_REQUEST_DOWNUP = esim_register_event(mod_handler_read_request);
-	EV_MOD_READ_REQUEST_DOWNUP_WAIT_FOR_REQS = esim_register_event(mod_handler_read_request);
-	EV_MOD_READ_REQUEST_DOWNUP_FINISH = esim_register_event(mod_handler_read_request);
-	EV_MOD_READ_REQUEST_REPLY = esim_register_event(mod_handler_read_request);
-	EV_MOD_READ_REQUEST_FINISH = esim_register_event(mod_handler_read_request);
-
-	EV_MOD_INVALIDATE = esim_register_event(mod_handler_invalidate);
-	EV_MOD_INVALIDATE_FINISH = esim_register_event(mod_handler_invalidate);
-
-	EV_MOD_PEER_SEND = esim_register_event(mod_handler_peer);
-	EV_MOD_PEER_RECEIVE = esim_register_event(mod_handler_peer);
-	EV_MOD_PEER_REPLY_ACK = esim_register_event(mod_handler_peer);
-	EV_MOD_PEER_FINISH = esim_register_event(mod_handler_peer);
+	EV_MOD_LOAD = esim_register_event("EV_MOD_LOAD", mod_handler_load);
+	EV_MOD_LOAD_LOCK = esim_register_event("EV_MOD_LOAD_LOCK", mod_handler_load);
+	EV_MOD_LOAD_ACTION = esim_register_event("EV_MOD_LOAD_ACTION", mod_handler_load);
+	EV_MOD_LOAD_MISS = esim_register_event("EV_MOD_LOAD_MISS", mod_handler_load);
+	EV_MOD_LOAD_UNLOCK = esim_register_event("EV_MOD_LOAD_UNLOCK", mod_handler_load);
+	EV_MOD_LOAD_FINISH = esim_register_event("EV_MOD_LOAD_FINISH", mod_handler_load);
+
+	EV_MOD_STORE = esim_register_event("EV_MOD_STORE", mod_handler_store);
+	EV_MOD_STORE_LOCK = esim_register_event("EV_MOD_STORE_LOCK", mod_handler_store);
+	EV_MOD_STORE_ACTION = esim_register_event("EV_MOD_STORE_ACTION", mod_handler_store);
+	EV_MOD_STORE_UNLOCK = esim_register_event("EV_MOD_STORE_UNLOCK", mod_handler_store);
+	EV_MOD_STORE_FINISH = esim_register_event("EV_MOD_STORE_FINISH", mod_handler_store);
+
+	EV_MOD_FIND_AND_LOCK = esim_register_event("EV_MOD_FIND_AND_LOCK", mod_handler_find_and_lock);
+	EV_MOD_FIND_AND_LOCK_PORT = esim_register_event("EV_MOD_FIND_AND_LOCK_PORT", mod_handler_find_and_lock);
+	EV_MOD_FIND_AND_LOCK_ACTION = esim_register_event("EV_MOD_FIND_AND_LOCK_ACTION", mod_handler_find_and_lock);
+	EV_MOD_FIND_AND_LOCK_FINISH = esim_register_event("EV_MOD_FIND_AND_LOCK_FINISH", mod_handler_find_and_lock);
+
+	EV_MOD_EVICT = esim_register_event("EV_MOD_EVICT", mod_handler_evict);
+	EV_MOD_EVICT_INVALID = esim_register_event("EV_MOD_EVICT_INVALID", mod_handler_evict);
+	EV_MOD_EVICT_ACTION = esim_register_event("EV_MOD_EVICT_ACTION", mod_handler_evict);
+	EV_MOD_EVICT_RECEIVE = esim_register_event("EV_MOD_EVICT_RECEIVE", mod_handler_evict);
+	EV_MOD_EVICT_WRITEBACK = esim_register_event("EV_MOD_EVICT_WRITEBACK", mod_handler_evict);
+	EV_MOD_EVICT_WRITEBACK_EXCLUSIVE = esim_register_event("EV_MOD_EVICT_WRITEBACK_EXCLUSIVE", mod_handler_evict);
+	EV_MOD_EVICT_WRITEBACK_FINISH = esim_register_event("EV_MOD_EVICT_WRITEBACK_FINISH", mod_handler_evict);
+	EV_MOD_EVICT_PROCESS = esim_register_event("EV_MOD_EVICT_PROCESS", mod_handler_evict);
+	EV_MOD_EVICT_REPLY = esim_register_event("EV_MOD_EVICT_REPLY", mod_handler_evict);
+	EV_MOD_EVICT_REPLY_RECEIVE = esim_register_event("EV_MOD_EVICT_REPLY_RECEIVE", mod_handler_evict);
+	EV_MOD_EVICT_FINISH = esim_register_event("EV_MOD_EVICT_FINISH", mod_handler_evict);
+
+	EV_MOD_WRITE_REQUEST = esim_register_event("EV_MOD_WRITE_REQUEST", mod_handler_write_request);
+	EV_MOD_WRITE_REQUEST_RECEIVE = esim_register_event("EV_MOD_WRITE_REQUEST_RECEIVE", mod_handler_write_request);
+	EV_MOD_WRITE_REQUEST_ACTION = esim_register_event("EV_MOD_WRITE_REQUEST_ACTION", mod_handler_write_request);
+	EV_MOD_WRITE_REQUEST_EXCLUSIVE = esim_register_event("EV_MOD_WRITE_REQUEST_EXCLUSIVE", mod_handler_write_request);
+	EV_MOD_WRITE_REQUEST_UPDOWN = esim_register_event("EV_MOD_WRITE_REQUEST_UPDOWN", mod_handler_write_request);
+	EV_MOD_WRITE_REQUEST_UPDOWN_FINISH = esim_register_event("EV_MOD_WRITE_REQUEST_UPDOWN_FINISH", mod_handler_write_request);
+	EV_MOD_WRITE_REQUEST_DOWNUP = esim_register_event("EV_MOD_WRITE_REQUEST_DOWNUP", mod_handler_write_request);
+	EV_MOD_WRITE_REQUEST_DOWNUP_FINISH = esim_register_event("EV_MOD_WRITE_REQUEST_DOWNUP_FINISH", mod_handler_write_request);
+	EV_MOD_WRITE_REQUEST_REPLY = esim_register_event("EV_MOD_WRITE_REQUEST_REPLY", mod_handler_write_request);
+	EV_MOD_WRITE_REQUEST_FINISH = esim_register_event("EV_MOD_WRITE_REQUEST_FINISH", mod_handler_write_request);
+
+	EV_MOD_READ_REQUEST = esim_register_event("EV_MOD_READ_REQUEST", mod_handler_read_request);
+	EV_MOD_READ_REQUEST_RECEIVE = esim_register_event("EV_MOD_READ_REQUEST_RECEIVE", mod_handler_read_request);
+	EV_MOD_READ_REQUEST_ACTION = esim_register_event("EV_MOD_READ_REQUEST_ACTION", mod_handler_read_request);
+	EV_MOD_READ_REQUEST_UPDOWN = esim_register_event("EV_MOD_READ_REQUEST_UPDOWN", mod_handler_read_request);
+	EV_MOD_READ_REQUEST_UPDOWN_MISS = esim_register_event("EV_MOD_READ_REQUEST_UPDOWN_MISS", mod_handler_read_request);
+	EV_MOD_READ_REQUEST_UPDOWN_FINISH = esim_register_event("EV_MOD_READ_REQUEST_UPDOWN_FINISH", mod_handler_read_request);
+	EV_MOD_READ_REQUEST_DOWNUP = esim_register_event("EV_MOD_READ_REQUEST_DOWNUP", mod_handler_read_request);
+	EV_MOD_READ_REQUEST_DOWNUP_WAIT_FOR_REQS = esim_register_event("EV_MOD_READ_REQUEST_DOWNUP_WAIT_FOR_REQS", mod_handler_read_request);
+	EV_MOD_READ_REQUEST_DOWNUP_FINISH = esim_register_event("EV_MOD_READ_REQUEST_DOWNUP_FINISH", mod_handler_read_request);
+	EV_MOD_READ_REQUEST_REPLY = esim_register_event("EV_MOD_READ_REQUEST_REPLY", mod_handler_read_request);
+	EV_MOD_READ_REQUEST_FINISH = esim_register_event("EV_MOD_READ_REQUEST_FINISH", mod_handler_read_request);
+
+	EV_MOD_INVALIDATE = esim_register_event("EV_MOD_INVALIDATE", mod_handler_invalidate);
+	EV_MOD_INVALIDATE_FINISH = esim_register_event("EV_MOD_INVALIDATE_FINISH", mod_handler_invalidate);
+
+	EV_MOD_PEER_SEND = esim_register_event("EV_MOD_PEER_SEND", mod_handler_peer);
+	EV_MOD_PEER_RECEIVE = esim_register_event("EV_MOD_PEER_RECEIVE", mod_handler_peer);
+	EV_MOD_PEER_REPLY_ACK = esim_register_event("EV_MOD_PEER_REPLY_ACK", mod_handler_peer);
+	EV_MOD_PEER_FINISH = esim_register_event("EV_MOD_PEER_FINISH", mod_handler_peer);
+
+	EV_MOD_SECTOR_FILL = esim_register_event("EV_MOD_SECTOR_FILL", mod_handler_sector_fill);
+	EV_MOD_SECTOR_FILL_RECEIVE = esim_register_event("EV_MOD_SECTOR_FILL_RECEIVE", mod_handler_sector_fill);
+	EV_MOD_SECTOR_FILL_ACTION = esim_register_event("EV_MOD_SECTOR_FILL_ACTION", mod_handler_sector_fill);
+	EV_MOD_SECTOR_FILL_MISS = esim_register_event("EV_MOD_SECTOR_FILL_MISS", mod_handler_sector_fill);
+	EV_MOD_SECTOR_FILL_REPLY = esim_register_event("EV_MOD_SECTOR_FILL_REPLY", mod_handler_sector_fill);
+	EV_MOD_SECTOR_FILL_FINISH = esim_register_event("EV_MOD_SECTOR_FILL_FINISH", mod_handler_sector_fill);
+
+	EV_DRAM_SCHEDULE = esim_register_event("EV_DRAM_SCHEDULE", dram_handler);
+
+	EV_TLB_MISS = esim_register_event("EV_TLB_MISS", tlb_handler);
+	EV_TLB_LOOKUP = esim_register_event("EV_TLB_LOOKUP", tlb_handler);
+	EV_TLB_WALK = esim_register_event("EV_TLB_WALK", tlb_handler);
 
 	/* Read cache configuration file */
 	mem_system_config_read();
@@ -167,6 +182,14 @@ void mem_system_done(void)
 		net_free(list_get(mem_system->net_list, i));
 	list_free(mem_system->net_list);
 
+	/* Free TLBs */
+	for (i = 0; i < list_count(mem_system->tlb_list); i++)
+		tlb_free(list_get(mem_system->tlb_list, i));
+	list_free(mem_system->tlb_list);
+
+	/* Free list of NUMA nodes */
+	list_free(mem_system->node_list);
+
 	/* Free memory system */
 	free(mem_system);
 }
@@ -180,6 +203,7 @@ void mem_system_dump_report()
 	FILE *f;
 
 	int i;
+	int j;
 
 	/* Open file */
 	f = open_write(mem_report_file_name);
@@ -192,6 +216,21 @@ void mem_system_dump_report()
 	fprintf(f, ";    Hits, Misses - Accesses resulting in hits/misses\n");
 	fprintf(f, ";    HitRatio - Hits divided by accesses\n");
 	fprintf(f, ";    Evictions - Invalidated or replaced cache blocks\n");
+	fprintf(f, ";    InclusionVictims - Evictions invalidating copies in upper-level caches\n");
+	fprintf(f, ";    VictimFills - Non-inclusive caches, data of blocks received from evictions\n");
+	fprintf(f, ";        in upper-level caches\n");
+	fprintf(f, ";    DataDrops - Non-inclusive caches, data dropped from blocks kept in the\n");
+	fprintf(f, ";        directory\n");
+	fprintf(f, ";    DataEvictions - Non-inclusive caches, data written to lower levels to free\n");
+	fprintf(f, ";        a frame, from blocks kept in the directory\n");
+	fprintf(f, ";    SectorMisses - Sectored caches, accesses to a present block missing sectors\n");
+	fprintf(f, ";    SectorFills - Sectors brought from lower levels\n");
+	fprintf(f, ";    SectorWritebacks - Dirty sectors written back to lower levels\n");
+	fprintf(f, ";    SectorUtilization - Fraction of sectors valid in replaced blocks\n");
+	fprintf(f, ";    BankConflicts - Banked modules, accesses waiting for a port of their bank\n");
+	fprintf(f, ";        while ports of other banks were free\n");
+	fprintf(f, ";    BankWaitCycles - Cycles accesses waited for a port of their bank\n");
+	fprintf(f, ";    BankImbalance - Accesses to the busiest bank over the average per bank\n");
 	fprintf(f, ";    Retries - For L1 caches, accesses that were retried\n");
 	fprintf(f, ";    ReadRetries, WriteRetries - Read/Write retried accesses\n");
 	fprintf(f, ";    NoRetryAccesses - Number of accesses that were not retried\n");
@@ -201,6 +240,17 @@ void mem_system_dump_report()
 	fprintf(f, ";    Reads, Writes - Total read/write accesses\n");
 	fprintf(f, ";    BlockingReads, BlockingWrites - Reads/writes coming from lower-level cache\n");
 	fprintf(f, ";    NonBlockingReads, NonBlockingWrites - Coming from upper-level cache\n");
+	fprintf(f, ";    StackAllocations - Access stacks created for accesses and sub-requests\n");
+	fprintf(f, ";    StackPoolSize - Access stacks allocated in host memory and recycled\n");
+	fprintf(f, ";    AccessTableSize - Entries of the table of in-flight accesses\n");
+	fprintf(f, ";    AccessTableMaxChain - Longest sequence of entries probed to insert an access\n");
+	fprintf(f, ";    DirectoryMaxBlocks - Most blocks with entries allocated in a sparse directory\n");
+	fprintf(f, ";    DirectoryOverflows - Sparse directory entries with sharers exceeding the list\n");
+	fprintf(f, ";    AtomicAccesses - Lookups of accesses in atomic mode (e.g., warm-up)\n");
+	fprintf(f, ";    AtomicHits, AtomicMisses - Hits and misses for atomic accesses\n");
+	fprintf(f, ";    AtomicHitRatio - AtomicHits divided by AtomicAccesses\n");
+	fprintf(f, ";    AtomicEvictions - Blocks replaced by atomic accesses\n");
+	fprintf(f, ";    AtomicAverageLatency - Estimated latency of atomic accesses issued here\n");
 	fprintf(f, "\n\n");
 	
 	/* Report for each cache */
@@ -214,12 +264,25 @@ void mem_system_dump_report()
 		/* Configuration */
 		if (cache) {
 			fprintf(f, "Sets = %d\n", cache->num_sets);
-			fprintf(f, "Assoc = %d\n", cache->assoc);
+			fprintf(f, "Assoc = %d\n", cache->data_assoc);
+			if (cache->data)
+				fprintf(f, "DirectoryAssoc = %d\n", cache->assoc);
 			fprintf(f, "Policy = %s\n", map_value(&cache_policy_map, cache->policy));
+			if (mod->kind == mod_kind_cache)
+				fprintf(f, "Inclusion = %s\n", map_value(&mod_inclusion_map,
+					mod->inclusion));
 		}
 		fprintf(f, "BlockSize = %d\n", mod->block_size);
+		if (cache && cache->num_sectors > 1)
+			fprintf(f, "Sectors = %d\n", cache->num_sectors);
 		fprintf(f, "Latency = %d\n", mod->latency);
-		fprintf(f, "Ports = %d\n", mod->num_ports);
+		fprintf(f, "Ports = %d\n", mod->bank_ports);
+		if (mod->num_banks > 1)
+		{
+			fprintf(f, "Banks = %d\n", mod->num_banks);
+			fprintf(f, "BankSelect = %s\n", map_value(&mod_bank_select_map,
+				mod->bank_select));
+		}
 		fprintf(f, "\n");
 
 		/* Statistics */
@@ -229,6 +292,37 @@ void mem_system_dump_report()
 		fprintf(f, "HitRatio = %.4g\n", mod->accesses ?
 			(double) mod->hits / mod->accesses : 0.0);
 		fprintf(f, "Evictions = %lld\n", mod->evictions);
+		fprintf(f, "InclusionVictims = %lld\n", mod->inclusion_victims);
+		if (mod->inclusion != mod_inclusion_inclusive)
+		{
+			fprintf(f, "VictimFills = %lld\n", mod->victim_fills);
+			fprintf(f, "DataDrops = %lld\n", mod->data_drops);
+			fprintf(f, "DataEvictions = %lld\n", mod->data_evictions);
+		}
+		if (cache && cache->num_sectors > 1)
+		{
+			fprintf(f, "SectorMisses = %lld\n", mod->sector_misses);
+			fprintf(f, "SectorFills = %lld\n", mod->sector_fills);
+			fprintf(f, "SectorWritebacks = %lld\n", mod->sector_writebacks);
+			fprintf(f, "SectorUtilization = %.4g\n", mod->sector_evicted_blocks ?
+				(double) mod->sector_evicted_valid / mod->sector_evicted_blocks /
+				cache->num_sectors : 0.0);
+		}
+		if (mod->num_banks > 1)
+		{
+			long long bank_accesses = 0;
+			long long max_bank_accesses = 0;
+
+			for (j = 0; j < mod->num_banks; j++)
+			{
+				bank_accesses += mod->banks[j].accesses;
+				max_bank_accesses = MAX(max_bank_accesses, mod->banks[j].accesses);
+			}
+			fprintf(f, "BankConflicts = %lld\n", mod->bank_conflicts);
+			fprintf(f, "BankWaitCycles = %lld\n", mod->bank_wait_cycles);
+			fprintf(f, "BankImbalance = %.4g\n", bank_accesses ?
+				(double) max_bank_accesses * mod->num_banks / bank_accesses : 0.0);
+		}
 		fprintf(f, "Retries = %lld\n", mod->read_retries + mod->write_retries);
 		fprintf(f, "ReadRetries = %lld\n", mod->read_retries);
 		fprintf(f, "WriteRetries = %lld\n", mod->write_retries);
@@ -258,9 +352,44 @@ void mem_system_dump_report()
 		fprintf(f, "NonBlockingWrites = %lld\n", mod->non_blocking_writes);
 		fprintf(f, "WriteHits = %lld\n", mod->write_hits);
 		fprintf(f, "WriteMisses = %lld\n", mod->writes - mod->write_hits);
+		fprintf(f, "\n");
+		fprintf(f, "StackAllocations = %lld\n", repos_create_count(mod->stack_repos));
+		fprintf(f, "StackPoolSize = %d\n", repos_object_count(mod->stack_repos));
+		fprintf(f, "AccessTableSize = %d\n", mod->access_table_size);
+		fprintf(f, "AccessTableMaxChain = %d\n", mod->access_table_max_chain);
+		if (mod->dir && mod->dir->num_pointers)
+		{
+			fprintf(f, "DirectoryMaxBlocks = %d\n", mod->dir->max_groups);
+			fprintf(f, "DirectoryOverflows = %lld\n", mod->dir->overflows);
+		}
+		fprintf(f, "\n");
+		fprintf(f, "AtomicAccesses = %lld\n", mod->atomic_accesses);
+		fprintf(f, "AtomicHits = %lld\n", mod->atomic_hits);
+		fprintf(f, "AtomicMisses = %lld\n", mod->atomic_accesses - mod->atomic_hits);
+		fprintf(f, "AtomicHitRatio = %.4g\n", mod->atomic_accesses ?
+			(double) mod->atomic_hits / mod->atomic_accesses : 0.0);
+		fprintf(f, "AtomicEvictions = %lld\n", mod->atomic_evictions);
+		fprintf(f, "AtomicAverageLatency = %.4g\n", mod->atomic_entry_accesses ?
+			(double) mod->atomic_latency / mod->atomic_entry_accesses : 0.0);
 		fprintf(f, "\n\n");
+
+		/* Stack distance analysis */
+		if (mod->sdist)
+			sdist_dump_report(mod->sdist, f);
+
+		/* DRAM */
+		if (mod->dram)
+			dram_dump_report(mod->dram, f);
+
+		/* Prefetcher */
+		if (mod->prefetcher)
+			prefetcher_dump_report(mod->prefetcher, f);
 	}
 
+	/* Dump report for TLBs */
+	for (i = 0; i < list_count(mem_system->tlb_list); i++)
+		tlb_dump_report(list_get(mem_system->tlb_list, i), f);
+
 	/* Dump report for networks */
 	for (i = 0; i < list_count(mem_system->net_list); i++)
 	{
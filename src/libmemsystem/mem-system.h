@@ -27,6 +27,7 @@
 #include <list.h>
 #include <linked-list.h>
 #include <misc.h>
+#include <repos.h>
 
 
 
@@ -43,7 +44,10 @@ enum cache_policy_t
 	cache_policy_invalid = 0,
 	cache_policy_lru,
 	cache_policy_fifo,
-	cache_policy_random
+	cache_policy_random,
+	cache_policy_plru,
+	cache_policy_srrip,
+	cache_policy_brrip
 };
 
 enum cache_block_state_t
@@ -56,24 +60,11 @@ enum cache_block_state_t
 	cache_block_shared
 };
 
-struct cache_block_t
-{
-	struct cache_block_t *way_next;
-	struct cache_block_t *way_prev;
-
-	uint32_t tag;
-	uint32_t transient_tag;
-	uint32_t way;
-
-	enum cache_block_state_t state;
-};
+/* Maximum associativity, given by the 8-bit age counters of LRU */
+#define CACHE_MAX_ASSOC  256
 
-struct cache_set_t
-{
-	struct cache_block_t *way_head;
-	struct cache_block_t *way_tail;
-	struct cache_block_t *blocks;
-};
+/* Maximum number of sectors per block, given by the 32-bit sector masks */
+#define CACHE_MAX_SECTORS  32
 
 struct cache_t
 {
@@ -84,14 +75,60 @@ struct cache_t
 	uint32_t assoc;
 	enum cache_policy_t policy;
 
-	struct cache_set_t *sets;
 	uint32_t block_mask;
 	int log_block_size;
+
+	/* Sectors per block, and log2 of their size. An unsectored cache has one
+	 * sector as large as the block. */
+	int num_sectors;
+	int log_sector_size;
+
+	/* Tag store. Arrays of 'num_sets * assoc' elements, where the tags of
+	 * all ways in a set are contiguous, so that they can be compared with
+	 * SIMD instructions. States are 'enum cache_block_state_t' values,
+	 * stored as 32-bit integers for the same reason. All arrays are part
+	 * of one single allocation. */
+	uint32_t *tags;
+	uint32_t *transient_tags;
+	int32_t *states;
+
+	/* Replacement state, 'repl_size' bytes per set. Its encoding depends on
+	 * the policy: one 8-bit age per way for LRU, FIFO, and Random (0 for the
+	 * most recently used/inserted block); 'assoc - 1' tree bits for PLRU; and
+	 * one 2-bit re-reference prediction value per way for SRRIP/BRRIP. */
+	uint8_t *repl;
+	int repl_size;
+
+	/* For sectored caches, masks of valid and dirty sectors of each block,
+	 * cleared when a block is invalidated or replaced. NULL otherwise. */
+	uint32_t *valid_sectors;
+	uint32_t *dirty_sectors;
+
+	/* Number of blocks inserted, used by BRRIP to insert one out of every
+	 * few blocks with a long instead of a distant re-reference interval. */
+	long long insertions;
+
+	/* Non-inclusive caches have 'assoc' ways of tags, but only 'data_assoc'
+	 * data frames per set, so a block may be present without its data. Array
+	 * 'data' keeps 'CACHE_DATA_xxx' flags for each block. It is NULL if every
+	 * block has a data frame ('data_assoc' equal to 'assoc'). */
+	uint32_t data_assoc;
+	uint8_t *data;
 };
 
+/* Flags of array 'data' of a cache. A block holds its data if it is valid and
+ * flag 'VALID' is set, which is cleared when the block is invalidated. Flag
+ * 'RESERVED' marks the data frame taken by the access that locked the block
+ * to bring its data. */
+#define CACHE_DATA_VALID  0x1
+#define CACHE_DATA_RESERVED  0x2
+
+/* Position of block {set, way} in the tag store arrays */
+#define CACHE_BLOCK_INDEX(cache, set, way)  ((set) * (cache)->assoc + (way))
+
 
 struct cache_t *cache_create(char *name, uint32_t num_sets, uint32_t block_size,
-	uint32_t assoc, enum cache_policy_t policy);
+	uint32_t assoc, enum cache_policy_t policy, int num_sectors);
 void cache_free(struct cache_t *cache);
 
 void cache_decode_address(struct cache_t *cache, uint32_t addr,
@@ -102,11 +139,28 @@ void cache_set_block(struct cache_t *cache, uint32_t set, uint32_t way,
 	uint32_t tag, int state);
 void cache_get_block(struct cache_t *cache, uint32_t set, uint32_t way,
 	uint32_t *tag_ptr, int *state_ptr);
+void cache_set_sectors(struct cache_t *cache, uint32_t set, uint32_t way,
+	uint32_t valid, uint32_t dirty);
+void cache_get_sectors(struct cache_t *cache, uint32_t set, uint32_t way,
+	uint32_t *valid_ptr, uint32_t *dirty_ptr);
+
+void cache_set_data_assoc(struct cache_t *cache, uint32_t data_assoc);
+void cache_set_data(struct cache_t *cache, uint32_t set, uint32_t way, int flags);
+int cache_get_data(struct cache_t *cache, uint32_t set, uint32_t way);
+int cache_block_has_data(struct cache_t *cache, uint32_t set, uint32_t way);
 
 void cache_access_block(struct cache_t *cache, uint32_t set, uint32_t way);
 uint32_t cache_replace_block(struct cache_t *cache, uint32_t set);
+uint32_t cache_replace_block_avoid(struct cache_t *cache, uint32_t set,
+	unsigned char *avoid);
+uint32_t cache_replace_block_among(struct cache_t *cache, uint32_t set,
+	unsigned char *avoid);
 void cache_set_transient_tag(struct cache_t *cache, uint32_t set, uint32_t way, uint32_t tag);
 
+int cache_find_way(struct cache_t *cache, uint32_t set, uint32_t tag);
+int cache_find_transient_way(struct cache_t *cache, uint32_t set, uint32_t tag,
+	int first_way, int last_way);
+
 
 
 /*
@@ -128,7 +182,11 @@ struct dir_entry_t
 {
 	int owner;  /* Node owning the block (-1 = No owner)*/
 	int num_sharers;  /* Number of 1s in next field */
-	unsigned char sharer[0];  /* Bitmap of sharers (must be last field) */
+
+	/* Bitmap of sharers in 64-bit words (must be last field). In a sparse
+	 * directory, this is a list of up to 'num_pointers' sharer nodes, or a
+	 * pointer to a bitmap allocated when the entry has more sharers. */
+	uint64_t sharer[0];
 };
 
 struct dir_t
@@ -150,22 +208,46 @@ struct dir_t
 	 * block, i.e. a set of zsize directory entries */
 	struct dir_lock_t *dir_lock;
 
+	/* Size of a directory entry, including its sharers */
+	int entry_size;
+
+	/* Sparse directory. The zsize entries of a block are only allocated
+	 * while the block has sharers or an owner, and each entry keeps up
+	 * to 'num_pointers' sharers as a list of nodes. Array 'group' has
+	 * xsize * ysize pointers to the entries of each block, or NULL. A
+	 * value of 0 for 'num_pointers' means a full-map directory, whose
+	 * entries are all allocated in field 'data'. */
+	int num_pointers;
+	unsigned char **group;
+	struct repos_t *group_repos;
+	struct repos_t *bitmap_repos;
+
+	/* Statistics for sparse directories */
+	int num_groups;
+	int max_groups;
+	long long overflows;
+
 	/* Last field. This is an array of xsize*ysize*zsize elements of type
 	 * dir_entry_t, which have likewise variable size. */
 	unsigned char data[0];
 };
 
-struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_nodes);
+struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_nodes,
+	int num_pointers);
 void dir_free(struct dir_t *dir);
 
 struct dir_entry_t *dir_entry_get(struct dir_t *dir, int x, int y, int z);
+void dir_group_release_if_empty(struct dir_t *dir, int x, int y);
 
 void dir_entry_set_owner(struct dir_t *dir, int x, int y, int z, int node);
 void dir_entry_set_sharer(struct dir_t *dir, int x, int y, int z, int node);
 void dir_entry_clear_sharer(struct dir_t *dir, int x, int y, int z, int node);
 void dir_entry_clear_all_sharers(struct dir_t *dir, int x, int y, int z);
 int dir_entry_is_sharer(struct dir_t *dir, int x, int y, int z, int node);
+int dir_entry_next_sharer(struct dir_t *dir, int x, int y, int z, int node);
 int dir_entry_group_shared_or_owned(struct dir_t *dir, int x, int y);
+int dir_entry_group_num_sharers(struct dir_t *dir, int x, int y);
+int dir_entry_group_owner(struct dir_t *dir, int x, int y);
 
 void dir_entry_dump_sharers(struct dir_t *dir, int x, int y, int z);
 
@@ -176,6 +258,170 @@ void dir_entry_unlock(struct dir_t *dir, int x, int y);
 
 
 
+/*
+ * Stack Distance Analysis
+ */
+
+struct sdist_t
+{
+	char *name;
+	int log_block_size;
+
+	/* Numbers of sets analyzed, from 'min_sets' to 'min_sets << (num_levels - 1)',
+	 * and highest associativity. All of them are powers of two. */
+	int min_sets;
+	int num_levels;
+	int max_assoc;
+
+	/* Block numbers are divided by this value before computing the set, as
+	 * done by modules serving an interleaved address range. */
+	int set_div;
+
+	/* LRU stacks. Level 'level' has 'min_sets << level' sets, and each set
+	 * contains up to 'max_assoc' block numbers, most recently used first.
+	 * Array 'stacks' holds the blocks of all sets of all levels, and array
+	 * 'stack_sizes' the number of valid blocks in each set. */
+	uint32_t *stacks;
+	int *stack_sizes;
+
+	/* Histogram of stack distances for each level, with 'max_assoc + 1'
+	 * entries. The last entry counts accesses to blocks that are not in the
+	 * stack, which miss for every associativity. */
+	long long *hist;
+
+	long long accesses;
+};
+
+struct sdist_t *sdist_create(char *name, int block_size, int min_sets, int max_sets,
+	int max_assoc);
+void sdist_free(struct sdist_t *sdist);
+
+void sdist_access(struct sdist_t *sdist, uint32_t addr);
+void sdist_dump_report(struct sdist_t *sdist, FILE *f);
+
+
+
+
+/*
+ * DRAM
+ */
+
+extern struct string_map_t dram_page_policy_map;
+extern struct string_map_t dram_scheduler_map;
+
+extern int EV_DRAM_SCHEDULE;
+
+enum dram_page_policy_t
+{
+	dram_page_policy_invalid = 0,
+	dram_page_policy_open,
+	dram_page_policy_closed
+};
+
+enum dram_scheduler_t
+{
+	dram_scheduler_invalid = 0,
+	dram_scheduler_fcfs,
+	dram_scheduler_frfcfs
+};
+
+#define DRAM_ROW_NONE  (-1)
+
+struct dram_bank_t
+{
+	int open_row;  /* Row in the row buffer, or DRAM_ROW_NONE if precharged */
+	long long ready_cycle;  /* Cycle when the next command can be issued */
+	long long activate_cycle;  /* Cycle when the open row was activated */
+};
+
+struct dram_request_t
+{
+	struct mod_stack_t *stack;
+	int event;  /* Event scheduled for 'stack' when the request completes */
+
+	int write;
+	int bank;  /* Bank index in the channel, including the rank */
+	int row;
+	long long arrival_cycle;
+
+	struct dram_request_t *next;
+};
+
+struct dram_channel_t
+{
+	struct dram_t *dram;
+
+	/* Array of 'num_ranks * num_banks' banks */
+	struct dram_bank_t *banks;
+
+	/* Queue of requests, in arrival order */
+	struct dram_request_t *queue_head;
+	struct dram_request_t *queue_tail;
+	int queue_count;
+	int queue_max;
+
+	long long bus_ready_cycle;  /* Cycle when the data bus is free */
+	long long next_refresh_cycle;
+	long long last_issue_cycle;  /* One command issued per cycle */
+	long long schedule_cycle;  /* Cycle of next EV_DRAM_SCHEDULE, or -1 */
+};
+
+struct dram_t
+{
+	char *name;
+
+	/* Organization. Consecutive blocks are placed in the same row, and
+	 * consecutive rows in different channels, banks, and ranks. */
+	int num_channels;
+	int num_ranks;
+	int num_banks;
+	int row_size;
+	int log_block_size;
+	int blocks_per_row;
+
+	/* Block numbers are divided by this value before being mapped, as done
+	 * by modules serving an interleaved address range. */
+	int block_div;
+
+	enum dram_page_policy_t page_policy;
+	enum dram_scheduler_t scheduler;
+
+	/* Timing parameters in cycles */
+	int t_cas;  /* Column access (row buffer hit) */
+	int t_rcd;  /* Row activation */
+	int t_rp;  /* Precharge */
+	int t_ras;  /* Minimum time between activation and precharge */
+	int t_burst;  /* Data transfer of a block */
+	int t_refi;  /* Refresh interval (0 = no refresh) */
+	int t_rfc;  /* Refresh duration */
+
+	struct dram_channel_t *channels;
+	struct repos_t *request_repos;
+
+	/* Statistics */
+	long long accesses;
+	long long reads;
+	long long writes;
+	long long row_hits;
+	long long row_misses;  /* Bank was precharged */
+	long long row_conflicts;  /* Other row was open */
+	long long refreshes;
+	long long total_latency;
+};
+
+struct dram_t *dram_create(char *name, int block_size, int num_channels,
+	int num_ranks, int num_banks, int row_size);
+void dram_free(struct dram_t *dram);
+
+void dram_access(struct dram_t *dram, uint32_t addr, int write, int delay,
+	int event, struct mod_stack_t *stack);
+void dram_handler(int event, void *data);
+
+void dram_dump_report(struct dram_t *dram, FILE *f);
+
+
+
+
 /*
  * Memory Management Unit
  */
@@ -188,21 +434,122 @@ enum mmu_access_t
 	mmu_access_execute
 };
 
+extern struct string_map_t mmu_placement_map;
+
+/* NUMA placement of pages touched for the first time */
+enum mmu_placement_t
+{
+	mmu_placement_invalid = 0,
+	mmu_placement_sequential,  /* Ascending physical addresses */
+	mmu_placement_interleaved,  /* Round-robin on virtual page numbers */
+	mmu_placement_first_touch  /* Local memory of first thread accessing */
+};
+
 extern char *mmu_report_file_name;
 
 extern uint32_t mmu_page_size;
 extern uint32_t mmu_page_mask;
 extern uint32_t mmu_log_page_size;
 
+extern int mmu_huge_pages;
+extern int mmu_page_colors;
+extern enum mmu_placement_t mmu_placement;
+
+/* A huge page is mapped by one entry of the page directory */
+extern uint32_t mmu_log_huge_page_size;
+
+struct mod_t;
+
 void mmu_init(void);
 void mmu_done(void);
 void mmu_dump_report(void);
 
-uint32_t mmu_translate(int mid, uint32_t vtl_addr);
+uint32_t mmu_translate(int mid, uint32_t vtl_addr, struct mod_t *local_mem);
 int mmu_valid_phy_addr(uint32_t phy_addr);
 
 void mmu_access_page(uint32_t phy_addr, enum mmu_access_t access);
 
+/* Page walks read one page table entry per level */
+#define MMU_PAGE_WALK_LEVELS  2
+
+uint32_t mmu_page_walk_addr(int mid, uint32_t vtl_addr, int level);
+
+
+
+
+/*
+ * TLB
+ */
+
+extern int EV_TLB_MISS;
+extern int EV_TLB_LOOKUP;
+extern int EV_TLB_WALK;
+
+struct tlb_entry_t
+{
+	int mid;  /* Memory map ID, or -1 if invalid */
+	uint32_t vpn;  /* Virtual page number */
+	long long stamp;  /* Time of last access, for LRU replacement */
+	int retry;  /* Filled by a miss, and not accessed yet */
+};
+
+/* Miss in flight, walking down the TLB levels and the page table */
+struct tlb_miss_t
+{
+	struct tlb_t *tlb;  /* TLB where the miss started */
+	struct tlb_t *level;  /* TLB being looked up */
+	struct mod_t *mod;  /* Module used for page walks */
+
+	int mid;
+	uint32_t vpn;
+	int walk_level;  /* Next page table level to read */
+	long long start_cycle;
+
+	/* In-flight misses of 'tlb' */
+	struct tlb_miss_t *miss_list_prev;
+	struct tlb_miss_t *miss_list_next;
+};
+
+struct tlb_t
+{
+	char *name;
+
+	int num_sets;
+	int assoc;
+	int latency;
+	int mshr_size;
+
+	/* Lower-level TLB, or NULL if a miss starts a page walk */
+	struct tlb_t *next;
+
+	struct tlb_entry_t *entries;
+	long long stamp;
+
+	/* In-flight misses started in this TLB */
+	struct tlb_miss_t *miss_list_head;
+	struct tlb_miss_t *miss_list_tail;
+	int miss_list_count;
+	int miss_list_max;
+
+	/* Statistics */
+	long long hits;
+	long long misses;
+	long long walks;
+	long long filled_misses;
+	long long miss_latency;
+};
+
+struct tlb_t *tlb_create(char *name, int num_sets, int assoc, int latency,
+	int mshr_size);
+void tlb_free(struct tlb_t *tlb);
+
+int tlb_probe(struct tlb_t *tlb, int mid, uint32_t vtl_addr);
+int tlb_access(struct tlb_t *tlb, struct mod_t *mod, int mid, uint32_t vtl_addr);
+void tlb_access_atomic(struct tlb_t *tlb, struct mod_t *mod, int mid, uint32_t vtl_addr);
+void tlb_handler(int event, void *data);
+
+void tlb_dump_report(struct tlb_t *tlb, FILE *f);
+
 
 
 
@@ -210,6 +557,19 @@ void mmu_access_page(uint32_t phy_addr, enum mmu_access_t access);
  * Memory Module
  */
 
+extern struct string_map_t mod_inclusion_map;
+
+/* Function selecting the bank of an address */
+enum mod_bank_select_t
+{
+	mod_bank_select_invalid = 0,
+	mod_bank_select_block,  /* Consecutive blocks in consecutive banks */
+	mod_bank_select_word,  /* Consecutive 4-byte words in consecutive banks */
+	mod_bank_select_xor  /* Block address bits XOR-folded into the bank index */
+};
+
+extern struct string_map_t mod_bank_select_map;
+
 /* Port */
 struct mod_port_t
 {
@@ -225,6 +585,23 @@ struct mod_port_t
 	int waiting_list_max;
 };
 
+/* Bank. Each bank has its own ports, which can only be used by accesses to
+ * addresses mapped to the bank. */
+struct mod_bank_t
+{
+	/* Ports locked */
+	int num_locked_ports;
+
+	/* Accesses waiting to get a port of the bank */
+	struct mod_stack_t *port_waiting_list_head;
+	struct mod_stack_t *port_waiting_list_tail;
+	int port_waiting_list_count;
+	int port_waiting_list_max;
+
+	/* Accesses that locked a port of the bank */
+	long long accesses;
+};
+
 /* Access type */
 enum mod_access_kind_t
 {
@@ -250,6 +627,18 @@ enum mod_range_kind_t
 	mod_range_interleaved
 };
 
+/* Inclusion policy of a cache with respect to its upper-level caches. Tags
+ * are always inclusive, since they hold the directory entries of the blocks
+ * in upper levels, but non-inclusive and exclusive caches have more ways of
+ * tags than data frames, and keep blocks held by upper levels without data. */
+enum mod_inclusion_t
+{
+	mod_inclusion_invalid = 0,
+	mod_inclusion_inclusive,
+	mod_inclusion_non_inclusive,  /* Blocks keep data unless a frame is needed */
+	mod_inclusion_exclusive  /* Blocks owned by an upper level drop their data */
+};
+
 /* Type of entry memory system */
 enum mod_entry_kind_t
 {
@@ -258,7 +647,16 @@ enum mod_entry_kind_t
 	mod_entry_gpu
 };
 
-#define MOD_ACCESS_HASH_TABLE_SIZE  17
+/* Entry of the table of in-flight accesses of a module, holding the list
+ * of in-flight accesses to one block. The entry is free if the list is empty. */
+struct mod_access_table_entry_t
+{
+	uint32_t block;
+	struct mod_stack_t *bucket_list_head;
+	struct mod_stack_t *bucket_list_tail;
+	int bucket_list_count;
+	int bucket_list_max;
+};
 
 /* Memory module */
 struct mod_t
@@ -270,6 +668,7 @@ struct mod_t
 	int log_block_size;
 	int latency;
 	int mshr_size;
+	enum mod_inclusion_t inclusion;
 
 	/* Module level starting from entry points */
 	int level;
@@ -294,22 +693,25 @@ struct mod_t
 		} interleaved;
 	} range;
 
-	/* Ports */
+	/* Ports. There are 'bank_ports' ports per bank, and the ports of bank 'i'
+	 * are those starting at index 'i * bank_ports'. */
 	struct mod_port_t *ports;
 	int num_ports;
 	int num_locked_ports;
+	int bank_ports;
 
-	/* Accesses waiting to get a port */
-	struct mod_stack_t *port_waiting_list_head;
-	struct mod_stack_t *port_waiting_list_tail;
-	int port_waiting_list_count;
-	int port_waiting_list_max;
+	/* Banks */
+	struct mod_bank_t *banks;
+	int num_banks;
+	int log_num_banks;
+	enum mod_bank_select_t bank_select;
 
 	/* Directory */
 	struct dir_t *dir;
 	int dir_size;
 	int dir_assoc;
 	int dir_num_sets;
+	int dir_num_pointers;  /* Sharer pointers per entry (0 = full-map directory) */
 
 	/* Waiting list of events */
 	struct mod_stack_t *waiting_list_head;
@@ -320,6 +722,16 @@ struct mod_t
 	/* Cache structure */
 	struct cache_t *cache;
 
+	/* Stack distance analysis of accesses to the module, or NULL */
+	struct sdist_t *sdist;
+
+	/* DRAM timing model of a main memory module, or NULL if the main
+	 * memory has a fixed latency */
+	struct dram_t *dram;
+
+	/* Hardware prefetcher of a cache module, or NULL */
+	struct prefetcher_t *prefetcher;
+
 	/* Low and high memory modules */
 	struct linked_list_t *high_mod_list;
 	struct linked_list_t *low_mod_list;
@@ -351,14 +763,19 @@ struct mod_t
 	 * between 0 and 'access_list_count' at all times. */
 	int access_list_coalesced_count;
 
-	/* Hash table of accesses */
-	struct
-	{
-		struct mod_stack_t *bucket_list_head;
-		struct mod_stack_t *bucket_list_tail;
-		int bucket_list_count;
-		int bucket_list_max;
-	} access_hash_table[MOD_ACCESS_HASH_TABLE_SIZE];
+	/* Repository of access stacks created for this module */
+	struct repos_t *stack_repos;
+
+	/* Table of in-flight accesses, indexed by block with open addressing
+	 * and linear probing. Its size is a power of two, initially given by the
+	 * MSHR size, and it doubles whenever it becomes half full. The longest
+	 * sequence of entries probed to insert an access is recorded as its
+	 * maximum chain length. */
+	struct mod_access_table_entry_t *access_table;
+	int access_table_size;
+	int log_access_table_size;
+	int access_table_count;  /* Entries in use */
+	int access_table_max_chain;
 
 	/* For coloring algorithm used to check collisions between CPU and GPU
 	 * memory hierarchies. Remove when fused. */
@@ -375,6 +792,23 @@ struct mod_t
 	long long effective_writes;
 	long long effective_write_hits;
 	long long evictions;
+	long long inclusion_victims;  /* Evictions invalidating upper-level copies */
+
+	/* Non-inclusive caches */
+	long long victim_fills;  /* Data brought by evictions from upper levels */
+	long long data_drops;  /* Data dropped from blocks kept in the directory */
+	long long data_evictions;  /* Data evicted from blocks kept in the directory */
+
+	/* Sectored caches */
+	long long sector_misses;
+	long long sector_fills;
+	long long sector_writebacks;
+	long long sector_evicted_blocks;
+	long long sector_evicted_valid;  /* Valid sectors in evicted blocks */
+
+	/* Banked caches */
+	long long bank_conflicts;  /* Waits for a port with free ports in other banks */
+	long long bank_wait_cycles;
 
 	long long blocking_reads;
 	long long non_blocking_reads;
@@ -392,21 +826,49 @@ struct mod_t
 	long long no_retry_read_hits;
 	long long no_retry_writes;
 	long long no_retry_write_hits;
+
+	/* Statistics for accesses in atomic mode */
+	long long atomic_accesses;
+	long long atomic_hits;
+	long long atomic_evictions;
+	long long atomic_entry_accesses;
+	long long atomic_latency;
 };
 
-struct mod_t *mod_create(char *name, enum mod_kind_t kind, int num_ports,
-	int block_size, int latency);
+struct mod_t *mod_create(char *name, enum mod_kind_t kind, int num_banks,
+	int num_ports, int block_size, int latency);
 void mod_free(struct mod_t *mod);
 void mod_dump(struct mod_t *mod, FILE *f);
 
 long long mod_access(struct mod_t *mod, enum mod_entry_kind_t entry_kind,
-	enum mod_access_kind_t access_kind, uint32_t addr, int *witness_ptr,
-	struct linked_list_t *event_queue, void *event_queue_item);
+	enum mod_access_kind_t access_kind, uint32_t addr, uint32_t eip,
+	int *witness_ptr, struct linked_list_t *event_queue, void *event_queue_item);
 int mod_can_access(struct mod_t *mod, uint32_t addr);
+int mod_serves_address(struct mod_t *mod, uint32_t addr);
 
 int mod_find_block(struct mod_t *mod, uint32_t addr, uint32_t *set_ptr,
 	uint32_t *way_ptr, uint32_t *tag_ptr, int *state_ptr);
-
+uint32_t mod_replace_block(struct mod_t *mod, uint32_t set);
+
+int mod_has_data(struct mod_t *mod, uint32_t addr);
+int mod_owner_has_data(struct mod_t *mod, uint32_t set, uint32_t way);
+int mod_find_data_frame(struct mod_t *mod, uint32_t set, uint32_t way, int hit,
+	int *victim_ptr);
+void mod_reserve_data(struct mod_t *mod, uint32_t set, uint32_t way);
+int mod_fill_data(struct mod_t *mod, uint32_t set, uint32_t way);
+void mod_drop_data(struct mod_t *mod, uint32_t set, uint32_t way);
+
+uint32_t mod_get_sectors(struct mod_t *mod, uint32_t addr, int size);
+uint32_t mod_get_request_sectors(struct mod_t *mod, struct mod_t *requester,
+	uint32_t addr, uint32_t sectors);
+int mod_get_sectors_size(struct mod_t *mod, uint32_t sectors);
+void mod_fill_sectors(struct mod_t *mod, uint32_t set, uint32_t way,
+	uint32_t sectors, int dirty);
+uint32_t mod_get_writeback_sectors(struct mod_t *mod, uint32_t set, uint32_t way);
+void mod_evict_sectors(struct mod_t *mod, uint32_t set, uint32_t way);
+
+int mod_get_bank(struct mod_t *mod, uint32_t addr);
+int mod_bank_has_free_port(struct mod_t *mod, int bank);
 void mod_lock_port(struct mod_t *mod, struct mod_stack_t *stack, int event);
 void mod_unlock_port(struct mod_t *mod, struct mod_port_t *port,
 	struct mod_stack_t *stack);
@@ -418,6 +880,7 @@ void mod_access_finish(struct mod_t *mod, struct mod_stack_t *stack);
 int mod_in_flight_access(struct mod_t *mod, long long id, uint32_t addr);
 struct mod_stack_t *mod_in_flight_address(struct mod_t *mod, uint32_t addr,
 	struct mod_stack_t *older_than_stack);
+struct mod_stack_t *mod_in_flight_block(struct mod_t *mod, uint32_t addr);
 struct mod_stack_t *mod_in_flight_write(struct mod_t *mod,
 	struct mod_stack_t *older_than_stack);
 
@@ -431,6 +894,9 @@ struct mod_stack_t *mod_can_coalesce(struct mod_t *mod,
 void mod_coalesce(struct mod_t *mod, struct mod_stack_t *master_stack,
 	struct mod_stack_t *stack);
 
+int mod_access_atomic(struct mod_t *mod, enum mod_access_kind_t access_kind,
+	uint32_t addr);
+
 
 
 
@@ -527,6 +993,13 @@ extern int EV_MOD_PEER_RECEIVE;
 extern int EV_MOD_PEER_REPLY_ACK;
 extern int EV_MOD_PEER_FINISH;
 
+extern int EV_MOD_SECTOR_FILL;
+extern int EV_MOD_SECTOR_FILL_RECEIVE;
+extern int EV_MOD_SECTOR_FILL_ACTION;
+extern int EV_MOD_SECTOR_FILL_MISS;
+extern int EV_MOD_SECTOR_FILL_REPLY;
+extern int EV_MOD_SECTOR_FILL_FINISH;
+
 
 /* Current identifier for stack */
 extern long long mod_stack_id;
@@ -572,15 +1045,27 @@ struct mod_stack_t
 	uint32_t way;
 	int state;
 
+	/* Address of the instruction that caused the access, or 0 */
+	uint32_t eip;
+
 	uint32_t src_set;
 	uint32_t src_way;
 	uint32_t src_tag;
 
+	/* Block of a non-inclusive cache whose data frame is taken by the
+	 * access, locked while its data is evicted */
+	uint32_t data_way;
+
 	enum mod_request_dir_t request_dir;
 	int reply_size;
 	int reply;
 	int pending;
 
+	/* Sectors needed by the access, as a mask of the sectors of the block of
+	 * 'mod'. For read requests, write requests, and sector fills, 'mod' is the
+	 * requester. A mask of 0 stands for the whole block. */
+	uint32_t sectors;
+
 	/* Linked list of accesses in 'mod' */
 	struct mod_stack_t *access_list_prev;
 	struct mod_stack_t *access_list_next;
@@ -589,7 +1074,8 @@ struct mod_stack_t
 	struct mod_stack_t *write_access_list_prev;
 	struct mod_stack_t *write_access_list_next;
 
-	/* Bucket list of accesses in hash table in 'mod' */
+	/* List of accesses to the same block in the table of in-flight
+	 * accesses of 'mod' */
 	struct mod_stack_t *bucket_list_prev;
 	struct mod_stack_t *bucket_list_next;
 
@@ -604,6 +1090,12 @@ struct mod_stack_t
 	int retry : 1;
 	int coalesced : 1;
 	int port_locked : 1;
+	int prefetch : 1;
+	int prefetch_late : 1;  /* Prefetch that a demand access is waiting for */
+	int sector_miss : 1;  /* Block present, but missing the accessed sector */
+	int port_waiting : 1;  /* Waiting for a port of its bank since 'port_wait_when' */
+	int data_eviction : 1;  /* Data of the block at 'data_way' evicted to free a frame */
+	int data_only : 1;  /* Eviction of the data of a block, which stays present */
 
 	/* Message sent through interconnect */
 	struct net_msg_t *msg;
@@ -614,6 +1106,7 @@ struct mod_stack_t
 	struct mod_stack_t *waiting_list_next;
 
 	/* Waiting list for locking a port. */
+	long long port_wait_when;
 	int port_waiting_list_event;
 	struct mod_stack_t *port_waiting_list_prev;
 	struct mod_stack_t *port_waiting_list_next;
@@ -670,6 +1163,83 @@ void mod_handler_write_request(int event, void *data);
 void mod_handler_read_request(int event, void *data);
 void mod_handler_invalidate(int event, void *data);
 void mod_handler_peer(int event, void *data);
+void mod_handler_sector_fill(int event, void *data);
+
+
+
+
+/*
+ * Prefetcher
+ */
+
+extern struct string_map_t prefetcher_kind_map;
+
+enum prefetcher_kind_t
+{
+	prefetcher_kind_invalid = 0,
+	prefetcher_kind_next_line,
+	prefetcher_kind_stride,
+	prefetcher_kind_stream
+};
+
+/* Entry of the table of a stride prefetcher, indexed by instruction address */
+struct prefetcher_stride_entry_t
+{
+	uint32_t eip;
+	uint32_t last_addr;
+	int stride;
+	int confidence;
+};
+
+/* Stream tracked by a stream prefetcher */
+struct prefetcher_stream_t
+{
+	int valid;
+	uint32_t last_block;
+	int dir;  /* 1 = ascending, -1 = descending, 0 = unknown */
+	int confidence;
+	long long last_use;
+};
+
+struct prefetcher_t
+{
+	char *name;
+	enum prefetcher_kind_t kind;
+	int log_block_size;
+
+	/* Maximum number of blocks prefetched for each trigger access */
+	int degree;
+
+	/* For stream prefetchers, number of blocks that prefetches are kept
+	 * ahead of the accesses of a stream. */
+	int distance;
+
+	/* Table of instructions (stride) or streams (stream) */
+	int table_size;
+	struct prefetcher_stride_entry_t *stride_table;
+	struct prefetcher_stream_t *streams;
+	long long stream_clock;
+
+	/* One flag per cache block, set for blocks brought by a prefetch that
+	 * were not accessed yet. Indexed with CACHE_BLOCK_INDEX. */
+	unsigned char *prefetched;
+
+	/* Statistics */
+	long long issued;
+	long long dropped;  /* No free port or MSHR */
+	long long useful;  /* Accessed after the prefetch completed */
+	long long late;  /* Accessed while the prefetch was in flight */
+	long long useless;  /* Replaced before being accessed */
+};
+
+struct prefetcher_t *prefetcher_create(char *name, enum prefetcher_kind_t kind,
+	int block_size, int num_blocks, int table_size);
+void prefetcher_free(struct prefetcher_t *prefetcher);
+
+void prefetcher_access(struct mod_t *mod, struct mod_stack_t *stack);
+void prefetcher_check_late(struct mod_t *mod, struct mod_stack_t *stack);
+
+void prefetcher_dump_report(struct prefetcher_t *prefetcher, FILE *f);
 
 
 
@@ -694,9 +1264,14 @@ extern int mem_trace_category;
 
 struct mem_system_t
 {
-	/* List of modules and networks */
+	/* List of modules, networks, and TLBs */
 	struct list_t *mod_list;
 	struct list_t *net_list;
+	struct list_t *tlb_list;
+
+	/* Main memory modules accessible from CPU entries, which are the NUMA
+	 * nodes where the MMU places pages */
+	struct list_t *node_list;
 };
 
 extern struct mem_system_t *mem_system;
@@ -31,6 +31,22 @@ uint32_t mmu_page_size = 1 << 12;  /* 4KB default page size */
 uint32_t mmu_log_page_size;
 uint32_t mmu_page_mask;
 
+/* Physical page allocation */
+int mmu_huge_pages;
+int mmu_page_colors = 1;
+enum mmu_placement_t mmu_placement = mmu_placement_sequential;
+
+uint32_t mmu_log_huge_page_size;
+
+struct string_map_t mmu_placement_map =
+{
+	3, {
+		{ "Sequential", mmu_placement_sequential },
+		{ "Interleaved", mmu_placement_interleaved },
+		{ "FirstTouch", mmu_placement_first_touch }
+	}
+};
+
 
 
 
@@ -39,15 +55,13 @@ uint32_t mmu_page_mask;
  */
 
 /* Local constants */
-#define MMU_PAGE_HASH_SIZE  (1 << 10)
 #define MMU_PAGE_LIST_SIZE  (1 << 10)
+#define MMU_PTE_SIZE  4
 
 /* Physical memory page */
 struct mmu_page_t
 {
-	struct mmu_page_t *next;
-
-	int mid;  /* Memory map ID */
+	int mid;  /* Memory map ID, or -1 for page tables */
 	uint32_t vtl_addr;  /* Virtual address of page */
 	uint32_t phy_addr;  /* Physical address */
 
@@ -57,14 +71,42 @@ struct mmu_page_t
 	long long num_execute_accesses;
 };
 
+/* Page table of a memory map. Virtual page numbers are split into a directory
+ * index ('dir_bits' upper bits) and a table index ('table_bits' lower bits).
+ * Tables are given physical pages when they are first walked by a TLB. With
+ * huge pages, each directory entry maps one huge page instead, whose physical
+ * pages are assigned to the table when its first page is touched. */
+struct mmu_table_t
+{
+	struct mmu_page_t *page;  /* Physical page holding the table, or NULL */
+	int huge_page_valid;
+	uint32_t huge_page;  /* First physical page number of the huge page */
+	void *entry[0];  /* Tables in a directory, or pages in a table */
+};
+
 /* Memory management unit */
 struct mmu_t
 {
-	/* List of pages */
+	/* List of pages, indexed by physical page number */
 	struct list_t *page_list;
 
-	/* Hash table of pages */
-	struct mmu_page_t *page_hash_table[MMU_PAGE_HASH_SIZE];
+	/* Page directories, indexed by memory map ID */
+	struct list_t *dir_list;
+
+	/* Page table geometry */
+	int dir_bits;
+	int table_bits;
+	uint32_t table_mask;
+
+	/* Physical pages already allocated, one bit per physical page */
+	unsigned char *phy_page_taken;
+	uint32_t num_phy_pages;
+
+	/* Next physical page number to check when allocating single pages, for
+	 * each NUMA node and color, and when allocating huge pages or groups of
+	 * pages, for each NUMA node. The last node stands for no preference. */
+	uint32_t *page_cursor;
+	uint32_t *group_cursor;
 
 	/* Report file */
 	FILE *report_file;
@@ -79,53 +121,211 @@ static struct mmu_t *mmu;
  * Private Functions
  */
 
-static struct mmu_page_t *mmu_get_page(int mid, uint32_t vtladdr)
+/* Return true if physical page 'index' is free, and served by main memory
+ * module 'node', if not NULL. */
+static int mmu_phy_page_free(uint32_t index, struct mod_t *node)
 {
-	struct mmu_page_t *prev, *page;
-	uint32_t tag;
-	int index;
+	if (mmu->phy_page_taken[index >> 3] & (1 << (index & 7)))
+		return 0;
+	return !node || mod_serves_address(node, index << mmu_log_page_size);
+}
 
-	/* Look for page */
-	index = ((vtladdr >> mmu_log_page_size) + mid * 23) % MMU_PAGE_HASH_SIZE;
-	tag = vtladdr & ~mmu_page_mask;
-	prev = NULL;
-	page = mmu->page_hash_table[index];
-	while (page)
+
+/* Allocate 'count' consecutive physical pages, aligned to 'count', in NUMA node
+ * 'node' (NULL for any), or in any node if 'node' is full. Single pages are
+ * also given color 'color', that is, their physical page number modulo the
+ * number of colors. Return the first physical page number. */
+static uint32_t mmu_phy_page_alloc(int count, int color, struct mod_t *node)
+{
+	uint32_t *cursor;
+	uint32_t index;
+	int node_index;
+	int step;
+	int i;
+
+	/* Cursor */
+	node_index = node ? list_index_of(mem_system->node_list, node) :
+		list_count(mem_system->node_list);
+	assert(node_index >= 0);
+	if (count == 1)
+	{
+		cursor = &mmu->page_cursor[node_index * mmu_page_colors + color];
+		if (*cursor % mmu_page_colors != color)
+			*cursor += (color - *cursor % mmu_page_colors + mmu_page_colors)
+				% mmu_page_colors;
+		step = mmu_page_colors;
+	}
+	else
+	{
+		cursor = &mmu->group_cursor[node_index];
+		*cursor = (*cursor + count - 1) / count * count;
+		step = count;
+	}
+
+	/* Find free pages */
+	for (index = *cursor; index <= mmu->num_phy_pages - count; index += step)
 	{
-		if (page->vtl_addr == tag && page->mid == mid)
+		if (!mmu_phy_page_free(index, node))
+			continue;
+		for (i = 1; i < count; i++)
+			if (!mmu_phy_page_free(index + i, NULL))
+				break;
+		if (i == count)
 			break;
-		prev = page;
-		page = page->next;
 	}
-	
-	/* Not found */
+
+	/* If the node is full, fall back to any other */
+	if (index > mmu->num_phy_pages - count)
+	{
+		if (!node)
+			fatal("%s: out of physical memory", __FUNCTION__);
+		*cursor = index;
+		return mmu_phy_page_alloc(count, color, NULL);
+	}
+
+	/* Allocate */
+	for (i = 0; i < count; i++)
+		mmu->phy_page_taken[(index + i) >> 3] |= 1 << ((index + i) & 7);
+	*cursor = index + step;
+	return index;
+}
+
+
+/* Return the NUMA node where a page touched for the first time is placed, for
+ * virtual page number 'vpn', and a thread local to 'local_mem'. */
+static struct mod_t *mmu_placement_node(uint32_t vpn, struct mod_t *local_mem)
+{
+	if (!list_count(mem_system->node_list))
+		return NULL;
+	switch (mmu_placement)
+	{
+	case mmu_placement_interleaved:
+		return list_get(mem_system->node_list,
+			vpn % list_count(mem_system->node_list));
+
+	case mmu_placement_first_touch:
+		return local_mem;
+
+	default:
+		return NULL;
+	}
+}
+
+
+/* Create a page for memory map 'mid' mapped at physical page number 'index' */
+static struct mmu_page_t *mmu_page_create(int mid, uint32_t vtl_addr, uint32_t index)
+{
+	struct mmu_page_t *page;
+
+	/* Create page */
+	page = calloc(1, sizeof(struct mmu_page_t));
 	if (!page)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Initialize */
+	page->vtl_addr = vtl_addr;
+	page->mid = mid;
+	page->phy_addr = index << mmu_log_page_size;
+
+	/* Insert in page list */
+	while (list_count(mmu->page_list) <= index)
+		list_add(mmu->page_list, NULL);
+	list_set(mmu->page_list, index, page);
+	return page;
+}
+
+
+static struct mmu_table_t *mmu_table_create(int bits)
+{
+	struct mmu_table_t *table;
+
+	table = calloc(1, sizeof(struct mmu_table_t) + (sizeof(void *) << bits));
+	if (!table)
+		fatal("%s: out of memory", __FUNCTION__);
+	return table;
+}
+
+
+/* Return the page directory of memory map 'mid', creating it if needed. */
+static struct mmu_table_t *mmu_get_dir(int mid)
+{
+	struct mmu_table_t *dir;
+
+	dir = list_get(mmu->dir_list, mid);
+	if (dir)
+		return dir;
+
+	/* Create directory */
+	assert(mid >= 0);
+	while (list_count(mmu->dir_list) <= mid)
+		list_add(mmu->dir_list, NULL);
+	dir = mmu_table_create(mmu->dir_bits);
+	list_set(mmu->dir_list, mid, dir);
+	return dir;
+}
+
+
+/* Return the page table containing the entry for 'vtl_addr' in memory map
+ * 'mid', creating it if needed. */
+static struct mmu_table_t *mmu_get_table(int mid, uint32_t vtl_addr)
+{
+	struct mmu_table_t *dir;
+	struct mmu_table_t *table;
+	uint32_t index;
+
+	dir = mmu_get_dir(mid);
+	index = (vtl_addr >> mmu_log_page_size) >> mmu->table_bits;
+	table = dir->entry[index];
+	if (!table)
 	{
-		/* Create page */
-		page = calloc(1, sizeof(struct mmu_page_t));
-		if (!page)
-			fatal("%s: out of memory", __FUNCTION__);
-
-		/* Initialize */
-		page->vtl_addr = tag;
-		page->mid = mid;
-		page->phy_addr = list_count(mmu->page_list) << mmu_log_page_size;
-
-		/* Insert in page list */
-		list_add(mmu->page_list, page);
-
-		/* Insert in page hash table */
-		page->next = mmu->page_hash_table[index];
-		mmu->page_hash_table[index] = page;
-		prev = NULL;
+		table = mmu_table_create(mmu->table_bits);
+		dir->entry[index] = table;
 	}
-	
-	/* Locate page at the head of the hash table for faster subsequent lookup */
-	if (prev)
+	return table;
+}
+
+
+static struct mmu_page_t *mmu_get_page(int mid, uint32_t vtladdr,
+	struct mod_t *local_mem)
+{
+	struct mmu_table_t *table;
+	struct mmu_page_t *page;
+	struct mod_t *node;
+
+	uint32_t vpn;
+	uint32_t index;
+	uint32_t phy_index;
+
+	/* Look for page */
+	table = mmu_get_table(mid, vtladdr);
+	vpn = vtladdr >> mmu_log_page_size;
+	index = vpn & mmu->table_mask;
+	page = table->entry[index];
+
+	/* Not found */
+	if (!page)
 	{
-		prev->next = page->next;
-		page->next = mmu->page_hash_table[index];
-		mmu->page_hash_table[index] = page;
+		/* Physical page, in the huge page of the table or on its own */
+		if (mmu_huge_pages)
+		{
+			if (!table->huge_page_valid)
+			{
+				node = mmu_placement_node(vpn >> mmu->table_bits, local_mem);
+				table->huge_page = mmu_phy_page_alloc(1 << mmu->table_bits,
+					0, node);
+				table->huge_page_valid = 1;
+			}
+			phy_index = table->huge_page + index;
+		}
+		else
+		{
+			node = mmu_placement_node(vpn, local_mem);
+			phy_index = mmu_phy_page_alloc(1, vpn % mmu_page_colors, node);
+		}
+
+		/* Create page */
+		page = mmu_page_create(mid, vtladdr & ~mmu_page_mask, phy_index);
+		table->entry[index] = page;
 	}
 
 	/* Return it */
@@ -133,6 +333,20 @@ static struct mmu_page_t *mmu_get_page(int mid, uint32_t vtladdr)
 }
 
 
+/* Free a directory or table, and the tables it points to if it is a
+ * directory. Pages are freed separately. */
+static void mmu_table_free(struct mmu_table_t *table, int bits, int is_dir)
+{
+	int i;
+
+	if (is_dir)
+		for (i = 0; i < 1 << bits; i++)
+			if (table->entry[i])
+				mmu_table_free(table->entry[i], mmu->table_bits, 0);
+	free(table);
+}
+
+
 /* Compare two pages */
 static int mmu_page_compare(const void *ptr1, const void *ptr2)
 {
@@ -174,6 +388,25 @@ void mmu_init()
 
 	/* Initialize */
 	mmu->page_list = list_create_with_size(MMU_PAGE_LIST_SIZE);
+	mmu->dir_list = list_create();
+
+	/* Page table geometry. A table fits in one page, unless the virtual page
+	 * number has fewer bits. */
+	mmu->table_bits = MIN(mmu_log_page_size - log_base2(MMU_PTE_SIZE),
+		32 - mmu_log_page_size);
+	mmu->dir_bits = 32 - mmu_log_page_size - mmu->table_bits;
+	mmu->table_mask = (1 << mmu->table_bits) - 1;
+	mmu_log_huge_page_size = mmu_log_page_size + mmu->table_bits;
+
+	/* Physical page allocation */
+	mmu->num_phy_pages = 1ULL << (32 - mmu_log_page_size);
+	mmu->phy_page_taken = calloc((mmu->num_phy_pages + 7) / 8, 1);
+	mmu->page_cursor = calloc((list_count(mem_system->node_list) + 1) *
+		mmu_page_colors, sizeof(uint32_t));
+	mmu->group_cursor = calloc(list_count(mem_system->node_list) + 1,
+		sizeof(uint32_t));
+	if (!mmu->phy_page_taken || !mmu->page_cursor || !mmu->group_cursor)
+		fatal("%s: out of memory", __FUNCTION__);
 
 	/* Open report file */
 	if (*mmu_report_file_name)
@@ -192,10 +425,19 @@ void mmu_done()
 	/* Dump report */
 	mmu_dump_report();
 
+	/* Free page tables */
+	for (i = 0; i < list_count(mmu->dir_list); i++)
+		if (list_get(mmu->dir_list, i))
+			mmu_table_free(list_get(mmu->dir_list, i), mmu->dir_bits, 1);
+	list_free(mmu->dir_list);
+
 	/* Free pages */
 	for (i = 0; i < list_count(mmu->page_list); i++)
 		free(list_get(mmu->page_list, i));
 	list_free(mmu->page_list);
+	free(mmu->phy_page_taken);
+	free(mmu->page_cursor);
+	free(mmu->group_cursor);
 
 	/* Free MMU */
 	free(mmu);
@@ -205,6 +447,7 @@ void mmu_done()
 void mmu_dump_report(void)
 {
 	struct mmu_page_t *page;
+	struct list_t *page_list;
 
 	FILE *f;
 	int i;
@@ -216,8 +459,12 @@ void mmu_dump_report(void)
 	if (!f)
 		return;
 
-	/* Sort list of pages it as per access count */
-	list_sort(mmu->page_list, mmu_page_compare);
+	/* Sort list of allocated pages it as per access count */
+	page_list = list_create_with_size(MMU_PAGE_LIST_SIZE);
+	for (i = 0; i < list_count(mmu->page_list); i++)
+		if (list_get(mmu->page_list, i))
+			list_add(page_list, list_get(mmu->page_list, i));
+	list_sort(page_list, mmu_page_compare);
 
 	/* Header */
 	fprintf(f, "%5s %5s %9s %9s %10s %10s %10s %10s\n", "Idx", "MemID", "VtlAddr",
@@ -227,9 +474,9 @@ void mmu_dump_report(void)
 	fprintf(f, "\n");
 
 	/* Dump */
-	for (i = 0; i < list_count(mmu->page_list); i++)
+	for (i = 0; i < list_count(page_list); i++)
 	{
-		page = list_get(mmu->page_list, i);
+		page = list_get(page_list, i);
 		num_accesses = page->num_read_accesses + page->num_write_accesses
 			+ page->num_execute_accesses;
 		fprintf(f, "%5d %5d %9x %9x %10lld %10lld %10lld %10lld\n",
@@ -237,11 +484,15 @@ void mmu_dump_report(void)
 			page->num_read_accesses, page->num_write_accesses,
 			page->num_execute_accesses);
 	}
+	list_free(page_list);
 	fclose(f);
 }
 
 
-uint32_t mmu_translate(int mid, uint32_t vtl_addr)
+/* Return the physical address for 'vtl_addr' in memory map 'mid'. If the page is
+ * touched for the first time, it is allocated as per the placement policy, where
+ * 'local_mem' is the main memory module local to the accessing thread, or NULL. */
+uint32_t mmu_translate(int mid, uint32_t vtl_addr, struct mod_t *local_mem)
 {
 	struct mmu_page_t *page;
 
@@ -249,19 +500,59 @@ uint32_t mmu_translate(int mid, uint32_t vtl_addr)
 	uint32_t phy_addr;
 
 	offset = vtl_addr & mmu_page_mask;
-	page = mmu_get_page(mid, vtl_addr);
+	page = mmu_get_page(mid, vtl_addr, local_mem);
 	assert(page);
 	phy_addr = page->phy_addr | offset;
 	return phy_addr;
 }
 
 
+/* Return the physical address of the page table entry read at 'level' of a
+ * page walk for 'vtl_addr' in memory map 'mid' (0 = directory, 1 = table). */
+uint32_t mmu_page_walk_addr(int mid, uint32_t vtl_addr, int level)
+{
+	struct mmu_table_t *table;
+	uint32_t index;
+	uint32_t phy_index;
+	int count;
+	int bits;
+	int i;
+
+	/* Directory or table */
+	index = vtl_addr >> mmu_log_page_size;
+	if (level == 0)
+	{
+		table = mmu_get_dir(mid);
+		index >>= mmu->table_bits;
+		bits = mmu->dir_bits;
+	}
+	else
+	{
+		assert(level == MMU_PAGE_WALK_LEVELS - 1);
+		table = mmu_get_table(mid, vtl_addr);
+		index &= mmu->table_mask;
+		bits = mmu->table_bits;
+	}
+
+	/* Place table in consecutive physical pages */
+	if (!table->page)
+	{
+		count = MAX(1, (MMU_PTE_SIZE << bits) >> mmu_log_page_size);
+		phy_index = mmu_phy_page_alloc(count, 0, NULL);
+		for (i = 0; i < count; i++)
+			mmu_page_create(-1, 0, phy_index + i);
+		table->page = list_get(mmu->page_list, phy_index);
+	}
+	return table->page->phy_addr + index * MMU_PTE_SIZE;
+}
+
+
 int mmu_valid_phy_addr(uint32_t phy_addr)
 {
 	int index;
 
 	index = phy_addr >> mmu_log_page_size;
-	return index < mmu->page_list->count;
+	return list_get(mmu->page_list, index) != NULL;
 }
 
 
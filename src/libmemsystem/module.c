@@ -20,26 +20,120 @@
 #include <mem-system.h>
 
 
+struct string_map_t mod_inclusion_map =
+{
+	3, {
+		{ "Inclusive", mod_inclusion_inclusive },
+		{ "NonInclusive", mod_inclusion_non_inclusive },
+		{ "Exclusive", mod_inclusion_exclusive }
+	}
+};
+
+struct string_map_t mod_bank_select_map =
+{
+	3, {
+		{ "Block", mod_bank_select_block },
+		{ "Word", mod_bank_select_word },
+		{ "XOR", mod_bank_select_xor }
+	}
+};
+
+
+
+
 /*
  * Private Functions
  */
 
-static int mod_serves_address(struct mod_t *mod, uint32_t addr)
+/* Minimum number of entries of the table of in-flight accesses */
+#define MOD_ACCESS_TABLE_MIN_SIZE  16
+
+/* Home entry of 'block' in the table of in-flight accesses (Fibonacci hashing,
+ * so that blocks of interleaved modules are spread over the whole table) */
+static int mod_access_table_hash(struct mod_t *mod, uint32_t block)
 {
-	/* Address bounds */
-	if (mod->range_kind == mod_range_bounds)
-		return addr >= mod->range.bounds.low &&
-			addr <= mod->range.bounds.high;
+	return (uint32_t) (block * 2654435761u) >> (32 - mod->log_access_table_size);
+}
 
-	/* Interleaved addresses */
-	if (mod->range_kind == mod_range_interleaved)
-		return (addr / mod->range.interleaved.div) %
-			mod->range.interleaved.mod ==
-			mod->range.interleaved.eq;
 
-	/* Invalid */
-	panic("%s: invalid range kind", __FUNCTION__);
-	return 0;
+/* Return the entry of the table of in-flight accesses holding 'block', or the
+ * free entry where it should be inserted. Lookups only read the table, since
+ * they can run in parallel host threads. */
+static struct mod_access_table_entry_t *mod_access_table_probe(struct mod_t *mod,
+	uint32_t block)
+{
+	struct mod_access_table_entry_t *entry;
+	int index;
+
+	index = mod_access_table_hash(mod, block);
+	for (;;)
+	{
+		entry = &mod->access_table[index];
+		if (!entry->bucket_list_head || entry->block == block)
+			break;
+		index = (index + 1) & (mod->access_table_size - 1);
+	}
+	return entry;
+}
+
+
+/* Allocate a table of in-flight accesses with 'size' entries, and move the
+ * entries of the current table into it. */
+static void mod_access_table_resize(struct mod_t *mod, int size)
+{
+	struct mod_access_table_entry_t *old_table;
+	struct mod_access_table_entry_t *entry;
+	int old_size;
+	int i;
+
+	/* Allocate */
+	assert(!(size & (size - 1)));
+	old_table = mod->access_table;
+	old_size = mod->access_table_size;
+	mod->access_table = calloc(size, sizeof(struct mod_access_table_entry_t));
+	if (!mod->access_table)
+		fatal("%s: out of memory", __FUNCTION__);
+	mod->access_table_size = size;
+	mod->log_access_table_size = log_base2(size);
+
+	/* Move entries */
+	for (i = 0; i < old_size; i++)
+	{
+		if (!old_table[i].bucket_list_head)
+			continue;
+		entry = mod_access_table_probe(mod, old_table[i].block);
+		*entry = old_table[i];
+	}
+	free(old_table);
+}
+
+
+/* Free an entry of the table of in-flight accesses. Following entries of the
+ * same cluster are shifted back, so that no lookup stops at the freed entry
+ * before finding them. */
+static void mod_access_table_remove(struct mod_t *mod,
+	struct mod_access_table_entry_t *entry)
+{
+	struct mod_access_table_entry_t *table = mod->access_table;
+	int mask = mod->access_table_size - 1;
+	int free_index;
+	int index;
+	int home;
+
+	free_index = entry - table;
+	for (index = (free_index + 1) & mask; table[index].bucket_list_head;
+		index = (index + 1) & mask)
+	{
+		/* Entry can be moved if its home index is not cyclically
+		 * between the free entry (excluded) and itself. */
+		home = mod_access_table_hash(mod, table[index].block);
+		if (((index - home) & mask) < ((index - free_index) & mask))
+			continue;
+		table[free_index] = table[index];
+		free_index = index;
+	}
+	memset(&table[free_index], 0, sizeof(struct mod_access_table_entry_t));
+	mod->access_table_count--;
 }
 
 
@@ -49,8 +143,8 @@ static int mod_serves_address(struct mod_t *mod, uint32_t addr)
  * Public Functions
  */
 
-struct mod_t *mod_create(char *name, enum mod_kind_t kind, int num_ports,
-	int block_size, int latency)
+struct mod_t *mod_create(char *name, enum mod_kind_t kind, int num_banks,
+	int num_ports, int block_size, int latency)
 {
 	struct mod_t *mod;
 
@@ -67,10 +161,21 @@ struct mod_t *mod_create(char *name, enum mod_kind_t kind, int num_ports,
 	/* Initialize */
 	mod->kind = kind;
 	mod->latency = latency;
+	mod->inclusion = mod_inclusion_inclusive;
+
+	/* Banks, selected by block address by default */
+	assert(!(num_banks & (num_banks - 1)) && num_banks > 0);
+	mod->num_banks = num_banks;
+	mod->log_num_banks = log_base2(num_banks);
+	mod->bank_select = mod_bank_select_block;
+	mod->banks = calloc(num_banks, sizeof(struct mod_bank_t));
+	if (!mod->banks)
+		fatal("%s: out of memory", __FUNCTION__);
 
-	/* Ports */
-	mod->num_ports = num_ports;
-	mod->ports = calloc(num_ports, sizeof(struct mod_port_t));
+	/* Ports, 'num_ports' per bank */
+	mod->bank_ports = num_ports;
+	mod->num_ports = num_banks * num_ports;
+	mod->ports = calloc(mod->num_ports, sizeof(struct mod_port_t));
 	if (!mod->ports)
 		fatal("%s: out of memory", __FUNCTION__);
 
@@ -79,6 +184,9 @@ struct mod_t *mod_create(char *name, enum mod_kind_t kind, int num_ports,
 	mod->low_mod_list = linked_list_create();
 	mod->high_mod_list = linked_list_create();
 
+	/* Access stacks */
+	mod->stack_repos = repos_create(sizeof(struct mod_stack_t), mod->name);
+
 	/* Block size */
 	mod->block_size = block_size;
 	assert(!(block_size & (block_size - 1)) && block_size >= 4);
@@ -96,7 +204,17 @@ void mod_free(struct mod_t *mod)
 		cache_free(mod->cache);
 	if (mod->dir)
 		dir_free(mod->dir);
+	if (mod->sdist)
+		sdist_free(mod->sdist);
+	if (mod->dram)
+		dram_free(mod->dram);
+	if (mod->prefetcher)
+		prefetcher_free(mod->prefetcher);
+	free(mod->access_table);
+	repos_free_all_objects(mod->stack_repos);
+	repos_free(mod->stack_repos);
 	free(mod->ports);
+	free(mod->banks);
 	free(mod->name);
 	free(mod);
 }
@@ -108,12 +226,14 @@ void mod_dump(struct mod_t *mod, FILE *f)
 
 
 /* Access a memory module.
+ * Variable 'eip' is the address of the instruction causing the access, used to
+ * train prefetchers, or 0 if unknown.
  * Variable 'witness', if specified, will be increased when the access completes.
  * The function returns a unique access ID.
  */
 long long mod_access(struct mod_t *mod, enum mod_entry_kind_t entry_kind,
-	enum mod_access_kind_t access_kind, uint32_t addr, int *witness_ptr,
-	struct linked_list_t *event_queue, void *event_queue_item)
+	enum mod_access_kind_t access_kind, uint32_t addr, uint32_t eip,
+	int *witness_ptr, struct linked_list_t *event_queue, void *event_queue_item)
 {
 	struct mod_stack_t *stack;
 	int event;
@@ -124,6 +244,7 @@ long long mod_access(struct mod_t *mod, enum mod_entry_kind_t entry_kind,
 		mod, addr, ESIM_EV_NONE, NULL);
 
 	/* Initialize */
+	stack->eip = eip;
 	stack->witness_ptr = witness_ptr;
 	stack->event_queue = event_queue;
 	stack->event_queue_item = event_queue_item;
@@ -155,9 +276,9 @@ int mod_can_access(struct mod_t *mod, uint32_t addr)
 {
 	int non_coalesced_accesses;
 
-	/* There must be a free port */
+	/* There must be a free port in the bank of the address */
 	assert(mod->num_locked_ports <= mod->num_ports);
-	if (mod->num_locked_ports == mod->num_ports)
+	if (!mod_bank_has_free_port(mod, mod_get_bank(mod, addr)))
 		return 0;
 
 	/* If no MSHR is given, module can be accessed */
@@ -172,19 +293,41 @@ int mod_can_access(struct mod_t *mod, uint32_t addr)
 }
 
 
+/* Return true if 'addr' is in the address range served by the module. */
+int mod_serves_address(struct mod_t *mod, uint32_t addr)
+{
+	/* Address bounds */
+	if (mod->range_kind == mod_range_bounds)
+		return addr >= mod->range.bounds.low &&
+			addr <= mod->range.bounds.high;
+
+	/* Interleaved addresses */
+	if (mod->range_kind == mod_range_interleaved)
+		return (addr / mod->range.interleaved.div) %
+			mod->range.interleaved.mod ==
+			mod->range.interleaved.eq;
+
+	/* Invalid */
+	panic("%s: invalid range kind", __FUNCTION__);
+	return 0;
+}
+
+
 /* Return {set, way, tag, state} for an address.
  * The function returns TRUE on hit, FALSE on miss. */
 int mod_find_block(struct mod_t *mod, uint32_t addr, uint32_t *set_ptr,
 	uint32_t *way_ptr, uint32_t *tag_ptr, int *state_ptr)
 {
 	struct cache_t *cache = mod->cache;
-	struct cache_block_t *blk;
 	struct dir_lock_t *dir_lock;
 
 	uint32_t set;
-	uint32_t way;
 	uint32_t tag;
 
+	int way;
+	int last_way;
+	int transient_way;
+
 	/* A transient tag is considered a hit if the block is
 	 * locked in the corresponding directory. */
 	tag = addr & ~cache->block_mask;
@@ -202,21 +345,25 @@ int mod_find_block(struct mod_t *mod, uint32_t addr, uint32_t *set_ptr,
 		panic("%s: invalid range kind (%d)", __FUNCTION__, mod->range_kind);
 	}
 
-	for (way = 0; way < cache->assoc; way++)
+	/* Look for a valid block first. A block with a matching transient tag in a
+	 * lower way is found instead if it is locked in the directory. */
+	way = cache_find_way(cache, set, tag);
+	last_way = way < 0 ? cache->assoc - 1 : way - 1;
+	transient_way = cache_find_transient_way(cache, set, tag, 0, last_way);
+	while (transient_way >= 0)
 	{
-		blk = &cache->sets[set].blocks[way];
-		if (blk->tag == tag && blk->state)
-			break;
-		if (blk->transient_tag == tag)
+		dir_lock = dir_lock_get(mod->dir, set, transient_way);
+		if (dir_lock->lock)
 		{
-			dir_lock = dir_lock_get(mod->dir, set, way);
-			if (dir_lock->lock)
-				break;
+			way = transient_way;
+			break;
 		}
+		transient_way = cache_find_transient_way(cache, set, tag,
+			transient_way + 1, last_way);
 	}
 
 	/* Miss */
-	if (way == cache->assoc)
+	if (way < 0)
 	{
 		PTR_ASSIGN(set_ptr, set);
 		PTR_ASSIGN(tag_ptr, tag);
@@ -229,31 +376,403 @@ int mod_find_block(struct mod_t *mod, uint32_t addr, uint32_t *set_ptr,
 	PTR_ASSIGN(set_ptr, set);
 	PTR_ASSIGN(way_ptr, way);
 	PTR_ASSIGN(tag_ptr, tag);
-	PTR_ASSIGN(state_ptr, cache->sets[set].blocks[way].state);
+	PTR_ASSIGN(state_ptr, cache->states[CACHE_BLOCK_INDEX(cache, set, way)]);
+	return 1;
+}
+
+
+/* Return the way of the block to be replaced in a set. Non-inclusive caches
+ * avoid replacing blocks with copies in upper-level caches, so these copies
+ * are only invalidated when all blocks in the set have one. */
+uint32_t mod_replace_block(struct mod_t *mod, uint32_t set)
+{
+	struct cache_t *cache = mod->cache;
+	unsigned char avoid[cache->assoc];
+	int any;
+	int way;
+
+	/* Inclusive cache */
+	if (mod->inclusion == mod_inclusion_inclusive)
+		return cache_replace_block(cache, set);
+
+	/* Avoid blocks in upper levels */
+	any = 0;
+	for (way = 0; way < cache->assoc; way++)
+	{
+		avoid[way] = dir_entry_group_shared_or_owned(mod->dir, set, way);
+		any |= avoid[way];
+	}
+	if (!any)
+		return cache_replace_block(cache, set);
+	return cache_replace_block_avoid(cache, set, avoid);
+}
+
+
+/* Return 1 if the block at {set, way} of a non-inclusive cache takes a data
+ * frame, that is, if it holds its data, or if the access that locked it
+ * reserved a frame for it. */
+static int mod_data_frame_used(struct mod_t *mod, uint32_t set, uint32_t way)
+{
+	int flags;
+
+	flags = cache_get_data(mod->cache, set, way);
+	if ((flags & CACHE_DATA_RESERVED) && dir_lock_get(mod->dir, set, way)->lock)
+		return 1;
+	return (flags & CACHE_DATA_VALID) && cache_block_has_data(mod->cache, set, way);
+}
+
+
+/* Return the number of data frames taken in a set of a non-inclusive cache */
+static int mod_data_frames_used(struct mod_t *mod, uint32_t set)
+{
+	int count;
+	int way;
+
+	count = 0;
+	for (way = 0; way < mod->cache->assoc; way++)
+		count += mod_data_frame_used(mod, set, way);
+	return count;
+}
+
+
+/* Return 1 if the block containing 'addr' is present in 'mod' with its data.
+ * Modules with no data frames have the data of all blocks present. */
+int mod_has_data(struct mod_t *mod, uint32_t addr)
+{
+	uint32_t set;
+	uint32_t way;
+
+	if (!mod->cache->data)
+		return 1;
+	if (!mod_find_block(mod, addr, &set, &way, NULL, NULL))
+		return 0;
+	return cache_block_has_data(mod->cache, set, way);
+}
+
+
+/* Return 1 if the upper-level owner of the block at {set, way} of 'mod' holds
+ * its data, either itself or in its own upper-level owner. */
+int mod_owner_has_data(struct mod_t *mod, uint32_t set, uint32_t way)
+{
+	struct net_node_t *node;
+	struct mod_t *owner;
+
+	uint32_t tag;
+	uint32_t owner_set;
+	uint32_t owner_way;
+	int index;
+
+	index = dir_entry_group_owner(mod->dir, set, way);
+	if (index == DIR_ENTRY_OWNER_NONE)
+		return 0;
+	node = list_get(mod->high_net->node_list, index);
+	owner = node->user_data;
+	cache_get_block(mod->cache, set, way, &tag, NULL);
+	if (!mod_find_block(owner, tag, &owner_set, &owner_way, NULL, NULL))
+		return 0;
+	return cache_block_has_data(owner->cache, owner_set, owner_way) ||
+		mod_owner_has_data(owner, owner_set, owner_way);
+}
+
+
+/* Return 1 if the data of the block at {set, way} of a non-inclusive cache can
+ * be dropped with no traffic, since it can be brought again. This is the case
+ * if the upper-level owner holds the data, or if the block is clean and the
+ * lower level holds it, or can bring it in turn. */
+static int mod_data_droppable(struct mod_t *mod, uint32_t set, uint32_t way)
+{
+	uint32_t tag;
+	int state;
+
+	cache_get_block(mod->cache, set, way, &tag, &state);
+	if (state == cache_block_shared)
+		return 1;
+	if (state == cache_block_exclusive && mod_has_data(mod_get_low_mod(mod, tag), tag))
+		return 1;
+	return mod_owner_has_data(mod, set, way);
+}
+
+
+/* Return the way of a block in a set of a non-inclusive cache, other than
+ * 'way', whose data can be dropped, or -1 if there is none. The unlocked block
+ * closest to be replaced is chosen. */
+static int mod_data_drop_victim(struct mod_t *mod, uint32_t set, uint32_t way)
+{
+	struct cache_t *cache = mod->cache;
+	unsigned char avoid[cache->assoc];
+	int any;
+	int w;
+
+	any = 0;
+	for (w = 0; w < cache->assoc; w++)
+	{
+		avoid[w] = w == way || !cache_block_has_data(cache, set, w) ||
+			dir_lock_get(mod->dir, set, w)->lock ||
+			!mod_data_droppable(mod, set, w);
+		any |= !avoid[w];
+	}
+	return any ? (int) cache_replace_block_among(cache, set, avoid) : -1;
+}
+
+
+/* Look for a data frame for the block at {set, way} of a non-inclusive cache,
+ * before locking it. Return 1 if the block takes a frame already, including
+ * one reserved by the access holding its lock, or if a frame is free or can be
+ * freed by dropping the data of another block. Otherwise, return 0, and in
+ * 'victim_ptr' the way of the block to evict to free a frame, or -1 if there
+ * is none. On a miss ('hit' is 0), the victim is replaced by the block, so it
+ * may be locked. On a hit, only the data of the victim is evicted, and it must
+ * be unlocked, since it is locked together with the block. */
+int mod_find_data_frame(struct mod_t *mod, uint32_t set, uint32_t way, int hit,
+	int *victim_ptr)
+{
+	struct cache_t *cache = mod->cache;
+	unsigned char avoid[cache->assoc];
+	int any;
+	int w;
+
+	/* Free frame */
+	*victim_ptr = -1;
+	if (mod_data_frame_used(mod, set, way) ||
+		mod_data_frames_used(mod, set) < cache->data_assoc ||
+		mod_data_drop_victim(mod, set, way) >= 0)
+		return 1;
+
+	/* Block to evict */
+	any = 0;
+	for (w = 0; w < cache->assoc; w++)
+	{
+		if (hit)
+			avoid[w] = w == way || !cache_block_has_data(cache, set, w) ||
+				dir_lock_get(mod->dir, set, w)->lock;
+		else
+			avoid[w] = w == way || !mod_data_frame_used(mod, set, w);
+		any |= !avoid[w];
+	}
+	if (any)
+		*victim_ptr = cache_replace_block_among(cache, set, avoid);
+	return 0;
+}
+
+
+/* Take a data frame for the block at {set, way} of a non-inclusive cache,
+ * locked by the caller or accessed atomically, after 'mod_find_data_frame'
+ * found one or the victim evicted to free it. If there is no free frame, the
+ * data of another block is dropped. The data is valid once it arrives, as
+ * recorded by 'mod_fill_data'. */
+void mod_reserve_data(struct mod_t *mod, uint32_t set, uint32_t way)
+{
+	struct cache_t *cache = mod->cache;
+	int flags;
+	int victim;
+
+	flags = cache_get_data(cache, set, way);
+	cache_set_data(cache, set, way, flags | CACHE_DATA_RESERVED);
+	if (mod_data_frames_used(mod, set) - mod_data_frame_used(mod, set, way) <
+		cache->data_assoc)
+		return;
+	victim = mod_data_drop_victim(mod, set, way);
+	if (victim >= 0)
+		mod_drop_data(mod, set, victim);
+}
+
+
+/* Record that the data of a block of a non-inclusive cache arrived in the
+ * frame reserved for it. Return 1 if a frame was reserved. */
+int mod_fill_data(struct mod_t *mod, uint32_t set, uint32_t way)
+{
+	if (!(cache_get_data(mod->cache, set, way) & CACHE_DATA_RESERVED))
+		return 0;
+	cache_set_data(mod->cache, set, way, CACHE_DATA_VALID);
 	return 1;
 }
 
 
+/* Drop the data of a block of a non-inclusive cache, which stays present to
+ * keep its directory entry. */
+void mod_drop_data(struct mod_t *mod, uint32_t set, uint32_t way)
+{
+	if (cache_block_has_data(mod->cache, set, way))
+		mod->data_drops++;
+	cache_set_data(mod->cache, set, way, 0);
+}
+
+
+/* Return the mask of the sectors of 'mod' holding the 'size' bytes starting at
+ * 'addr', which must be part of one single block. */
+uint32_t mod_get_sectors(struct mod_t *mod, uint32_t addr, int size)
+{
+	struct cache_t *cache = mod->cache;
+	int first;
+	int last;
+
+	assert(size > 0 && (addr & cache->block_mask) + size <= cache->block_size);
+	first = (addr & cache->block_mask) >> cache->log_sector_size;
+	last = ((addr & cache->block_mask) + size - 1) >> cache->log_sector_size;
+	return (((uint32_t) 2 << last) - 1) & ~(((uint32_t) 1 << first) - 1);
+}
+
+
+/* Return the mask of the sectors of 'mod' holding the data requested by an
+ * upper-level module 'requester', given as the mask 'sectors' of the sectors
+ * of its block at 'addr'. A mask of 0 requests the whole block. */
+uint32_t mod_get_request_sectors(struct mod_t *mod, struct mod_t *requester,
+	uint32_t addr, uint32_t sectors)
+{
+	uint32_t mask;
+	int sector_size;
+	int i;
+
+	if (!sectors)
+		return mod_get_sectors(mod, addr, requester->block_size);
+	mask = 0;
+	sector_size = 1 << requester->cache->log_sector_size;
+	for (i = 0; sectors; i++, sectors >>= 1)
+		if (sectors & 1)
+			mask |= mod_get_sectors(mod, addr + i * sector_size, sector_size);
+	return mask;
+}
+
+
+/* Return the number of bytes of data in the sectors of a block of 'mod' given
+ * by mask 'sectors', or in the whole block if the mask is 0. */
+int mod_get_sectors_size(struct mod_t *mod, uint32_t sectors)
+{
+	if (!sectors)
+		return mod->block_size;
+	return __builtin_popcount(sectors) << mod->cache->log_sector_size;
+}
+
+
+/* Make sectors 'sectors' of a block valid, and also dirty if 'dirty' is set.
+ * Sectors that were not valid yet are recorded as filled. Modules without
+ * sectors are not affected. */
+void mod_fill_sectors(struct mod_t *mod, uint32_t set, uint32_t way,
+	uint32_t sectors, int dirty)
+{
+	uint32_t valid_mask;
+	uint32_t dirty_mask;
+
+	if (mod->cache->num_sectors == 1)
+		return;
+	cache_get_sectors(mod->cache, set, way, &valid_mask, &dirty_mask);
+	mod->sector_fills += __builtin_popcount(sectors & ~valid_mask);
+	valid_mask |= sectors;
+	if (dirty)
+		dirty_mask |= sectors;
+	cache_set_sectors(mod->cache, set, way, valid_mask, dirty_mask);
+}
+
+
+/* Return the mask of the sectors of a block sent when it is written back or
+ * its owner replies with data, that is, the dirty sectors, or the valid ones if
+ * there is no dirty sector. */
+uint32_t mod_get_writeback_sectors(struct mod_t *mod, uint32_t set, uint32_t way)
+{
+	uint32_t valid_mask;
+	uint32_t dirty_mask;
+
+	cache_get_sectors(mod->cache, set, way, &valid_mask, &dirty_mask);
+	return dirty_mask ? dirty_mask : valid_mask;
+}
+
+
+/* Record the valid sectors of a block that is about to be replaced or
+ * invalidated, for the sector utilization statistics. */
+void mod_evict_sectors(struct mod_t *mod, uint32_t set, uint32_t way)
+{
+	uint32_t valid_mask;
+
+	if (mod->cache->num_sectors == 1)
+		return;
+	cache_get_sectors(mod->cache, set, way, &valid_mask, NULL);
+	mod->sector_evicted_blocks++;
+	mod->sector_evicted_valid += __builtin_popcount(valid_mask);
+}
+
+
+/* Return the bank serving address 'addr' */
+int mod_get_bank(struct mod_t *mod, uint32_t addr)
+{
+	uint32_t block;
+	int bank;
+
+	if (mod->num_banks == 1)
+		return 0;
+	switch (mod->bank_select)
+	{
+
+	case mod_bank_select_block:
+		return (addr >> mod->log_block_size) & (mod->num_banks - 1);
+
+	case mod_bank_select_word:
+		return (addr >> 2) & (mod->num_banks - 1);
+
+	case mod_bank_select_xor:
+
+		/* Fold all bits of the block address, so that strides that are
+		 * multiples of the number of banks do not map to the same one. */
+		bank = 0;
+		for (block = addr >> mod->log_block_size; block; block >>= mod->log_num_banks)
+			bank ^= block & (mod->num_banks - 1);
+		return bank;
+
+	default:
+		panic("%s: invalid bank select function", __FUNCTION__);
+		return 0;
+	}
+}
+
+
+/* Return true if bank 'bank' has a free port */
+int mod_bank_has_free_port(struct mod_t *mod, int bank)
+{
+	assert(bank >= 0 && bank < mod->num_banks);
+	return mod->banks[bank].num_locked_ports < mod->bank_ports;
+}
+
+
 /* Lock a port, and schedule event when done.
- * If there is no free port, the access is enqueued in the port
- * waiting list, and it will retry once a port becomes available with a
- * call to 'mod_unlock_port'. */
+ * Only ports of the bank serving the address of 'stack' are used. If there is
+ * no free port in the bank, the access is enqueued in the port waiting list,
+ * even if ports of other banks are free, and it will retry once a port becomes
+ * available with a call to 'mod_unlock_port'. */
 void mod_lock_port(struct mod_t *mod, struct mod_stack_t *stack, int event)
 {
 	struct mod_port_t *port = NULL;
+	struct mod_bank_t *bank;
+	int bank_id;
 	int i;
 
-	/* No free port */
-	if (mod->num_locked_ports >= mod->num_ports)
+	/* No free port in the bank */
+	bank_id = mod_get_bank(mod, stack->addr);
+	bank = &mod->banks[bank_id];
+	if (bank->num_locked_ports >= mod->bank_ports)
 	{
-		assert(!DOUBLE_LINKED_LIST_MEMBER(mod, port_waiting, stack));
-		DOUBLE_LINKED_LIST_INSERT_TAIL(mod, port_waiting, stack);
+		/* Bank conflict if ports in other banks are free */
+		if (!stack->port_waiting)
+		{
+			stack->port_waiting = 1;
+			stack->port_wait_when = esim_cycle;
+			if (mod->num_locked_ports < mod->num_ports)
+				mod->bank_conflicts++;
+		}
+		assert(!DOUBLE_LINKED_LIST_MEMBER(bank, port_waiting, stack));
+		DOUBLE_LINKED_LIST_INSERT_TAIL(bank, port_waiting, stack);
 		stack->port_waiting_list_event = event;
 		return;
 	}
 
+	/* Statistics */
+	bank->accesses++;
+	if (stack->port_waiting)
+	{
+		stack->port_waiting = 0;
+		mod->bank_wait_cycles += esim_cycle - stack->port_wait_when;
+	}
+
 	/* Get free port */
-	for (i = 0; i < mod->num_ports; i++)
+	for (i = bank_id * mod->bank_ports; i < (bank_id + 1) * mod->bank_ports; i++)
 	{
 		port = &mod->ports[i];
 		if (!port->stack)
@@ -261,9 +780,10 @@ void mod_lock_port(struct mod_t *mod, struct mod_stack_t *stack, int event)
 	}
 
 	/* Lock port */
-	assert(port && i < mod->num_ports);
+	assert(port && i < (bank_id + 1) * mod->bank_ports);
 	port->stack = stack;
 	stack->port = port;
+	bank->num_locked_ports++;
 	mod->num_locked_ports++;
 
 	/* Debug */
@@ -278,6 +798,7 @@ void mod_lock_port(struct mod_t *mod, struct mod_stack_t *stack, int event)
 void mod_unlock_port(struct mod_t *mod, struct mod_port_t *port,
 	struct mod_stack_t *stack)
 {
+	struct mod_bank_t *bank;
 	int event;
 
 	/* Checks */
@@ -286,23 +807,26 @@ void mod_unlock_port(struct mod_t *mod, struct mod_port_t *port,
 	assert(stack->mod == mod);
 
 	/* Unlock port */
+	bank = &mod->banks[(port - mod->ports) / mod->bank_ports];
+	assert(bank->num_locked_ports > 0);
 	stack->port = NULL;
 	port->stack = NULL;
+	bank->num_locked_ports--;
 	mod->num_locked_ports--;
 
 	/* Debug */
 	mem_debug("  %lld %lld %s port unlocked\n", esim_cycle,
 		stack->id, mod->name);
 
-	/* Check if there was any access waiting for free port */
-	if (!mod->port_waiting_list_count)
+	/* Check if there was any access waiting for a free port of the bank */
+	if (!bank->port_waiting_list_count)
 		return;
 
 	/* Wake up one access waiting for a free port */
-	stack = mod->port_waiting_list_head;
+	stack = bank->port_waiting_list_head;
 	event = stack->port_waiting_list_event;
-	assert(DOUBLE_LINKED_LIST_MEMBER(mod, port_waiting, stack));
-	DOUBLE_LINKED_LIST_REMOVE(mod, port_waiting, stack);
+	assert(DOUBLE_LINKED_LIST_MEMBER(bank, port_waiting, stack));
+	DOUBLE_LINKED_LIST_REMOVE(bank, port_waiting, stack);
 	mod_lock_port(mod, stack, event);
 
 }
@@ -311,7 +835,10 @@ void mod_unlock_port(struct mod_t *mod, struct mod_port_t *port,
 void mod_access_start(struct mod_t *mod, struct mod_stack_t *stack,
 	enum mod_access_kind_t access_kind)
 {
-	int index;
+	struct mod_access_table_entry_t *entry;
+	uint32_t block;
+	int chain;
+	int size;
 
 	/* Record access kind */
 	stack->access_kind = access_kind;
@@ -323,15 +850,39 @@ void mod_access_start(struct mod_t *mod, struct mod_stack_t *stack,
 	if (access_kind == mod_access_write)
 		DOUBLE_LINKED_LIST_INSERT_TAIL(mod, write_access, stack);
 
-	/* Insert in access hash table */
-	index = (stack->addr >> mod->log_block_size) % MOD_ACCESS_HASH_TABLE_SIZE;
-	DOUBLE_LINKED_LIST_INSERT_TAIL(&mod->access_hash_table[index], bucket, stack);
+	/* Create the table of in-flight accesses with twice as many entries as
+	 * MSHRs, or grow it if it is half full. */
+	if (!mod->access_table)
+	{
+		for (size = MOD_ACCESS_TABLE_MIN_SIZE; size < mod->mshr_size * 2; size <<= 1);
+		mod_access_table_resize(mod, size);
+	}
+	else if (mod->access_table_count * 2 >= mod->access_table_size)
+	{
+		mod_access_table_resize(mod, mod->access_table_size * 2);
+	}
+
+	/* Insert in table of in-flight accesses */
+	block = stack->addr >> mod->log_block_size;
+	entry = mod_access_table_probe(mod, block);
+	if (!entry->bucket_list_head)
+	{
+		entry->block = block;
+		mod->access_table_count++;
+	}
+
+	/* Longest chain, given by the distance to the home entry */
+	chain = ((entry - mod->access_table - mod_access_table_hash(mod, block)) &
+		(mod->access_table_size - 1)) + 1;
+	if (chain > mod->access_table_max_chain)
+		mod->access_table_max_chain = chain;
+	DOUBLE_LINKED_LIST_INSERT_TAIL(entry, bucket, stack);
 }
 
 
 void mod_access_finish(struct mod_t *mod, struct mod_stack_t *stack)
 {
-	int index;
+	struct mod_access_table_entry_t *entry;
 
 	/* Remove from access list */
 	DOUBLE_LINKED_LIST_REMOVE(mod, access, stack);
@@ -341,9 +892,11 @@ void mod_access_finish(struct mod_t *mod, struct mod_stack_t *stack)
 	if (stack->access_kind == mod_access_write)
 		DOUBLE_LINKED_LIST_REMOVE(mod, write_access, stack);
 
-	/* Remove from hash table */
-	index = (stack->addr >> mod->log_block_size) % MOD_ACCESS_HASH_TABLE_SIZE;
-	DOUBLE_LINKED_LIST_REMOVE(&mod->access_hash_table[index], bucket, stack);
+	/* Remove from table of in-flight accesses */
+	entry = mod_access_table_probe(mod, stack->addr >> mod->log_block_size);
+	DOUBLE_LINKED_LIST_REMOVE(entry, bucket, stack);
+	if (!entry->bucket_list_head)
+		mod_access_table_remove(mod, entry);
 
 	/* If this was a coalesced access, update counter */
 	if (stack->coalesced)
@@ -361,11 +914,9 @@ void mod_access_finish(struct mod_t *mod, struct mod_stack_t *stack)
 int mod_in_flight_access(struct mod_t *mod, long long id, uint32_t addr)
 {
 	struct mod_stack_t *stack;
-	int index;
 
 	/* Look for access */
-	index = (addr >> mod->log_block_size) % MOD_ACCESS_HASH_TABLE_SIZE;
-	for (stack = mod->access_hash_table[index].bucket_list_head; stack; stack = stack->bucket_list_next)
+	for (stack = mod_in_flight_block(mod, addr); stack; stack = stack->bucket_list_next)
 		if (stack->id == id)
 			return 1;
 
@@ -382,20 +933,17 @@ struct mod_stack_t *mod_in_flight_address(struct mod_t *mod, uint32_t addr,
 	struct mod_stack_t *older_than_stack)
 {
 	struct mod_stack_t *stack;
-	int index;
 
 	/* Look for address */
-	index = (addr >> mod->log_block_size) % MOD_ACCESS_HASH_TABLE_SIZE;
-	for (stack = mod->access_hash_table[index].bucket_list_head; stack;
+	for (stack = mod_in_flight_block(mod, addr); stack;
 		stack = stack->bucket_list_next)
 	{
 		/* This stack is not older than 'older_than_stack' */
 		if (older_than_stack && stack->id >= older_than_stack->id)
 			continue;
 
-		/* Address matches */
-		if (stack->addr >> mod->log_block_size == addr >> mod->log_block_size)
-			return stack;
+		/* Found */
+		return stack;
 	}
 
 	/* Not found */
@@ -403,6 +951,20 @@ struct mod_stack_t *mod_in_flight_address(struct mod_t *mod, uint32_t addr,
 }
 
 
+/* Return the oldest in-flight access to the block containing 'addr', or NULL if
+ * there is none. The rest of accesses to the block follow in field
+ * 'bucket_list_next', in the order they started. */
+struct mod_stack_t *mod_in_flight_block(struct mod_t *mod, uint32_t addr)
+{
+	/* No access started yet */
+	if (!mod->access_table)
+		return NULL;
+
+	/* Look for block */
+	return mod_access_table_probe(mod, addr >> mod->log_block_size)->bucket_list_head;
+}
+
+
 /* Return the youngest in-flight write older than 'older_than_stack'. If 'older_than_stack'
  * is NULL, return the youngest in-flight write. Return NULL if there is no in-flight write.
  */
@@ -415,10 +977,11 @@ struct mod_stack_t *mod_in_flight_write(struct mod_t *mod,
 	if (!older_than_stack)
 		return mod->write_access_list_tail;
 
-	/* Search */
-	for (stack = older_than_stack->access_list_prev; stack;
-		stack = stack->access_list_prev)
-		if (stack->access_kind == mod_access_write)
+	/* Writes are in the write access list in the order they started, that is,
+	 * ordered by identifier. Skip those younger than 'older_than_stack'. */
+	for (stack = mod->write_access_list_tail; stack;
+		stack = stack->write_access_list_prev)
+		if (stack->id < older_than_stack->id)
 			return stack;
 
 	/* Not found */
@@ -508,8 +1071,10 @@ struct mod_stack_t *mod_can_coalesce(struct mod_t *mod,
 			if (stack->access_kind != mod_access_read)
 				return NULL;
 
-			if (stack->addr >> mod->log_block_size ==
-				addr >> mod->log_block_size)
+			/* In sectored caches, only with accesses to the same
+			 * sector, since only the sectors accessed are fetched. */
+			if (stack->addr >> mod->cache->log_sector_size ==
+				addr >> mod->cache->log_sector_size)
 				return stack->master_stack ? stack->master_stack : stack;
 		}
 		break;
@@ -526,8 +1091,9 @@ struct mod_stack_t *mod_can_coalesce(struct mod_t *mod,
 		if (stack->access_kind != mod_access_write)
 			return NULL;
 
-		/* Only if it is an access to the same block */
-		if (stack->addr >> mod->log_block_size != addr >> mod->log_block_size)
+		/* Only if it is an access to the same block, or sector */
+		if (stack->addr >> mod->cache->log_sector_size !=
+			addr >> mod->cache->log_sector_size)
 			return NULL;
 
 		/* Only if previous write has not started yet */
@@ -586,9 +1152,7 @@ struct mod_stack_t *mod_stack_create(long long id, struct mod_t *mod,
 	struct mod_stack_t *stack;
 
 	/* Create stack */
-	stack = calloc(1, sizeof(struct mod_stack_t));
-	if (!stack)
-		fatal("%s: out of memory", __FUNCTION__);
+	stack = repos_create_object(mod->stack_repos);
 
 	/* Initialize */
 	stack->id = id;
@@ -613,7 +1177,7 @@ void mod_stack_return(struct mod_stack_t *stack)
 	mod_stack_wakeup_stack(stack);
 
 	/* Free */
-	free(stack);
+	repos_free_object(stack->mod->stack_repos, stack);
 	esim_schedule_event(ret_event, ret_stack, 0);
 }
 
@@ -705,6 +1269,12 @@ void mod_stack_wakeup_stack(struct mod_stack_t *master_stack)
 		event = stack->waiting_list_event;
 		DOUBLE_LINKED_LIST_REMOVE(master_stack, waiting, stack);
 		esim_schedule_event(event, stack, 0);
+
+		/* The master is freed before a coalesced access finishes, and
+		 * its object can be reused by an access started in this cycle
+		 * (e.g., a page walk). Later reads coalesce with this one. */
+		if (stack->master_stack == master_stack)
+			stack->master_stack = NULL;
 		mem_debug(" %lld", stack->id);
 	}
 
@@ -0,0 +1,409 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2011  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <mem-system.h>
+
+
+/*
+ * Hardware Prefetcher
+ *
+ * A prefetcher is trained with the demand accesses that a cache receives, that
+ * is, loads and stores from a CPU core, and up-down requests from upper-level
+ * caches. Prefetches are regular loads started in the cache, going through the
+ * coherence protocol like any other access. They have a lower priority than
+ * demand accesses: a prefetch is dropped instead of being started if the cache
+ * has no free port or MSHR at the time it is generated.
+ *
+ * Prefetched blocks are flagged until they are accessed (useful prefetch) or
+ * replaced (useless prefetch). A prefetch that a demand access has to wait for
+ * is counted as late.
+ */
+
+struct string_map_t prefetcher_kind_map =
+{
+	3, {
+		{ "NextLine", prefetcher_kind_next_line },
+		{ "Stride", prefetcher_kind_stride },
+		{ "Stream", prefetcher_kind_stream }
+	}
+};
+
+/* Confidence of a stride or stream needed to start prefetching, and maximum
+ * value of the confidence counters. */
+#define PREFETCHER_MIN_CONFIDENCE  2
+#define PREFETCHER_MAX_CONFIDENCE  3
+
+
+
+
+/*
+ * Private Functions
+ */
+
+/* Return true if the access in find-and-lock 'stack' is a demand access */
+static int prefetcher_demand(struct mod_stack_t *stack)
+{
+	struct mod_stack_t *ret = stack->ret_stack;
+	int event = stack->ret_event;
+
+	/* Page walk load, returning to a TLB miss rather than to a module stack */
+	if (event == EV_TLB_WALK)
+		return 1;
+	if (ret->prefetch)
+		return 0;
+	if (event == EV_MOD_LOAD_ACTION || event == EV_MOD_STORE_ACTION)
+		return 1;
+	if (event == EV_MOD_READ_REQUEST_ACTION || event == EV_MOD_WRITE_REQUEST_ACTION)
+		return ret->request_dir == mod_request_up_down;
+	return 0;
+}
+
+
+/* Start a prefetch of the block containing 'addr', generated by an access to
+ * 'trigger_addr'. The function returns true if the prefetch was started. */
+static int prefetcher_issue(struct mod_t *mod, uint32_t addr, uint32_t trigger_addr)
+{
+	struct prefetcher_t *prefetcher = mod->prefetcher;
+	struct mod_stack_t *stack;
+
+	/* Prefetches do not cross page boundaries, and must be served by this
+	 * module. */
+	if ((addr & ~mmu_page_mask) != (trigger_addr & ~mmu_page_mask))
+		return 0;
+	if (!mod_serves_address(mod, addr))
+		return 0;
+
+	/* Block is already in the cache or being brought */
+	if (mod_find_block(mod, addr, NULL, NULL, NULL, NULL))
+		return 0;
+	if (mod_in_flight_address(mod, addr, NULL))
+		return 0;
+
+	/* No free port or MSHR */
+	if (!mod_can_access(mod, addr))
+	{
+		prefetcher->dropped++;
+		return 0;
+	}
+
+	/* Start load */
+	mod_stack_id++;
+	stack = mod_stack_create(mod_stack_id, mod, addr & ~mod->cache->block_mask,
+		ESIM_EV_NONE, NULL);
+	stack->prefetch = 1;
+	prefetcher->issued++;
+	mem_debug("  %lld %lld 0x%x %s prefetch\n", esim_cycle, stack->id,
+		stack->addr, mod->name);
+	esim_execute_event(EV_MOD_LOAD, stack);
+	return 1;
+}
+
+
+/* Prefetch the 'degree' blocks following the accessed one */
+static void prefetcher_next_line(struct mod_t *mod, uint32_t addr)
+{
+	struct prefetcher_t *prefetcher = mod->prefetcher;
+	int i;
+
+	for (i = 1; i <= prefetcher->degree; i++)
+		prefetcher_issue(mod, addr + (i << prefetcher->log_block_size), addr);
+}
+
+
+/* Train the entry of instruction 'eip', and prefetch the next 'degree' addresses
+ * of its stride once it is repeated. Strides shorter than a block prefetch the
+ * next blocks in the direction of the stride. */
+static void prefetcher_stride(struct mod_t *mod, uint32_t eip, uint32_t addr)
+{
+	struct prefetcher_t *prefetcher = mod->prefetcher;
+	struct prefetcher_stride_entry_t *entry;
+
+	int block_size = 1 << prefetcher->log_block_size;
+	int stride;
+	int i;
+
+	/* Unknown instruction */
+	if (!eip)
+		return;
+
+	/* New instruction */
+	entry = &prefetcher->stride_table[eip % prefetcher->table_size];
+	if (entry->eip != eip)
+	{
+		entry->eip = eip;
+		entry->last_addr = addr;
+		entry->stride = 0;
+		entry->confidence = 0;
+		return;
+	}
+
+	/* Update stride */
+	stride = addr - entry->last_addr;
+	entry->last_addr = addr;
+	if (!stride)
+		return;
+	if (stride != entry->stride)
+	{
+		entry->stride = stride;
+		entry->confidence = 0;
+		return;
+	}
+	if (entry->confidence < PREFETCHER_MAX_CONFIDENCE)
+		entry->confidence++;
+	if (entry->confidence < PREFETCHER_MIN_CONFIDENCE)
+		return;
+
+	/* Prefetch */
+	if (stride > -block_size && stride < block_size)
+		stride = stride > 0 ? block_size : -block_size;
+	for (i = 1; i <= prefetcher->degree; i++)
+		prefetcher_issue(mod, addr + i * stride, addr);
+}
+
+
+/* Find the stream that a missing block belongs to, or start a new one. Once
+ * the direction of a stream is confirmed, prefetches are kept 'distance'
+ * blocks ahead of its last access, starting up to 'degree' of them at a time. */
+static void prefetcher_stream(struct mod_t *mod, uint32_t addr)
+{
+	struct prefetcher_t *prefetcher = mod->prefetcher;
+	struct prefetcher_stream_t *stream;
+	struct prefetcher_stream_t *lru_stream;
+
+	uint32_t block;
+	int diff;
+	int count;
+	int i;
+
+	/* Look for a stream with a recent access close to the block, in the
+	 * direction of the stream. */
+	block = addr >> prefetcher->log_block_size;
+	stream = NULL;
+	lru_stream = &prefetcher->streams[0];
+	prefetcher->stream_clock++;
+	for (i = 0; i < prefetcher->table_size; i++)
+	{
+		if (!prefetcher->streams[i].valid)
+		{
+			lru_stream = &prefetcher->streams[i];
+			continue;
+		}
+		if (prefetcher->streams[i].last_use < lru_stream->last_use && lru_stream->valid)
+			lru_stream = &prefetcher->streams[i];
+		diff = block - prefetcher->streams[i].last_block;
+		if (!diff || diff > prefetcher->distance || diff < -prefetcher->distance)
+			continue;
+		if (prefetcher->streams[i].dir && (diff > 0) != (prefetcher->streams[i].dir > 0))
+			continue;
+		stream = &prefetcher->streams[i];
+		break;
+	}
+
+	/* New stream, replacing the least recently used one */
+	if (!stream)
+	{
+		lru_stream->valid = 1;
+		lru_stream->last_block = block;
+		lru_stream->dir = 0;
+		lru_stream->confidence = 0;
+		lru_stream->last_use = prefetcher->stream_clock;
+		return;
+	}
+
+	/* Update stream */
+	if (!stream->dir)
+		stream->dir = diff > 0 ? 1 : -1;
+	if (stream->confidence < PREFETCHER_MAX_CONFIDENCE)
+		stream->confidence++;
+	stream->last_block = block;
+	stream->last_use = prefetcher->stream_clock;
+	if (stream->confidence < PREFETCHER_MIN_CONFIDENCE)
+		return;
+
+	/* Prefetch blocks ahead that are not present yet */
+	count = 0;
+	for (i = 1; i <= prefetcher->distance && count < prefetcher->degree; i++)
+		count += prefetcher_issue(mod, (block + i * stream->dir) <<
+			prefetcher->log_block_size, addr);
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+struct prefetcher_t *prefetcher_create(char *name, enum prefetcher_kind_t kind,
+	int block_size, int num_blocks, int table_size)
+{
+	struct prefetcher_t *prefetcher;
+
+	/* Create */
+	prefetcher = calloc(1, sizeof(struct prefetcher_t));
+	if (!prefetcher)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Name */
+	prefetcher->name = strdup(name);
+	if (!prefetcher->name)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Initialize */
+	assert(!(block_size & (block_size - 1)) && block_size > 0);
+	assert(table_size > 0);
+	prefetcher->kind = kind;
+	prefetcher->log_block_size = log_base2(block_size);
+	prefetcher->degree = 1;
+	prefetcher->distance = 1;
+	prefetcher->table_size = table_size;
+
+	/* Tables */
+	prefetcher->prefetched = calloc(num_blocks, 1);
+	if (kind == prefetcher_kind_stride)
+		prefetcher->stride_table = calloc(table_size,
+			sizeof(struct prefetcher_stride_entry_t));
+	if (kind == prefetcher_kind_stream)
+		prefetcher->streams = calloc(table_size,
+			sizeof(struct prefetcher_stream_t));
+	if (!prefetcher->prefetched || (kind == prefetcher_kind_stride &&
+		!prefetcher->stride_table) || (kind == prefetcher_kind_stream &&
+		!prefetcher->streams))
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Return */
+	return prefetcher;
+}
+
+
+void prefetcher_free(struct prefetcher_t *prefetcher)
+{
+	free(prefetcher->prefetched);
+	free(prefetcher->stride_table);
+	free(prefetcher->streams);
+	free(prefetcher->name);
+	free(prefetcher);
+}
+
+
+/* Called when the find-and-lock 'stack' has locked its block in 'mod'. The
+ * function updates the prefetched flag of the block, and trains the prefetcher
+ * with demand accesses. */
+void prefetcher_access(struct mod_t *mod, struct mod_stack_t *stack)
+{
+	struct prefetcher_t *prefetcher = mod->prefetcher;
+	int index;
+	int demand;
+	int trigger;
+
+	/* Prefetched block replaced before being accessed */
+	index = CACHE_BLOCK_INDEX(mod->cache, stack->set, stack->way);
+	demand = prefetcher_demand(stack);
+	trigger = !stack->hit;
+	if (!stack->hit && prefetcher->prefetched[index])
+	{
+		prefetcher->useless++;
+		prefetcher->prefetched[index] = 0;
+	}
+
+	/* First demand access to a prefetched block. It triggers new prefetches
+	 * as a miss would, so that sequential accesses keep prefetching. */
+	if (stack->hit && demand && prefetcher->prefetched[index])
+	{
+		prefetcher->useful++;
+		prefetcher->prefetched[index] = 0;
+		trigger = 1;
+	}
+
+	/* Train with demand accesses only, once per access */
+	if (!demand || stack->retry)
+		return;
+	switch (prefetcher->kind)
+	{
+
+	case prefetcher_kind_next_line:
+		if (trigger)
+			prefetcher_next_line(mod, stack->addr);
+		break;
+
+	case prefetcher_kind_stride:
+		prefetcher_stride(mod, stack->ret_stack->eip, stack->addr);
+		break;
+
+	case prefetcher_kind_stream:
+		if (trigger)
+			prefetcher_stream(mod, stack->addr);
+		break;
+
+	default:
+		panic("%s: invalid prefetcher kind", __FUNCTION__);
+	}
+}
+
+
+/* Called for a demand access in 'stack' before it waits for in-flight accesses
+ * to the same block. An in-flight prefetch of the block is counted as late. */
+void prefetcher_check_late(struct mod_t *mod, struct mod_stack_t *stack)
+{
+	struct prefetcher_t *prefetcher = mod->prefetcher;
+	struct mod_stack_t *prefetch_stack;
+
+	/* Not a demand access */
+	if (stack->prefetch || (stack->ret_stack && !prefetcher_demand(stack)))
+		return;
+
+	/* Look for in-flight prefetches of the block */
+	for (prefetch_stack = mod_in_flight_block(mod, stack->addr);
+		prefetch_stack; prefetch_stack = prefetch_stack->bucket_list_next)
+	{
+		if (!prefetch_stack->prefetch || prefetch_stack->prefetch_late)
+			continue;
+		prefetch_stack->prefetch_late = 1;
+		prefetcher->late++;
+	}
+}
+
+
+void prefetcher_dump_report(struct prefetcher_t *prefetcher, FILE *f)
+{
+	fprintf(f, "[ %s.Prefetcher ]\n", prefetcher->name);
+	fprintf(f, "\n");
+	fprintf(f, "Kind = %s\n", map_value(&prefetcher_kind_map, prefetcher->kind));
+	fprintf(f, "Degree = %d\n", prefetcher->degree);
+	if (prefetcher->kind == prefetcher_kind_stream)
+		fprintf(f, "Distance = %d\n", prefetcher->distance);
+	if (prefetcher->kind != prefetcher_kind_next_line)
+		fprintf(f, "TableSize = %d\n", prefetcher->table_size);
+	fprintf(f, "\n");
+	fprintf(f, "; Issued - Prefetches started\n");
+	fprintf(f, "; Dropped - Prefetches discarded for lack of a free port or MSHR\n");
+	fprintf(f, "; Useful - Prefetched blocks accessed after the prefetch completed\n");
+	fprintf(f, "; Late - Prefetches that a demand access had to wait for\n");
+	fprintf(f, "; Useless - Prefetched blocks replaced before being accessed\n");
+	fprintf(f, "; Accuracy - Useful plus late prefetches divided by issued prefetches\n");
+	fprintf(f, "Issued = %lld\n", prefetcher->issued);
+	fprintf(f, "Dropped = %lld\n", prefetcher->dropped);
+	fprintf(f, "Useful = %lld\n", prefetcher->useful);
+	fprintf(f, "Late = %lld\n", prefetcher->late);
+	fprintf(f, "Useless = %lld\n", prefetcher->useless);
+	fprintf(f, "Accuracy = %.4g\n", prefetcher->issued ?
+		(double) (prefetcher->useful + prefetcher->late) /
+		prefetcher->issued : 0.0);
+	fprintf(f, "\n\n");
+}
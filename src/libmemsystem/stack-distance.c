@@ -0,0 +1,184 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2011  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <mem-system.h>
+
+
+/*
+ * Stack Distance Analysis
+ *
+ * For a given number of sets, an access hits in an LRU cache with associativity
+ * A if and only if fewer than A different blocks of the same set were accessed
+ * since the last access to the block (its stack distance). By keeping one LRU
+ * stack per set, the histogram of stack distances gives the number of misses
+ * for every associativity in one single pass over the accesses. One such set of
+ * stacks is kept for each number of sets analyzed (a level).
+ *
+ * Stacks are truncated at 'max_assoc' blocks, since a block with a higher stack
+ * distance misses for every associativity analyzed.
+ */
+
+/* Index of the first set of 'level' in arrays 'stacks' and 'stack_sizes' */
+#define SDIST_LEVEL_FIRST_SET(sdist, level)  ((sdist)->min_sets * ((1 << (level)) - 1))
+
+/* Histogram of 'level' */
+#define SDIST_LEVEL_HIST(sdist, level)  ((sdist)->hist + (level) * ((sdist)->max_assoc + 1))
+
+
+struct sdist_t *sdist_create(char *name, int block_size, int min_sets, int max_sets,
+	int max_assoc)
+{
+	struct sdist_t *sdist;
+	int num_sets;
+
+	/* Create */
+	sdist = calloc(1, sizeof(struct sdist_t));
+	if (!sdist)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Name */
+	sdist->name = strdup(name);
+	if (!sdist->name)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Initialize */
+	assert(!(min_sets & (min_sets - 1)) && min_sets > 0);
+	assert(!(max_sets & (max_sets - 1)) && max_sets >= min_sets);
+	assert(!(max_assoc & (max_assoc - 1)) && max_assoc > 0);
+	sdist->log_block_size = log_base2(block_size);
+	sdist->min_sets = min_sets;
+	sdist->num_levels = log_base2(max_sets) - log_base2(min_sets) + 1;
+	sdist->max_assoc = max_assoc;
+	sdist->set_div = 1;
+
+	/* Stacks and histograms */
+	num_sets = SDIST_LEVEL_FIRST_SET(sdist, sdist->num_levels);
+	sdist->stacks = calloc((long) num_sets * max_assoc, sizeof(uint32_t));
+	sdist->stack_sizes = calloc(num_sets, sizeof(int));
+	sdist->hist = calloc(sdist->num_levels * (max_assoc + 1), sizeof(long long));
+	if (!sdist->stacks || !sdist->stack_sizes || !sdist->hist)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Return */
+	return sdist;
+}
+
+
+void sdist_free(struct sdist_t *sdist)
+{
+	free(sdist->stacks);
+	free(sdist->stack_sizes);
+	free(sdist->hist);
+	free(sdist->name);
+	free(sdist);
+}
+
+
+/* Record an access to the block containing 'addr' */
+void sdist_access(struct sdist_t *sdist, uint32_t addr)
+{
+	uint32_t block;
+	uint32_t *stack;
+	int *stack_size;
+	long long *hist;
+
+	int num_sets;
+	int level;
+	int set;
+	int dist;
+
+	block = addr >> sdist->log_block_size;
+	sdist->accesses++;
+	for (level = 0; level < sdist->num_levels; level++)
+	{
+		/* Stack for the set of the block */
+		num_sets = sdist->min_sets << level;
+		set = SDIST_LEVEL_FIRST_SET(sdist, level) +
+			(block / sdist->set_div) % num_sets;
+		stack = sdist->stacks + (long) set * sdist->max_assoc;
+		stack_size = &sdist->stack_sizes[set];
+		hist = SDIST_LEVEL_HIST(sdist, level);
+
+		/* Find block */
+		for (dist = 0; dist < *stack_size; dist++)
+			if (stack[dist] == block)
+				break;
+
+		/* If not found, the access misses for all associativities, and
+		 * the stack grows, or loses its least recently used block. */
+		if (dist == *stack_size)
+		{
+			hist[sdist->max_assoc]++;
+			if (*stack_size < sdist->max_assoc)
+				++*stack_size;
+			else
+				dist--;
+		}
+		else
+		{
+			hist[dist]++;
+		}
+
+		/* Move block to the top of the stack */
+		memmove(stack + 1, stack, dist * sizeof(uint32_t));
+		stack[0] = block;
+	}
+}
+
+
+/* Dump the miss ratio for each number of sets and for each associativity that
+ * is a power of two */
+void sdist_dump_report(struct sdist_t *sdist, FILE *f)
+{
+	long long *hist;
+	long long misses;
+
+	int level;
+	int assoc;
+	int dist;
+
+	/* Header */
+	fprintf(f, "[ %s.StackDistance ]\n", sdist->name);
+	fprintf(f, "\n");
+	fprintf(f, "BlockSize = %d\n", 1 << sdist->log_block_size);
+	fprintf(f, "Accesses = %lld\n", sdist->accesses);
+	fprintf(f, "Assoc =");
+	for (assoc = 1; assoc <= sdist->max_assoc; assoc <<= 1)
+		fprintf(f, " %d", assoc);
+	fprintf(f, "\n");
+	fprintf(f, "\n");
+
+	/* One row per number of sets, one column per associativity */
+	fprintf(f, "; Miss ratio for each number of sets, and each associativity in 'Assoc'\n");
+	for (level = 0; level < sdist->num_levels; level++)
+	{
+		hist = SDIST_LEVEL_HIST(sdist, level);
+		fprintf(f, "Sets.%d =", sdist->min_sets << level);
+		for (assoc = 1; assoc <= sdist->max_assoc; assoc <<= 1)
+		{
+			misses = 0;
+			for (dist = assoc; dist <= sdist->max_assoc; dist++)
+				misses += hist[dist];
+			fprintf(f, " %.4g", sdist->accesses ?
+				(double) misses / sdist->accesses : 0.0);
+		}
+		fprintf(f, "\n");
+	}
+	fprintf(f, "\n\n");
+}
@@ -0,0 +1,365 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2011  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <mem-system.h>
+
+
+/*
+ * Translation Lookaside Buffer (TLB)
+ *
+ * TLBs only add timing to translations, which are always obtained from the MMU.
+ * A CPU thread looks up its instruction or data TLB before accessing its entry
+ * module. Hits are overlapped with the cache access. A miss is detected after
+ * the TLB latency, and looks up the lower-level TLBs given by 'next', each one
+ * taking its own latency. A miss in the last level starts a page walk, reading
+ * one page table entry per level of the MMU page table through the entry data
+ * module of the thread. All TLBs looked up are then filled with the LRU policy.
+ *
+ * The access that missed is retried by the CPU until the translation is found.
+ * Further misses for the same page wait for the in-flight one, and the number
+ * of in-flight misses of a TLB is limited by its MSHR size.
+ */
+
+int EV_TLB_MISS;
+int EV_TLB_LOOKUP;
+int EV_TLB_WALK;
+
+/* With huge pages, an entry translates a huge page, and page walks end at the
+ * page directory. */
+#define TLB_LOG_PAGE_SIZE  (mmu_huge_pages ? mmu_log_huge_page_size : mmu_log_page_size)
+#define TLB_WALK_LEVELS  (mmu_huge_pages ? 1 : MMU_PAGE_WALK_LEVELS)
+
+
+
+
+/*
+ * Private Functions
+ */
+
+/* Return the entry translating 'vpn', or NULL, without updating the LRU order */
+static struct tlb_entry_t *tlb_lookup(struct tlb_t *tlb, int mid, uint32_t vpn)
+{
+	struct tlb_entry_t *entry;
+	int way;
+
+	entry = &tlb->entries[(vpn & (tlb->num_sets - 1)) * tlb->assoc];
+	for (way = 0; way < tlb->assoc; way++, entry++)
+		if (entry->vpn == vpn && entry->mid == mid)
+			return entry;
+	return NULL;
+}
+
+
+static struct tlb_entry_t *tlb_find(struct tlb_t *tlb, int mid, uint32_t vpn)
+{
+	struct tlb_entry_t *entry;
+
+	entry = tlb_lookup(tlb, mid, vpn);
+	if (entry)
+		entry->stamp = ++tlb->stamp;
+	return entry;
+}
+
+
+/* Insert a translation, replacing the least recently used entry of its set */
+static struct tlb_entry_t *tlb_fill(struct tlb_t *tlb, int mid, uint32_t vpn)
+{
+	struct tlb_entry_t *entry;
+	struct tlb_entry_t *victim;
+	int way;
+
+	/* Translation could have been filled by another miss */
+	entry = tlb_find(tlb, mid, vpn);
+	if (entry)
+		return entry;
+
+	/* Replace invalid or least recently used entry */
+	entry = &tlb->entries[(vpn & (tlb->num_sets - 1)) * tlb->assoc];
+	victim = entry;
+	for (way = 0; way < tlb->assoc; way++, entry++)
+		if (entry->stamp < victim->stamp)
+			victim = entry;
+	victim->mid = mid;
+	victim->vpn = vpn;
+	victim->stamp = ++tlb->stamp;
+	return victim;
+}
+
+
+/* Fill TLBs from the one where the miss started, down to 'last' */
+static void tlb_miss_fill(struct tlb_miss_t *miss, struct tlb_t *last)
+{
+	struct tlb_entry_t *entry;
+	struct tlb_t *tlb;
+
+	/* The first hit in the TLB where the miss started is the access that
+	 * missed being retried. */
+	entry = tlb_fill(miss->tlb, miss->mid, miss->vpn);
+	entry->retry = 1;
+
+	/* Lower levels */
+	for (tlb = miss->tlb; tlb != last; )
+	{
+		tlb = tlb->next;
+		tlb_fill(tlb, miss->mid, miss->vpn);
+	}
+}
+
+
+static void tlb_miss_finish(struct tlb_miss_t *miss)
+{
+	struct tlb_t *tlb = miss->tlb;
+
+	/* Remove from in-flight misses */
+	DOUBLE_LINKED_LIST_REMOVE(tlb, miss, miss);
+	tlb->filled_misses++;
+	tlb->miss_latency += esim_cycle - miss->start_cycle;
+	free(miss);
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+struct tlb_t *tlb_create(char *name, int num_sets, int assoc, int latency,
+	int mshr_size)
+{
+	struct tlb_t *tlb;
+	int i;
+
+	/* Create */
+	tlb = calloc(1, sizeof(struct tlb_t));
+	if (!tlb)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Name */
+	tlb->name = strdup(name);
+	if (!tlb->name)
+		fatal("%s: out of memory", __FUNCTION__);
+
+	/* Initialize */
+	assert(!(num_sets & (num_sets - 1)) && num_sets > 0);
+	tlb->num_sets = num_sets;
+	tlb->assoc = assoc;
+	tlb->latency = latency;
+	tlb->mshr_size = mshr_size;
+
+	/* Entries, all invalid */
+	tlb->entries = calloc(num_sets * assoc, sizeof(struct tlb_entry_t));
+	if (!tlb->entries)
+		fatal("%s: out of memory", __FUNCTION__);
+	for (i = 0; i < num_sets * assoc; i++)
+		tlb->entries[i].mid = -1;
+
+	/* Return */
+	return tlb;
+}
+
+
+void tlb_free(struct tlb_t *tlb)
+{
+	struct tlb_miss_t *miss;
+
+	/* Misses still in flight */
+	while (tlb->miss_list_head)
+	{
+		miss = tlb->miss_list_head;
+		DOUBLE_LINKED_LIST_REMOVE(tlb, miss, miss);
+		free(miss);
+	}
+
+	free(tlb->entries);
+	free(tlb->name);
+	free(tlb);
+}
+
+
+/* Return true if the translation of 'vtl_addr' in memory map 'mid' is in the
+ * TLB. The lookup has no side effects, so it can be used to check whether an
+ * access can proceed. The access itself must then call 'tlb_access'. */
+int tlb_probe(struct tlb_t *tlb, int mid, uint32_t vtl_addr)
+{
+	return tlb_lookup(tlb, mid, vtl_addr >> TLB_LOG_PAGE_SIZE) != NULL;
+}
+
+
+/* Look up the translation of 'vtl_addr' in memory map 'mid'. Return true if it
+ * is available. Otherwise, a miss is started, if not in flight already, using
+ * module 'mod' for page walks, and the access must be retried later. */
+int tlb_access(struct tlb_t *tlb, struct mod_t *mod, int mid, uint32_t vtl_addr)
+{
+	struct tlb_entry_t *entry;
+	struct tlb_miss_t *miss;
+	uint32_t vpn;
+
+	/* Hit */
+	vpn = vtl_addr >> TLB_LOG_PAGE_SIZE;
+	entry = tlb_find(tlb, mid, vpn);
+	if (entry)
+	{
+		if (entry->retry)
+			entry->retry = 0;
+		else
+			tlb->hits++;
+		return 1;
+	}
+
+	/* Miss in flight */
+	for (miss = tlb->miss_list_head; miss; miss = miss->miss_list_next)
+		if (miss->vpn == vpn && miss->mid == mid)
+			return 0;
+
+	/* No free MSHR */
+	if (tlb->miss_list_count >= tlb->mshr_size)
+		return 0;
+
+	/* Start miss */
+	miss = calloc(1, sizeof(struct tlb_miss_t));
+	if (!miss)
+		fatal("%s: out of memory", __FUNCTION__);
+	miss->tlb = tlb;
+	miss->level = tlb;
+	miss->mod = mod;
+	miss->mid = mid;
+	miss->vpn = vpn;
+	miss->start_cycle = esim_cycle;
+	DOUBLE_LINKED_LIST_INSERT_TAIL(tlb, miss, miss);
+	tlb->misses++;
+	esim_schedule_event(EV_TLB_MISS, miss, tlb->latency);
+	return 0;
+}
+
+
+/* Look up a translation without timing, filling the TLB and its lower levels on
+ * a miss. The page table entries read by a page walk are accessed atomically in
+ * module 'mod'. Used to warm up TLBs during fast-forwarding. */
+void tlb_access_atomic(struct tlb_t *tlb, struct mod_t *mod, int mid, uint32_t vtl_addr)
+{
+	uint32_t vpn;
+	int level;
+
+	vpn = vtl_addr >> TLB_LOG_PAGE_SIZE;
+	for (; tlb; tlb = tlb->next)
+	{
+		if (tlb_find(tlb, mid, vpn))
+			return;
+		tlb_fill(tlb, mid, vpn);
+	}
+	for (level = 0; level < TLB_WALK_LEVELS; level++)
+		mod_access_atomic(mod, mod_access_read,
+			mmu_page_walk_addr(mid, vtl_addr, level));
+}
+
+
+void tlb_handler(int event, void *data)
+{
+	struct tlb_miss_t *miss = data;
+	struct tlb_t *tlb = miss->level;
+
+	if (event == EV_TLB_MISS)
+	{
+		/* Look up next level */
+		if (tlb->next)
+		{
+			miss->level = tlb->next;
+			esim_schedule_event(EV_TLB_LOOKUP, miss, tlb->next->latency);
+			return;
+		}
+
+		/* Last level, start page walk */
+		tlb->walks++;
+		esim_execute_event(EV_TLB_WALK, miss);
+		return;
+	}
+
+	if (event == EV_TLB_LOOKUP)
+	{
+		/* Hit */
+		if (tlb_find(tlb, miss->mid, miss->vpn))
+		{
+			tlb->hits++;
+			tlb_miss_fill(miss, tlb);
+			tlb_miss_finish(miss);
+			return;
+		}
+
+		/* Miss */
+		tlb->misses++;
+		esim_execute_event(EV_TLB_MISS, miss);
+		return;
+	}
+
+	if (event == EV_TLB_WALK)
+	{
+		struct mod_stack_t *stack;
+		uint32_t addr;
+
+		/* Walk complete */
+		if (miss->walk_level == TLB_WALK_LEVELS)
+		{
+			tlb_miss_fill(miss, tlb);
+			tlb_miss_finish(miss);
+			return;
+		}
+
+		/* Read page table entry of next level */
+		addr = mmu_page_walk_addr(miss->mid, miss->vpn << TLB_LOG_PAGE_SIZE,
+			miss->walk_level);
+		miss->walk_level++;
+		mod_stack_id++;
+		stack = mod_stack_create(mod_stack_id, miss->mod, addr,
+			EV_TLB_WALK, miss);
+		mem_debug("  %lld %lld 0x%x %s page walk\n", esim_cycle, stack->id,
+			stack->addr, tlb->name);
+		esim_execute_event(EV_MOD_LOAD, stack);
+		return;
+	}
+
+	abort();
+}
+
+
+void tlb_dump_report(struct tlb_t *tlb, FILE *f)
+{
+	long long accesses;
+
+	accesses = tlb->hits + tlb->misses;
+	fprintf(f, "[ TLB %s ]\n", tlb->name);
+	fprintf(f, "\n");
+	fprintf(f, "Sets = %d\n", tlb->num_sets);
+	fprintf(f, "Assoc = %d\n", tlb->assoc);
+	fprintf(f, "Latency = %d\n", tlb->latency);
+	fprintf(f, "MSHR = %d\n", tlb->mshr_size);
+	fprintf(f, "Next = %s\n", tlb->next ? tlb->next->name : "None");
+	fprintf(f, "\n");
+	fprintf(f, "; Walks - Misses in the last level starting a page walk\n");
+	fprintf(f, "; AvgMissLatency - Cycles until misses started in this TLB are filled\n");
+	fprintf(f, "Accesses = %lld\n", accesses);
+	fprintf(f, "Hits = %lld\n", tlb->hits);
+	fprintf(f, "Misses = %lld\n", tlb->misses);
+	fprintf(f, "HitRatio = %.4g\n", accesses ?
+		(double) tlb->hits / accesses : 0.0);
+	fprintf(f, "Walks = %lld\n", tlb->walks);
+	fprintf(f, "AvgMissLatency = %.4g\n", tlb->filled_misses ?
+		(double) tlb->miss_latency / tlb->filled_misses : 0.0);
+	fprintf(f, "\n\n");
+}
@@ -30,9 +30,7 @@ struct net_msg_t *net_msg_create(struct net_t *net, struct net_node_t *src_node,
 	struct net_msg_t *msg;
 
 	/* Create */
-	msg = calloc(1, sizeof(struct net_msg_t));
-	if (!msg)
-		fatal("%s: out of memory", __FUNCTION__);
+	msg = repos_create_object(net->msg_repos);
 	
 	/* Initialize */
 	msg->net = net;
@@ -51,7 +49,7 @@ struct net_msg_t *net_msg_create(struct net_t *net, struct net_node_t *src_node,
 
 void net_msg_free(struct net_msg_t *msg)
 {
-	free(msg);
+	repos_free_object(msg->net->msg_repos, msg);
 }
 
 
@@ -67,9 +65,7 @@ struct net_stack_t *net_stack_create(struct net_t *net,
 	struct net_stack_t *stack;
 
 	/* Create */
-	stack = calloc(1, sizeof(struct net_stack_t));
-	if (!stack)
-		fatal("%s: out of memory", __FUNCTION__);
+	stack = repos_create_object(net->stack_repos);
 	
 	/* Initialize */
 	stack->net = net;
@@ -86,7 +82,7 @@ void net_stack_return(struct net_stack_t *stack)
 	int retevent = stack->ret_event;
 	struct net_stack_t *retstack = stack->ret_stack;
 
-	free(stack);
+	repos_free_object(stack->net->stack_repos, stack);
 	esim_schedule_event(retevent, retstack, 0);
 }
 
@@ -241,10 +241,10 @@ void net_config_load(void)
 void net_init(void)
 {
 	/* Register events */
-	EV_NET_SEND = esim_register_event(net_event_handler);
-	EV_NET_OUTPUT_BUFFER = esim_register_event(net_event_handler);
-	EV_NET_INPUT_BUFFER = esim_register_event(net_event_handler);
-	EV_NET_RECEIVE = esim_register_event(net_event_handler);
+	EV_NET_SEND = esim_register_event("EV_NET_SEND", net_event_handler);
+	EV_NET_OUTPUT_BUFFER = esim_register_event("EV_NET_OUTPUT_BUFFER", net_event_handler);
+	EV_NET_INPUT_BUFFER = esim_register_event("EV_NET_INPUT_BUFFER", net_event_handler);
+	EV_NET_RECEIVE = esim_register_event("EV_NET_RECEIVE", net_event_handler);
 
 	/* Load network configuration file */
 	net_config_load();
@@ -95,6 +95,8 @@ struct net_t *net_create(char *name)
 	net->node_list = list_create();
 	net->link_list = list_create();
 	net->routing_table = net_routing_table_create(net);
+	net->msg_repos = repos_create(sizeof(struct net_msg_t), net->name);
+	net->stack_repos = repos_create(sizeof(struct net_stack_t), net->name);
 
 	/* Return */
 	return net;
@@ -287,6 +289,12 @@ void net_free(struct net_t *net)
 		}
 	}
 
+	/* Repositories. Stacks of messages in flight are discarded. */
+	repos_free_all_objects(net->msg_repos);
+	repos_free(net->msg_repos);
+	repos_free_all_objects(net->stack_repos);
+	repos_free(net->stack_repos);
+
 	/* Network */
 	free(net->name);
 	free(net);
@@ -323,6 +331,10 @@ void net_dump_report(struct net_t *net, FILE *f)
 		(double) net->msg_size_acc / net->transfers : 0.0);
 	fprintf(f, "AverageLatency = %.4f\n", net->transfers ?
 		(double) net->lat_acc / net->transfers : 0.0);
+	fprintf(f, "MessageAllocations = %lld\n", repos_create_count(net->msg_repos));
+	fprintf(f, "MessagePoolSize = %d\n", repos_object_count(net->msg_repos));
+	fprintf(f, "StackAllocations = %lld\n", repos_create_count(net->stack_repos));
+	fprintf(f, "StackPoolSize = %d\n", repos_object_count(net->stack_repos));
 	fprintf(f, "\n");
 
 	/* Links */
@@ -35,6 +35,7 @@
 #include <linked-list.h>
 #include <hash-table.h>
 #include <config.h>
+#include <repos.h>
 
 
 
@@ -361,6 +362,10 @@ struct net_t
 	/* Hash table of in-flight messages. Each entry is a bucket list */
 	struct net_msg_t *msg_table[NET_MSG_TABLE_SIZE];
 
+	/* Repositories of messages and event-driven simulation stacks */
+	struct repos_t *msg_repos;
+	struct repos_t *stack_repos;
+
 	/* Stats */
 	long long transfers;  /* Transfers */
 	long long lat_acc;  /* Accumulated latency */
@@ -40,9 +40,20 @@ struct repos_t
 	int object_size;
 	void *alloc_head;
 	void *dealloc_head;
+
+	/* Statistics */
+	long long create_count;  /* Calls to 'repos_create_object' */
+	int object_count;  /* Objects allocated with malloc() */
 };
 
 
+/* Identifier given to the next repository. It is not taken from random(), so
+ * that the random sequence used by the simulation (e.g., for retry latencies)
+ * does not depend on the number of repositories created. This sequence is
+ * shifted with respect to versions that drew one value per repository. */
+static int repos_id_counter = 0x5e9a0000;
+
+
 struct repos_t *repos_create(int object_size, char *name)
 {
 	struct repos_t *repos;
@@ -57,7 +68,7 @@ struct repos_t *repos_create(int object_size, char *name)
 		fatal("%s: out of memory", __FUNCTION__);
 
 	/* Initialize */
-	repos->id = random();
+	repos->id = ++repos_id_counter;
 	repos->name = name;
 	repos->object_size = object_size;
 
@@ -127,6 +138,7 @@ void *repos_create_object(struct repos_t *repos)
 		objtail = obj + repos->object_size;
 		objtail->id = repos->id;
 		repos->dealloc_head = obj;
+		repos->object_count++;
 	}
 
 	/* Remove the first unallocated object from the list */
@@ -149,6 +161,7 @@ void *repos_create_object(struct repos_t *repos)
 	objtail->next = next_obj;
 	objtail->status = 1;
 	repos->alloc_head = obj;
+	repos->create_count++;
 
 	/* Return allocated object */
 	return obj;
@@ -197,6 +210,28 @@ void repos_free_object(struct repos_t *repos, void *obj)
 }
 
 
+void repos_free_all_objects(struct repos_t *repos)
+{
+	struct objtail_t *objtail, *head_objtail;
+	void *obj, *next_obj;
+
+	/* Move all objects in the allocated list to the unallocated list head */
+	for (obj = repos->alloc_head; obj; obj = next_obj)
+	{
+		objtail = obj + repos->object_size;
+		next_obj = objtail->next;
+		head_objtail = repos->dealloc_head + repos->object_size;
+		if (repos->dealloc_head)
+			head_objtail->prev = obj;
+		objtail->prev = NULL;
+		objtail->next = repos->dealloc_head;
+		objtail->status = 0;
+		repos->dealloc_head = obj;
+	}
+	repos->alloc_head = NULL;
+}
+
+
 int repos_allocated_object(struct repos_t *repos, void *obj)
 {
 	struct objtail_t *objtail;
@@ -205,3 +240,15 @@ int repos_allocated_object(struct repos_t *repos, void *obj)
 	objtail = obj + repos->object_size;
 	return objtail->id == repos->id && objtail->status;
 }
+
+
+long long repos_create_count(struct repos_t *repos)
+{
+	return repos->create_count;
+}
+
+
+int repos_object_count(struct repos_t *repos)
+{
+	return repos->object_count;
+}
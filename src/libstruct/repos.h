@@ -39,9 +39,19 @@ void repos_free_dump(struct repos_t *repos, void(*dump)(void *, FILE *));
 void *repos_create_object(struct repos_t *repos);
 void repos_free_object(struct repos_t *repos, void *obj);
 
+/* Return all allocated objects to the repository at once, e.g., to discard
+ * objects still in use when a simulation finishes. */
+void repos_free_all_objects(struct repos_t *repos);
+
 /* Return non-0 if an object is allocated (not freed) in the
  * specified repository. The object must have been created
  * with the repository */
 int repos_allocated_object(struct repos_t *repos, void *obj);
 
+/* Statistics. Number of objects returned by 'repos_create_object', and
+ * number of objects actually allocated with malloc(), which is the maximum
+ * number of objects that were allocated at the same time. */
+long long repos_create_count(struct repos_t *repos);
+int repos_object_count(struct repos_t *repos);
+
 #endif
@@ -78,6 +78,11 @@ static char *sim_help =
 	"      Disassemble the x86 ELF file provided in <file>, using the internal x86\n"
 	"      disassembler. This option is incompatible with any other option.\n"
 	"\n"
+	"  --cpu-host-threads <num>\n"
+	"      Number of host threads used to simulate the pipeline stages of different\n"
+	"      cores in parallel, in a detailed CPU simulation. Simulation results do not\n"
+	"      depend on this value. Default value is 1.\n"
+	"\n"
 	"  --cpu-sim {functional|detailed}\n"
 	"      Choose a functional simulation (emulation) of an x86 program, versus\n"
 	"      a detailed (architectural) simulation. Simulation is functional by default.\n"
@@ -112,6 +117,12 @@ static char *sim_help =
 	"            to obtain graphical timing diagrams.\n"
 	"        --debug-error: on simulation crashes, dump of the modeled CPU state.\n"\
 	"\n"
+	"  --esim-queue {heap|wheel}\n"
+	"      Data structure used by the event-driven simulation engine to keep pending\n"
+	"      events. A timing wheel (default) inserts and extracts events in constant\n"
+	"      time, using a heap only for events scheduled far in the future. Both choices\n"
+	"      process events in exactly the same order.\n"
+	"\n"
 	"  --gpu-calc <file_prefix>\n"
 	"      If this option is set, a kernel execution will cause three GPU occupancy plots\n"
 	"      to be dumped in files '<file_prefix>.<ndrange_id>.<plot>.eps', where\n"
@@ -216,6 +227,11 @@ static char *sim_help =
 	"      pipeline queues (ROB, IQ, etc.). Use only together with a detailed CPU\n"
 	"      simulation (option '--cpu-sim detailed').\n"
 	"\n"
+	"  --report-esim <file>\n"
+	"      File to dump a profile of the event-driven simulation engine, including the\n"
+	"      number of times each event handler was invoked and the host time spent in\n"
+	"      it. Use together with detailed CPU or GPU simulation.\n"
+	"\n"
 	"  --report-gpu-kernel <file>\n"
 	"      File to dump report of a GPU device kernel emulation. The report includes\n"
 	"      statistics about type of instructions, VLIW packing, thread divergence, etc.\n"
@@ -279,6 +295,17 @@ static void sim_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* CPU host threads */
+		if (!strcmp(argv[argi], "--cpu-host-threads"))
+		{
+			sim_need_argument(argc, argv, argi);
+			cpu_host_threads = atoi(argv[++argi]);
+			if (cpu_host_threads < 1)
+				fatal("option '%s': invalid number of threads.\n%s",
+					argv[argi - 1], err_help_note);
+			continue;
+		}
+
 
 		/* CPU simulation accuracy */
 		if (!strcmp(argv[argi], "--cpu-sim"))
@@ -423,6 +450,21 @@ static void sim_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* Event queue */
+		if (!strcmp(argv[argi], "--esim-queue"))
+		{
+			sim_need_argument(argc, argv, argi);
+			argi++;
+			if (!strcasecmp(argv[argi], "heap"))
+				esim_queue_kind = esim_queue_heap;
+			else if (!strcasecmp(argv[argi], "wheel"))
+				esim_queue_kind = esim_queue_wheel;
+			else
+				fatal("option '%s': invalid argument ('%s').\n%s",
+					argv[argi - 1], argv[argi], err_help_note);
+			continue;
+		}
+
 		/* GPU occupancy calculation plots */
 		if (!strcmp(argv[argi], "--gpu-calc"))
 		{
@@ -650,6 +692,14 @@ static void sim_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* Event-driven simulation report */
+		if (!strcmp(argv[argi], "--report-esim"))
+		{
+			sim_need_argument(argc, argv, argi);
+			esim_report_file_name = argv[++argi];
+			continue;
+		}
+
 		/* GPU emulation report */
 		if (!strcmp(argv[argi], "--report-gpu-kernel"))
 		{
@@ -725,6 +775,8 @@ static void sim_read_command_line(int *argc_ptr, char **argv)
 
 		if (*cpu_config_file_name)
 			fatal(msg, "--cpu-config");
+		if (cpu_host_threads > 1)
+			fatal(msg, "--cpu-host-threads");
 		if (*esim_debug_file_name)
 			fatal(msg, "--debug-cpu-pipeline");
 		if (*cpu_report_file_name)
@@ -762,9 +814,13 @@ static void sim_read_command_line(int *argc_ptr, char **argv)
 			fatal(msg, "--mem-config");
 		if (*mem_report_file_name)
 			fatal(msg, "--report-mem");
+		if (*esim_report_file_name)
+			fatal(msg, "--report-esim");
 	}
 
 	/* Other checks */
+	if (cpu_host_threads > 1 && *esim_debug_file_name)
+		fatal("option '--cpu-host-threads' is incompatible with '--debug-cpu-pipeline'.");
 	if (*gpu_visual_file_name && argc > 3)
 		fatal("option '--gpu-visual' is incompatible with any other options.");
 	if (*gpu_disasm_file_name && argc > 3)
@@ -856,6 +912,15 @@ void sim_stats_summary(void)
 		}
 		fprintf(stderr, "\n");
 	}
+
+	/* Event-driven simulation */
+	if (cpu_sim_kind == cpu_sim_detailed || gpu_sim_kind == gpu_sim_detailed)
+	{
+		fprintf(stderr, "[ ESim ]\n");
+		fprintf(stderr, "Events = %lld\n", esim_scheduled_event_count);
+		fprintf(stderr, "EventRecords = %lld\n", esim_event_record_count);
+		fprintf(stderr, "\n");
+	}
 }
 
 